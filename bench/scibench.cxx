@@ -0,0 +1,686 @@
+/*
+ *      scibench.cxx - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2012 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Headless benchmarks for the Scintilla document core: insertion and deletion in the
+ * cell buffer, Document::FindText() and the speed of the lexers Geany uses, also with
+ * the large keyword sets used to highlight type names, and restyling after typing.
+ * No widget is created, the lexers style a Document directly.
+ *
+ * Usage: scibench [--iterations N] [--size BYTES] [SRCDIR]
+ *
+ * SRCDIR is the top of the Geany source tree, whose files are used as sample text.
+ * Each result is printed on its own line as a JSON object, see report(). The exit status
+ * is 1 when folding after edits gave other levels than folding in one pass.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+#include "Platform.h"
+
+#include "ILexer.h"
+#include "Scintilla.h"
+#include "SciLexer.h"
+
+#include "LexerModule.h"
+#include "Catalogue.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "CellBuffer.h"
+#include "PerLine.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "Document.h"
+
+#ifdef SCI_NAMESPACE
+using namespace Scintilla;
+#endif
+
+
+struct LexerSample
+{
+	const char *lexer;
+	const char *file;
+	const char *keywords;
+	/* false when Fold() of the lexer does nothing, so no fold result is reported. The
+	 * HTML lexer folds while lexing, its lex result includes folding. */
+	bool fold;
+};
+
+/* One sample for each lexer, taken from files which are part of the source tree */
+static const LexerSample lexer_samples[] =
+{
+	{ "cpp", "src/editor.c",
+		"auto break case char const continue default do double else enum extern float for "
+		"goto if inline int long register restrict return short signed sizeof static struct "
+		"switch typedef union unsigned void volatile while", true },
+	{ "python", "scripts/create_py_tags.py",
+		"and as assert break class continue def del elif else except exec finally for from "
+		"global if import in is lambda not or pass print raise return try while with yield",
+		true },
+	{ "hypertext", "doc/geany.html",
+		"a body br code div em h1 h2 h3 head html li link meta p pre span strong table tbody "
+		"td th title tr tt ul", false },
+	{ "xml", "data/geany.glade", NULL, false },
+	{ "css", "doc/geany.css",
+		"background border color display font font-family font-size margin padding width",
+		true },
+	{ "bash", "autogen.sh",
+		"case do done elif else esac exit fi for function if in return then until while",
+		true },
+	{ "perl", "scripts/changelist.pl",
+		"else elsif for foreach if my next our print return sub unless until use while",
+		true },
+	{ "makefile", "src/Makefile.am", NULL, false },
+	{ "props", "data/filetypes.common", NULL, true }
+};
+
+static int iterations = 3;
+static int sample_size = 4 * 1024 * 1024;
+
+
+/* Prints one result. The fields are the same for all benchmarks so results of different
+ * builds can be compared by (suite, benchmark, case). */
+static void report(const char *benchmark, const char *name, long count,
+		double seconds, double value, const char *unit)
+{
+	printf("{\"suite\": \"scintilla\", \"benchmark\": \"%s\", \"case\": \"%s\", "
+		"\"count\": %ld, \"seconds\": %.6f, \"value\": %.3f, \"unit\": \"%s\"}\n",
+		benchmark, name, count, seconds, value, unit);
+	fflush(stdout);
+}
+
+
+static double per_second(double amount, double seconds)
+{
+	return amount / (seconds > 1e-9 ? seconds : 1e-9);
+}
+
+
+static bool read_file(const std::string &filename, std::string &contents)
+{
+	FILE *fp = fopen(filename.c_str(), "rb");
+	char buf[8192];
+	size_t len;
+
+	if (!fp)
+		return false;
+	contents.clear();
+	while ((len = fread(buf, 1, sizeof(buf), fp)) > 0)
+		contents.append(buf, len);
+	fclose(fp);
+	return !contents.empty();
+}
+
+
+/* Repeats the text until it is at least sample_size bytes long so each run takes long
+ * enough to be measured reliably. */
+static std::string make_sample(const std::string &text)
+{
+	std::string sample;
+
+	sample.reserve(sample_size + text.length());
+	while (static_cast<int>(sample.length()) < sample_size)
+		sample += text;
+	return sample;
+}
+
+
+static Document *document_new(const std::string &text)
+{
+	Document *doc = new Document();
+
+	doc->AddRef();
+	doc->SetDBCSCodePage(SC_CP_UTF8);
+	doc->SetUndoCollection(false);
+	doc->InsertString(0, text.c_str(), static_cast<int>(text.length()));
+	doc->SetUndoCollection(true);
+	return doc;
+}
+
+
+/* Lexes and folds the whole document. types is given to keyword set 3 like
+ * document_highlight_tags() does with the type names of the workspace. */
+static void run_lexer(const LexerModule *module, Document *doc, const char *name,
+		const char *keywords, const char *types, bool fold)
+{
+	double lexSeconds = 0;
+	double foldSeconds = 0;
+	int length = doc->Length();
+
+	for (int i = 0; i < iterations; i++)
+	{
+		ILexer *lexer = module->Create();
+		lexer->PropertySet("fold", "1");
+		lexer->PropertySet("fold.compact", "0");
+		lexer->PropertySet("fold.html", "1");
+		if (keywords)
+			lexer->WordListSet(0, keywords);
+		if (types)
+			lexer->WordListSet(3, types);
+
+		ElapsedTime et;
+		lexer->Lex(0, length, 0, doc);
+		lexSeconds += et.Duration(true);
+		if (fold)
+			lexer->Fold(0, length, 0, doc);
+		foldSeconds += et.Duration();
+
+		lexer->Release();
+	}
+	report("lex", name, length, lexSeconds,
+		per_second(static_cast<double>(length) * iterations, lexSeconds) / (1024 * 1024), "MB/s");
+	if (fold)
+		report("fold", name, length, foldSeconds,
+			per_second(static_cast<double>(length) * iterations, foldSeconds) / (1024 * 1024), "MB/s");
+}
+
+
+static void bench_lexer(const LexerSample &sample, const std::string &srcdir)
+{
+	const LexerModule *module = Catalogue::Find(sample.lexer);
+	std::string text;
+
+	if (!module || !read_file(srcdir + "/" + sample.file, text))
+	{
+		fprintf(stderr, "Skipping lexer %s\n", sample.lexer);
+		return;
+	}
+
+	Document *doc = document_new(make_sample(text));
+	run_lexer(module, doc, sample.lexer, sample.keywords, NULL, sample.fold);
+	doc->Release();
+}
+
+
+/* Styles C with growing sets of type names, as for a project with large global tags
+ * files, to show the cost of keyword lookups in the lexer. A few names used in the
+ * sample are included so some identifiers do match. */
+static void bench_lexer_types(const std::string &text)
+{
+	const int counts[] = { 100, 10000, 100000 };
+	const LexerModule *module = Catalogue::Find(lexer_samples[0].lexer);
+	Document *doc;
+
+	if (!module)
+		return;
+
+	doc = document_new(text);
+	/* style once first so the smallest set does not pay for filling the style buffer */
+	ILexer *lexer = module->Create();
+	lexer->Lex(0, doc->Length(), 0, doc);
+	lexer->Release();
+
+	for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+	{
+		std::string types = "GeanyDocument GeanyEditor ScintillaObject gboolean gchar gint";
+		char name[64];
+
+		for (int n = 0; n < counts[i]; n++)
+		{
+			/* share first characters with real identifiers like a tags file does */
+			snprintf(name, sizeof(name), " g%c_type_%d", 'a' + n % 26, n);
+			types += name;
+		}
+		snprintf(name, sizeof(name), "%s-types-%d", lexer_samples[0].lexer, counts[i]);
+		run_lexer(module, doc, name, lexer_samples[0].keywords, types.c_str(), false);
+	}
+	doc->Release();
+}
+
+
+/* Lets the document style itself like it does for the editor widget */
+class BenchLexInterface : public LexInterface
+{
+public:
+	BenchLexInterface(Document *doc, const LexerSample &sample) : LexInterface(doc)
+	{
+		const LexerModule *module = Catalogue::Find(sample.lexer);
+
+		if (module)
+		{
+			doc->SetStylingBits(module->GetStyleBitsNeeded());
+			instance = module->Create();
+			/* the fold properties highlighting.c sets */
+			instance->PropertySet("fold", "1");
+			instance->PropertySet("fold.compact", "0");
+			instance->PropertySet("fold.comment", "1");
+			instance->PropertySet("fold.preprocessor", "1");
+			instance->PropertySet("fold.at.else", "1");
+			instance->PropertySet("fold.html", "1");
+			if (sample.keywords)
+				instance->WordListSet(0, sample.keywords);
+		}
+	}
+	~BenchLexInterface()
+	{
+		if (instance)
+			instance->Release();
+	}
+};
+
+
+/* Types in the middle of the document, styling and folding the rest of it after each
+ * character like SCI_COLOURISE does, to show the cost of folding lines again. */
+static void bench_fold_edit(const std::string &text)
+{
+	const char insertion[] = "\tg_free(pointer);\n";
+	const int insertionLength = static_cast<int>(strlen(insertion));
+	const int operations = 200;
+	/* a sixteenth of the sample keeps each run short */
+	Document *doc = document_new(text.substr(0, text.length() / 16));
+
+	doc->pli = new BenchLexInterface(doc, lexer_samples[0]);
+	doc->EnsureStyledTo(doc->Length());
+
+	int pos = doc->LineStart(doc->LinesTotal() / 2);
+	ElapsedTime et;
+	for (int i = 0; i < operations; i++)
+	{
+		doc->InsertString(pos, insertion + (i % insertionLength), 1);
+		pos++;
+		doc->EnsureStyledTo(doc->Length());
+	}
+	double seconds = et.Duration();
+	report("fold-edit", lexer_samples[0].lexer, operations, seconds,
+		per_second(operations, seconds), "ops/s");
+	doc->Release();
+}
+
+
+struct FindCase
+{
+	const char *name;
+	const char *text;
+	int flags;
+};
+
+static const FindCase find_cases[] =
+{
+	{ "literal-absent", "qzxjqzxj", SCFIND_MATCHCASE },
+	{ "literal", "editor", SCFIND_MATCHCASE },
+	{ "literal-nocase", "EDITOR", 0 },
+	{ "word", "if", SCFIND_MATCHCASE | SCFIND_WHOLEWORD },
+	{ "regex", "[a-z_]+\\(", SCFIND_MATCHCASE | SCFIND_REGEXP | SCFIND_POSIX },
+	{ "regex-absent", "qz[0-9]+xj", SCFIND_MATCHCASE | SCFIND_REGEXP | SCFIND_POSIX }
+};
+
+
+/* Finds all matches from the start to the end of the document, like Find All does. */
+static long find_all(Document *doc, const FindCase &fc)
+{
+	int length = doc->Length();
+	int pos = 0;
+	long matches = 0;
+
+	while (pos < length)
+	{
+		int lengthFound = static_cast<int>(strlen(fc.text));
+		long found = doc->FindText(pos, length, fc.text,
+			(fc.flags & SCFIND_MATCHCASE) != 0, (fc.flags & SCFIND_WHOLEWORD) != 0,
+			(fc.flags & SCFIND_WORDSTART) != 0, (fc.flags & SCFIND_REGEXP) != 0,
+			fc.flags, &lengthFound);
+
+		if (found < 0)
+			break;
+		matches++;
+		pos = static_cast<int>(found) + (lengthFound > 0 ? lengthFound : 1);
+	}
+	return matches;
+}
+
+
+static void bench_find(const std::string &text)
+{
+	Document *doc = document_new(text);
+	CaseFolderTable *caseFolder = new CaseFolderTable();
+
+	caseFolder->StandardASCII();
+	doc->SetCaseFolder(caseFolder);
+
+	for (size_t i = 0; i < sizeof(find_cases) / sizeof(find_cases[0]); i++)
+	{
+		long matches = 0;
+		ElapsedTime et;
+
+		for (int n = 0; n < iterations; n++)
+			matches = find_all(doc, find_cases[i]);
+		double seconds = et.Duration();
+
+		report("find", find_cases[i].name, matches, seconds,
+			per_second(static_cast<double>(doc->Length()) * iterations, seconds) / (1024 * 1024),
+			"MB/s");
+	}
+	doc->Release();
+}
+
+
+/* Small deterministic generator so each run edits the same positions */
+static unsigned int next_random(unsigned int &seed)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 8) & 0xffffff;
+}
+
+
+/* Compares the fold levels of doc with those of a fresh document holding the same text
+ * and folded in one pass. Returns the number of lines which differ. */
+static int compare_folding(Document *doc, const LexerSample &sample)
+{
+	std::string text(doc->Length(), '\0');
+	int mismatches = 0;
+
+	doc->GetCharRange(&text[0], 0, doc->Length());
+	Document *full = document_new(text);
+	full->pli = new BenchLexInterface(full, sample);
+	full->EnsureStyledTo(full->Length());
+
+	for (int line = 0; line < doc->LinesTotal(); line++)
+	{
+		if (doc->GetLevel(line) != full->GetLevel(line))
+		{
+			if (mismatches == 0)
+				fprintf(stderr, "Fold level of %s line %d is %x after editing but %x when "
+					"folded in one pass\n", sample.lexer, line + 1, doc->GetLevel(line),
+					full->GetLevel(line));
+			mismatches++;
+		}
+	}
+	full->Release();
+	return mismatches;
+}
+
+
+/* Checks that folding only the lines changed by an edit gives the same levels as folding
+ * the whole document, since whether folding a part converges depends on the folder. Each
+ * step edits at a random place and styles to just after a later fold or comment start,
+ * like brace_match() styling one character or the view styling to the caret, so the last
+ * line is folded from part of its text. Then text is typed above that line and the whole
+ * document is styled. Returns the number of lines which differ. */
+static int check_fold_edit(const LexerSample &sample, const std::string &srcdir)
+{
+	const char *insertions[] = { "x", " ", "\n", "\t", "    ", "{", "}", "/*", "*/", "#",
+		":", "<p>", "</p>" };
+	const int operations = 100;
+	unsigned int seed = 1;
+	int mismatches = 0;
+	int steps;
+	std::string text;
+
+	if (!Catalogue::Find(sample.lexer) || !read_file(srcdir + "/" + sample.file, text))
+	{
+		fprintf(stderr, "Skipping fold check of lexer %s\n", sample.lexer);
+		return 0;
+	}
+	/* each step folds the whole text again, so keep it about the size of editor.c */
+	Document *doc = document_new(text.substr(0, 160 * 1024));
+
+	doc->pli = new BenchLexInterface(doc, sample);
+	doc->EnsureStyledTo(doc->Length());
+
+	ElapsedTime et;
+	for (steps = 0; steps < operations && mismatches == 0; steps++)
+	{
+		int pos = static_cast<int>(next_random(seed) % static_cast<unsigned int>(doc->Length()));
+
+		if (next_random(seed) % 3 != 0)
+		{
+			const char *insertion = insertions[next_random(seed) %
+				(sizeof(insertions) / sizeof(insertions[0]))];
+			doc->InsertString(pos, insertion, static_cast<int>(strlen(insertion)));
+		}
+		else
+			doc->DeleteChars(pos,
+				Platform::Minimum(1 + static_cast<int>(next_random(seed) % 4), doc->Length() - pos));
+
+		int end = Platform::Minimum(pos + static_cast<int>(next_random(seed) % 4000), doc->Length());
+		while (end + 1 < doc->Length() && !strchr("{:<", doc->CharAt(end)) &&
+				(doc->CharAt(end) != '/' || doc->CharAt(end + 1) != '*'))
+			end++;
+		doc->EnsureStyledTo(Platform::Minimum(end + 2, doc->Length()));
+
+		pos = static_cast<int>(next_random(seed) % static_cast<unsigned int>(pos + 1));
+		doc->InsertString(pos, "x", 1);
+		doc->EnsureStyledTo(doc->Length());
+		mismatches = compare_folding(doc, sample);
+	}
+	double seconds = et.Duration();
+	report("fold-check", sample.lexer, steps, seconds, mismatches, "lines");
+	doc->Release();
+	return mismatches;
+}
+
+
+/* Finds the last match of a regular expression which starts before startPos, like a backward
+ * search should, by searching forward from each earlier position. */
+static long find_last_forward(Document *doc, const char *pattern, int startPos, int endPos,
+		int *length)
+{
+	for (int pos = startPos - 1; pos >= endPos; pos--)
+	{
+		int lengthFound = static_cast<int>(strlen(pattern));
+		long found = doc->FindText(pos, startPos, pattern, true, false, false, true, 0,
+			&lengthFound);
+
+		if (found == pos)
+		{
+			*length = lengthFound;
+			return found;
+		}
+	}
+	*length = 0;
+	return -1;
+}
+
+
+/* Checks regular expression searches over every range of short random texts, to catch
+ * empty matches and assertions at line ends and at the ends of the range. Backward searches
+ * must give the same match as searching forward and neither direction may give an empty
+ * match between CR and LF. Returns the number of searches which fail. */
+static int check_find_regex(void)
+{
+	const char *pieces[] = { "a", "b", " ", "ab", "aa", "\n", "\r\n" };
+	const char *patterns[] = { "a", "ab*", "a*", "a+?", ".*", "^", "$", "^$", "^a", "b$",
+		"\\<", "\\>", "\\<a", "b\\>", "\\(ab*\\)+", "\\(a\\)*b", "\\n", "a\\r\\n" };
+	const int texts = 100;
+	unsigned int seed = 1;
+	int mismatches = 0;
+	int mismatchesForward = 0;
+	long searches = 0;
+
+	ElapsedTime et;
+	for (int t = 0; t < texts; t++)
+	{
+		std::string text;
+		int count = static_cast<int>(next_random(seed) % 12);
+
+		for (int i = 0; i < count; i++)
+			text += pieces[next_random(seed) % (sizeof(pieces) / sizeof(pieces[0]))];
+		Document *doc = document_new(text);
+
+		for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); p++)
+		{
+			for (int startPos = 1; startPos <= doc->Length(); startPos++)
+			{
+				for (int endPos = 0; endPos < startPos; endPos++)
+				{
+					int length = static_cast<int>(strlen(patterns[p]));
+					int lengthExpected;
+					long found = doc->FindText(startPos, endPos, patterns[p], true, false, false,
+						true, 0, &length);
+					long expected = find_last_forward(doc, patterns[p], startPos, endPos,
+						&lengthExpected);
+
+					searches++;
+					if (found != expected || (found >= 0 && length != lengthExpected))
+					{
+						if (mismatches == 0)
+							fprintf(stderr, "Searching backward for %s from %d to %d in text %d "
+								"finds %ld length %d instead of %ld length %d\n", patterns[p],
+								startPos, endPos, t, found, length, expected, lengthExpected);
+						mismatches++;
+					}
+
+					length = static_cast<int>(strlen(patterns[p]));
+					found = doc->FindText(endPos, startPos, patterns[p], true, false, false,
+						true, 0, &length);
+					if (found > 0 && length == 0 &&
+						doc->CharAt(found - 1) == '\r' && doc->CharAt(found) == '\n')
+					{
+						if (mismatchesForward == 0)
+							fprintf(stderr, "Searching forward for %s from %d to %d in text %d "
+								"finds an empty match between CR and LF at %ld\n", patterns[p],
+								endPos, startPos, t, found);
+						mismatchesForward++;
+					}
+				}
+			}
+		}
+		doc->Release();
+	}
+	double seconds = et.Duration();
+	report("find-check", "regex-backward", searches, seconds, mismatches, "searches");
+	report("find-check", "regex-forward", searches, seconds, mismatchesForward, "searches");
+	return mismatches + mismatchesForward;
+}
+
+
+static void bench_edit(const std::string &text)
+{
+	const char insertion[] = "g_free(pointer);";
+	const int insertionLength = static_cast<int>(strlen(insertion));
+	const int operations = 100000;
+	unsigned int seed = 1;
+	int length = static_cast<int>(text.length());
+	double seconds;
+
+	/* loading a file: one large insertion without undo */
+	ElapsedTime et;
+	for (int n = 0; n < iterations; n++)
+	{
+		Document *doc = document_new(text);
+		doc->Release();
+	}
+	seconds = et.Duration();
+	report("edit", "load", length, seconds,
+		per_second(static_cast<double>(length) * iterations, seconds) / (1024 * 1024), "MB/s");
+
+	Document *doc = document_new(text);
+
+	/* typing: single characters at one place, each one an undo action */
+	int pos = doc->LineStart(doc->LinesTotal() / 2);
+	et.Duration(true);
+	for (int i = 0; i < operations; i++)
+	{
+		doc->InsertString(pos, insertion + (i % insertionLength), 1);
+		pos++;
+	}
+	seconds = et.Duration();
+	report("edit", "typing", operations, seconds, per_second(operations, seconds), "ops/s");
+
+	/* insertions and deletions spread over the whole document */
+	et.Duration(true);
+	for (int i = 0; i < operations; i++)
+	{
+		pos = static_cast<int>(next_random(seed) % static_cast<unsigned int>(doc->Length()));
+		doc->InsertString(doc->MovePositionOutsideChar(pos, 1, false), insertion, insertionLength);
+	}
+	seconds = et.Duration();
+	report("edit", "insert-random", operations, seconds, per_second(operations, seconds), "ops/s");
+
+	et.Duration(true);
+	for (int i = 0; i < operations; i++)
+	{
+		pos = static_cast<int>(next_random(seed) %
+			static_cast<unsigned int>(doc->Length() - insertionLength));
+		pos = doc->MovePositionOutsideChar(pos, 1, false);
+		doc->DeleteChars(pos, doc->MovePositionOutsideChar(pos + insertionLength, 1, false) - pos);
+	}
+	seconds = et.Duration();
+	report("edit", "delete-random", operations, seconds, per_second(operations, seconds), "ops/s");
+
+	/* undoing everything, like reverting a file */
+	int undone = 0;
+	et.Duration(true);
+	while (doc->CanUndo())
+	{
+		doc->Undo();
+		undone++;
+	}
+	seconds = et.Duration();
+	report("edit", "undo", undone, seconds, per_second(undone, seconds), "ops/s");
+
+	doc->Release();
+}
+
+
+int main(int argc, char **argv)
+{
+	std::string srcdir = ".";
+	std::string text;
+	int status = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+			iterations = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+			sample_size = atoi(argv[++i]);
+		else if (argv[i][0] == '-')
+		{
+			fprintf(stderr, "Usage: %s [--iterations N] [--size BYTES] [SRCDIR]\n", argv[0]);
+			return 1;
+		}
+		else
+			srcdir = argv[i];
+	}
+	if (iterations < 1)
+		iterations = 1;
+	if (sample_size < 1)
+		sample_size = 1;
+
+	if (!read_file(srcdir + "/" + lexer_samples[0].file, text))
+	{
+		fprintf(stderr, "Cannot read %s/%s\n", srcdir.c_str(), lexer_samples[0].file);
+		return 1;
+	}
+	for (size_t i = 0; i < sizeof(lexer_samples) / sizeof(lexer_samples[0]); i++)
+	{
+		if (check_fold_edit(lexer_samples[i], srcdir) > 0)
+			status = 1;
+	}
+	if (check_find_regex() > 0)
+		status = 1;
+	text = make_sample(text);
+
+	bench_edit(text);
+	bench_find(text);
+	bench_lexer_types(text);
+	bench_fold_edit(text);
+	for (size_t i = 0; i < sizeof(lexer_samples) / sizeof(lexer_samples[0]); i++)
+		bench_lexer(lexer_samples[i], srcdir);
+	return status;
+}
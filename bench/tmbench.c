@@ -0,0 +1,349 @@
+/*
+ *      tmbench.c - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2012 The Geany contributors
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Headless benchmarks for the tag manager: CTags parsing throughput for each language,
+ * merging and sorting the workspace tag array and the latency of tm_workspace_find().
+ *
+ * Usage: tmbench [OPTION...] FILE...
+ *
+ * Each result is printed on its own line as a JSON object, see report().
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <glib.h>
+
+#include "tm_tagmanager.h"
+
+
+typedef struct BenchFile
+{
+	gchar *contents;
+	gsize length;
+	TMWorkObject *source_file;
+}
+BenchFile;
+
+typedef struct LangStats
+{
+	const gchar *name;
+	guint files;
+	guint tags;
+	gdouble bytes;
+	gdouble seconds;
+}
+LangStats;
+
+
+static gint iterations = 5;
+static gint find_samples = 2000;
+static gchar *global_tags_file = NULL;
+static gchar *global_tags_lang = NULL;
+
+static GOptionEntry entries[] =
+{
+	{ "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+		"Number of times each benchmark is repeated (default: 5)", "N" },
+	{ "find-samples", 's', 0, G_OPTION_ARG_INT, &find_samples,
+		"Number of tag names to look up with tm_workspace_find() (default: 2000)", "N" },
+	{ "global-tags", 'g', 0, G_OPTION_ARG_FILENAME, &global_tags_file,
+		"Global tags file to load into the workspace", "FILE" },
+	{ "global-lang", 'l', 0, G_OPTION_ARG_STRING, &global_tags_lang,
+		"Language of the global tags file (default: C)", "NAME" },
+	{ NULL, 0, 0, 0, NULL, NULL, NULL }
+};
+
+
+/* Prints one result. The fields are the same for all benchmarks so results of different
+ * builds can be compared by (suite, benchmark, case). */
+static void report(const gchar *benchmark, const gchar *name, guint count,
+		gdouble seconds, gdouble value, const gchar *unit)
+{
+	printf("{\"suite\": \"tagmanager\", \"benchmark\": \"%s\", \"case\": \"%s\", "
+		"\"count\": %u, \"seconds\": %.6f, \"value\": %.3f, \"unit\": \"%s\"}\n",
+		benchmark, name, count, seconds, value, unit);
+	fflush(stdout);
+}
+
+
+static gint compare_lang_stats(gconstpointer a, gconstpointer b)
+{
+	const LangStats *sa = *(const LangStats **) a;
+	const LangStats *sb = *(const LangStats **) b;
+
+	return strcmp(sa->name, sb->name);
+}
+
+
+static void bench_parse(GPtrArray *files)
+{
+	GHashTable *langs = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+	GPtrArray *sorted = g_ptr_array_new();
+	GTimer *timer = g_timer_new();
+	GHashTableIter iter;
+	gpointer value;
+	guint i;
+
+	for (i = 0; i < files->len; i++)
+	{
+		BenchFile *file = g_ptr_array_index(files, i);
+		TMSourceFile *source_file = TM_SOURCE_FILE(file->source_file);
+		LangStats *stats;
+		const gchar *name;
+		gint n;
+
+		g_timer_start(timer);
+		for (n = 0; n < iterations; n++)
+			tm_source_file_buffer_parse(source_file, (guchar *) file->contents, file->length);
+		g_timer_stop(timer);
+
+		if (source_file->lang < 0)
+			continue;
+
+		name = tm_source_file_get_lang_name(source_file->lang);
+		stats = g_hash_table_lookup(langs, name);
+		if (stats == NULL)
+		{
+			stats = g_new0(LangStats, 1);
+			stats->name = name;
+			g_hash_table_insert(langs, (gpointer) name, stats);
+		}
+		stats->files++;
+		stats->bytes += (gdouble) file->length * iterations;
+		if (file->source_file->tags_array != NULL)
+			stats->tags += file->source_file->tags_array->len * iterations;
+		stats->seconds += g_timer_elapsed(timer, NULL);
+	}
+
+	g_hash_table_iter_init(&iter, langs);
+	while (g_hash_table_iter_next(&iter, NULL, &value))
+		g_ptr_array_add(sorted, value);
+	g_ptr_array_sort(sorted, compare_lang_stats);
+
+	for (i = 0; i < sorted->len; i++)
+	{
+		LangStats *stats = g_ptr_array_index(sorted, i);
+		gdouble seconds = MAX(stats->seconds, 1e-9);
+
+		report("parse", stats->name, stats->files, stats->seconds,
+			stats->bytes / seconds / (1024 * 1024), "MB/s");
+		report("parse-tags", stats->name, stats->files, stats->seconds,
+			stats->tags / seconds, "tags/s");
+	}
+
+	g_timer_destroy(timer);
+	g_ptr_array_free(sorted, TRUE);
+	g_hash_table_destroy(langs);
+}
+
+
+static void bench_global_tags(void)
+{
+	GTimer *timer;
+	const GPtrArray *global_tags;
+	gint lang;
+
+	if (global_tags_file == NULL)
+		return;
+
+	lang = tm_source_file_get_named_lang(global_tags_lang ? global_tags_lang : "C");
+	timer = g_timer_new();
+	if (! tm_workspace_load_global_tags(global_tags_file, lang))
+	{
+		g_warning("Could not load global tags file %s", global_tags_file);
+		g_timer_destroy(timer);
+		return;
+	}
+	g_timer_stop(timer);
+
+	global_tags = tm_get_workspace()->global_tags;
+	report("load-global-tags", global_tags_lang ? global_tags_lang : "C", global_tags->len,
+		g_timer_elapsed(timer, NULL), global_tags->len / MAX(g_timer_elapsed(timer, NULL), 1e-9),
+		"tags/s");
+	g_timer_destroy(timer);
+}
+
+
+static void bench_recreate_tags(GPtrArray *files)
+{
+	GTimer *timer = g_timer_new();
+	guint i, tags = 0;
+	gint n;
+
+	for (i = 0; i < files->len; i++)
+	{
+		BenchFile *file = g_ptr_array_index(files, i);
+
+		if (file->source_file->tags_array != NULL)
+			tags += file->source_file->tags_array->len;
+		tm_workspace_add_object(file->source_file);
+	}
+
+	g_timer_start(timer);
+	for (n = 0; n < iterations; n++)
+		tm_workspace_recreate_tags_array();
+	g_timer_stop(timer);
+
+	report("recreate-tags-array", "workspace", tags, g_timer_elapsed(timer, NULL),
+		g_timer_elapsed(timer, NULL) * 1000 / iterations, "ms");
+	g_timer_destroy(timer);
+}
+
+
+/* Collects tag names to look up, spread evenly over the workspace and global tags. */
+static GPtrArray *get_sample_names(void)
+{
+	const TMWorkspace *workspace = tm_get_workspace();
+	const GPtrArray *arrays[2];
+	GPtrArray *names = g_ptr_array_new();
+	guint i, total = 0;
+
+	arrays[0] = workspace->work_object.tags_array;
+	arrays[1] = workspace->global_tags;
+	for (i = 0; i < G_N_ELEMENTS(arrays); i++)
+	{
+		if (arrays[i] != NULL)
+			total += arrays[i]->len;
+	}
+	for (i = 0; i < G_N_ELEMENTS(arrays); i++)
+	{
+		guint j, step;
+
+		if (arrays[i] == NULL || arrays[i]->len == 0)
+			continue;
+
+		step = MAX(1, total / MAX(1, find_samples));
+		for (j = 0; j < arrays[i]->len; j += step)
+		{
+			TMTag *tag = g_ptr_array_index(arrays[i], j);
+
+			g_ptr_array_add(names, tag->name);
+		}
+	}
+	return names;
+}
+
+
+static void bench_find(gboolean partial)
+{
+	TMTagAttrType attrs[] = { tm_tag_attr_name_t, 0 };
+	GPtrArray *names = get_sample_names();
+	GTimer *timer = g_timer_new();
+	gdouble total = 0, slowest = 0;
+	guint i;
+
+	for (i = 0; i < names->len; i++)
+	{
+		gchar *name = g_ptr_array_index(names, i);
+		gdouble elapsed;
+
+		/* look up prefixes like autocompletion does */
+		if (partial)
+			name = g_strndup(name, 3);
+
+		g_timer_start(timer);
+		tm_workspace_find(name, tm_tag_max_t, attrs, partial, -1);
+		elapsed = g_timer_elapsed(timer, NULL);
+
+		total += elapsed;
+		slowest = MAX(slowest, elapsed);
+		if (partial)
+			g_free(name);
+	}
+
+	if (names->len > 0)
+	{
+		const gchar *name = partial ? "partial" : "exact";
+
+		report("find", name, names->len, total, total * 1e6 / names->len, "us");
+		report("find-max", name, names->len, total, slowest * 1e6, "us");
+	}
+	g_timer_destroy(timer);
+	g_ptr_array_free(names, TRUE);
+}
+
+
+static BenchFile *bench_file_new(const gchar *filename)
+{
+	BenchFile *file = g_new0(BenchFile, 1);
+	GError *error = NULL;
+
+	if (! g_file_get_contents(filename, &file->contents, &file->length, &error))
+	{
+		g_warning("%s", error->message);
+		g_error_free(error);
+		g_free(file);
+		return NULL;
+	}
+	file->source_file = tm_source_file_new(filename, FALSE, NULL);
+	if (file->source_file == NULL || file->length == 0)
+	{
+		g_free(file->contents);
+		g_free(file);
+		return NULL;
+	}
+	return file;
+}
+
+
+int main(int argc, char **argv)
+{
+	GOptionContext *context;
+	GError *error = NULL;
+	GPtrArray *files;
+	gint i;
+
+	context = g_option_context_new("FILE...");
+	g_option_context_set_summary(context,
+		"Measures tag manager performance, printing one JSON object per result.");
+	g_option_context_add_main_entries(context, entries, NULL);
+	if (! g_option_context_parse(context, &argc, &argv, &error))
+	{
+		fprintf(stderr, "%s\n", error->message);
+		return 1;
+	}
+	g_option_context_free(context);
+	iterations = MAX(1, iterations);
+
+	/* creates the workspace */
+	tm_get_workspace();
+
+	files = g_ptr_array_new();
+	for (i = 1; i < argc; i++)
+	{
+		BenchFile *file = bench_file_new(argv[i]);
+
+		if (file != NULL)
+			g_ptr_array_add(files, file);
+	}
+	if (files->len == 0)
+	{
+		fprintf(stderr, "No files to parse.\n");
+		return 1;
+	}
+
+	bench_parse(files);
+	bench_global_tags();
+	bench_recreate_tags(files);
+	bench_find(FALSE);
+	bench_find(TRUE);
+	return 0;
+}
@@ -9,6 +9,7 @@
 #include <stddef.h>
 #include <math.h>
 
+#include <string>
 #include <vector>
 #include <map>
 
@@ -148,6 +149,9 @@ static void FontMutexUnlock() {
 class FontHandle {
 	XYPOSITION width[128];
 	encodingType et;
+	// Width of every printable ASCII character when they are all the same, otherwise 0
+	XYPOSITION widthMonospace;
+	bool monospaceChecked;
 public:
 	int ascent;
 	PangoFontDescription *pfd;
@@ -172,6 +176,8 @@ public:
 		for (int i=0; i<=127; i++) {
 			width[i] = 0;
 		}
+		widthMonospace = 0;
+		monospaceChecked = false;
 	}
 	XYPOSITION CharWidth(unsigned char ch, encodingType et_) {
 		XYPOSITION w = 0;
@@ -192,6 +198,22 @@ public:
 			FontMutexUnlock();
 		}
 	}
+	bool MonospaceWidth(encodingType et_, XYPOSITION &w) {
+		FontMutexLock();
+		bool checked = monospaceChecked && (et == et_);
+		w = widthMonospace;
+		FontMutexUnlock();
+		return checked;
+	}
+	void SetMonospaceWidth(XYPOSITION w, encodingType et_) {
+		FontMutexLock();
+		if (et != et_) {
+			ResetWidths(et_);
+		}
+		widthMonospace = w;
+		monospaceChecked = true;
+		FontMutexUnlock();
+	}
 };
 
 // X has a 16 bit coordinate space, so stop drawing here to avoid wrapping
@@ -365,6 +387,7 @@ class SurfaceImpl : public Surface {
 	Converter conv;
 	int characterSet;
 	void SetConverter(int characterSet_);
+	XYPOSITION MonospaceWidth(Font &font_);
 public:
 	SurfaceImpl();
 	virtual ~SurfaceImpl();
@@ -975,6 +998,52 @@ public:
 	}
 };
 
+static bool IsPrintableASCII(const char *s, int len) {
+	for (int i = 0; i < len; i++) {
+		if ((s[i] < ' ') || (s[i] > '~'))
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Return the width shared by all the printable ASCII characters of a font or 0
+ * when their widths differ or some of them form ligatures. Measured once for
+ * each font so that runs of ASCII text in monospaced fonts need no Pango call.
+ * Ligatures are looked for in the pairs that programming and text fonts join.
+ */
+XYPOSITION SurfaceImpl::MonospaceWidth(Font &font_) {
+	XYPOSITION widthMonospace = 0;
+	if ((et == dbcs) || PFont(font_)->MonospaceWidth(et, widthMonospace))
+		return widthMonospace;
+	std::string ascii;
+	for (char ch = ' '; ch <= '~'; ch++)
+		ascii += ch;
+	ascii += " -> => <= >= == != === !== <> :: && || ++ -- << >> // /* */ ## ... www ";
+	ascii += "fi fl ff ffi ffl Th";
+	const int lenASCII = static_cast<int>(ascii.length());
+	pango_layout_set_font_description(layout, PFont(font_)->pfd);
+	pango_layout_set_text(layout, ascii.c_str(), lenASCII);
+	bool monospace = true;
+	int clusterStart = 0;
+	ClusterIterator iti(layout, lenASCII);
+	while (!iti.finished) {
+		iti.Next();
+		if (iti.curIndex != clusterStart + 1) {
+			monospace = false;
+		} else if (clusterStart == 0) {
+			widthMonospace = iti.distance;
+		} else if (fabs(iti.distance - widthMonospace) > 0.001) {
+			monospace = false;
+		}
+		clusterStart = iti.curIndex;
+	}
+	if (!monospace)
+		widthMonospace = 0;
+	PFont(font_)->SetMonospaceWidth(widthMonospace, et);
+	return widthMonospace;
+}
+
 void SurfaceImpl::MeasureWidths(Font &font_, const char *s, int len, XYPOSITION *positions) {
 	if (font_.GetID()) {
 		const int lenPositions = len;
@@ -986,6 +1055,14 @@ void SurfaceImpl::MeasureWidths(Font &font_, const char *s, int len, XYPOSITION
 					return;
 				}
 			}
+			if (IsPrintableASCII(s, len)) {
+				const XYPOSITION widthMonospace = MonospaceWidth(font_);
+				if (widthMonospace > 0) {
+					for (int i = 0; i < len; i++)
+						positions[i] = widthMonospace * (i + 1);
+					return;
+				}
+			}
 			pango_layout_set_font_description(layout, PFont(font_)->pfd);
 			if (et == UTF8) {
 				// Simple and direct as UTF-8 is native Pango encoding
@@ -1081,6 +1158,11 @@ void SurfaceImpl::MeasureWidths(Font &font_, const char *s, int len, XYPOSITION
 XYPOSITION SurfaceImpl::WidthText(Font &font_, const char *s, int len) {
 	if (font_.GetID()) {
 		if (PFont(font_)->pfd) {
+			if (IsPrintableASCII(s, len)) {
+				const XYPOSITION widthMonospace = MonospaceWidth(font_);
+				if (widthMonospace > 0)
+					return widthMonospace * len;
+			}
 			char *utfForm = 0;
 			pango_layout_set_font_description(layout, PFont(font_)->pfd);
 			PangoRectangle pos;
@@ -1382,6 +1464,15 @@ enum {
 	N_COLUMNS
 };
 
+struct ListItem {
+	int start;	// Offset of the text in ListBoxX::itemText
+	int type;	// Registered image or -1
+};
+
+/* The tree view shows the items of a ListBoxX through a ListModel, which reads
+them from the list box on demand. Lists are held in two arrays instead of a
+GtkListStore so long lists can be replaced without creating a row object for
+each item, and the view only asks for the text of the rows it draws. */
 class ListBoxX : public ListBox {
 	WindowID list;
 	WindowID scroller;
@@ -1391,13 +1482,22 @@ class ListBoxX : public ListBox {
 	int desiredVisibleRows;
 	unsigned int maxItemCharacters;
 	unsigned int aveCharWidth;
+	std::vector<char> itemText;
+	std::vector<ListItem> items;
+	int stamp;
+
+	GtkTreeModel *DetachModel();
+	void AttachModel(GtkTreeModel *model);
+	void ClearItems();
+	void AddItem(const char *s, int len, int type);
+	void ReserveImageWidth(int n);
 public:
 	CallBackAction doubleClickAction;
 	void *doubleClickActionData;
 
 	ListBoxX() : list(0), scroller(0), pixhash(NULL), pixbuf_renderer(0),
 		desiredVisibleRows(5), maxItemCharacters(0),
-		aveCharWidth(1), doubleClickAction(NULL), doubleClickActionData(NULL) {
+		aveCharWidth(1), stamp(1), doubleClickAction(NULL), doubleClickActionData(NULL) {
 	}
 	virtual ~ListBoxX() {
 		if (pixhash) {
@@ -1428,8 +1528,157 @@ public:
 		doubleClickActionData = data;
 	}
 	virtual void SetList(const char *listText, char separator, char typesep);
+
+	// Access to the items for ListModel
+	int ItemCount() const {
+		return static_cast<int>(items.size());
+	}
+	const char *ItemText(int n) const {
+		return &itemText[items[n].start];
+	}
+	GdkPixbuf *ItemImage(int n);
+	int Stamp() const {
+		return stamp;
+	}
+};
+
+struct ListModel {
+	GObject parent;
+	ListBoxX *lb;
 };
 
+static ListBoxX *ListModelOwner(GtkTreeModel *model) {
+	return reinterpret_cast<ListModel *>(model)->lb;
+}
+
+static bool ListModelIter(GtkTreeModel *model, GtkTreeIter *iter, int n) {
+	ListBoxX *lb = ListModelOwner(model);
+	if (n < 0 || n >= lb->ItemCount()) {
+		iter->stamp = 0;
+		return false;
+	}
+	iter->stamp = lb->Stamp();
+	iter->user_data = GINT_TO_POINTER(n);
+	iter->user_data2 = NULL;
+	iter->user_data3 = NULL;
+	return true;
+}
+
+static int ListModelIndex(GtkTreeIter *iter) {
+	return GPOINTER_TO_INT(iter->user_data);
+}
+
+static GtkTreeModelFlags ListModelGetFlags(GtkTreeModel *) {
+	return GTK_TREE_MODEL_LIST_ONLY;
+}
+
+static gint ListModelGetNColumns(GtkTreeModel *) {
+	return N_COLUMNS;
+}
+
+static GType ListModelGetColumnType(GtkTreeModel *, gint column) {
+	return (column == PIXBUF_COLUMN) ? GDK_TYPE_PIXBUF : G_TYPE_STRING;
+}
+
+static gboolean ListModelGetIter(GtkTreeModel *model, GtkTreeIter *iter, GtkTreePath *path) {
+	if (gtk_tree_path_get_depth(path) != 1)
+		return FALSE;
+	return ListModelIter(model, iter, gtk_tree_path_get_indices(path)[0]);
+}
+
+static GtkTreePath *ListModelGetPath(GtkTreeModel *, GtkTreeIter *iter) {
+	GtkTreePath *path = gtk_tree_path_new();
+	gtk_tree_path_append_index(path, ListModelIndex(iter));
+	return path;
+}
+
+static void ListModelGetValue(GtkTreeModel *model, GtkTreeIter *iter, gint column, GValue *value) {
+	ListBoxX *lb = ListModelOwner(model);
+	int n = ListModelIndex(iter);
+	g_value_init(value, ListModelGetColumnType(model, column));
+	if (iter->stamp != lb->Stamp() || n >= lb->ItemCount())
+		return;
+	if (column == PIXBUF_COLUMN)
+		g_value_set_object(value, lb->ItemImage(n));
+	else
+		g_value_set_string(value, lb->ItemText(n));
+}
+
+static gboolean ListModelIterNext(GtkTreeModel *model, GtkTreeIter *iter) {
+	return ListModelIter(model, iter, ListModelIndex(iter) + 1);
+}
+
+static gboolean ListModelIterChildren(GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *parent) {
+	if (parent)
+		return FALSE;
+	return ListModelIter(model, iter, 0);
+}
+
+static gboolean ListModelIterHasChild(GtkTreeModel *, GtkTreeIter *) {
+	return FALSE;
+}
+
+static gint ListModelIterNChildren(GtkTreeModel *model, GtkTreeIter *iter) {
+	if (iter)
+		return 0;
+	return ListModelOwner(model)->ItemCount();
+}
+
+static gboolean ListModelIterNthChild(GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *parent, gint n) {
+	if (parent)
+		return FALSE;
+	return ListModelIter(model, iter, n);
+}
+
+static gboolean ListModelIterParent(GtkTreeModel *, GtkTreeIter *, GtkTreeIter *) {
+	return FALSE;
+}
+
+static void ListModelInterfaceInit(GtkTreeModelIface *iface) {
+	iface->get_flags = ListModelGetFlags;
+	iface->get_n_columns = ListModelGetNColumns;
+	iface->get_column_type = ListModelGetColumnType;
+	iface->get_iter = ListModelGetIter;
+	iface->get_path = ListModelGetPath;
+	iface->get_value = ListModelGetValue;
+	iface->iter_next = ListModelIterNext;
+	iface->iter_children = ListModelIterChildren;
+	iface->iter_has_child = ListModelIterHasChild;
+	iface->iter_n_children = ListModelIterNChildren;
+	iface->iter_nth_child = ListModelIterNthChild;
+	iface->iter_parent = ListModelIterParent;
+}
+
+static GType ListModelGetType() {
+	static GType list_model_type = 0;
+	if (!list_model_type) {
+		list_model_type = g_type_from_name("ScintillaListModel");
+		if (!list_model_type) {
+			static const GTypeInfo list_model_info = {
+				(guint16) sizeof (GObjectClass),
+				NULL, //(GBaseInitFunc)
+				NULL, //(GBaseFinalizeFunc)
+				NULL, //(GClassInitFunc)
+				NULL, //(GClassFinalizeFunc)
+				NULL, //gconstpointer data
+				(guint16) sizeof (ListModel),
+				0, //n_preallocs
+				NULL, //(GInstanceInitFunc)
+				NULL //(GTypeValueTable*)
+			};
+			static const GInterfaceInfo tree_model_info = {
+				(GInterfaceInitFunc) ListModelInterfaceInit,
+				NULL, //(GInterfaceFinalizeFunc)
+				NULL //gpointer interface_data
+			};
+			list_model_type = g_type_register_static(
+				G_TYPE_OBJECT, "ScintillaListModel", &list_model_info, (GTypeFlags) 0);
+			g_type_add_interface_static(list_model_type, GTK_TYPE_TREE_MODEL, &tree_model_info);
+		}
+	}
+	return list_model_type;
+}
+
 ListBox *ListBox::Allocate() {
 	ListBoxX *lb = new ListBoxX();
 	return lb;
@@ -1512,10 +1761,11 @@ void ListBoxX::Create(Window &, int, Point, int, bool, int) {
 	gtk_widget_show(PWidget(scroller));
 
 	/* Tree and its model */
-	GtkListStore *store =
-		gtk_list_store_new(N_COLUMNS, GDK_TYPE_PIXBUF, G_TYPE_STRING);
+	GtkTreeModel *model = GTK_TREE_MODEL(g_object_new(ListModelGetType(), NULL));
+	reinterpret_cast<ListModel *>(model)->lb = this;
 
-	list = gtk_tree_view_new_with_model(GTK_TREE_MODEL(store));
+	list = gtk_tree_view_new_with_model(model);
+	g_object_unref(model);
 	g_signal_connect(G_OBJECT(list), "style-set", G_CALLBACK(StyleSet), NULL);
 
 	GtkTreeSelection *selection =
@@ -1542,8 +1792,9 @@ void ListBoxX::Create(Window &, int, Point, int, bool, int) {
 										"text", TEXT_COLUMN);
 
 	gtk_tree_view_append_column(GTK_TREE_VIEW(list), column);
-	if (g_object_class_find_property(G_OBJECT_GET_CLASS(list), "fixed-height-mode"))
-		g_object_set(G_OBJECT(list), "fixed-height-mode", TRUE, NULL);
+	// The column is fixed and the renderers have a fixed height, so the tree view
+	// only asks the model for the rows it draws instead of validating all of them
+	gtk_tree_view_set_fixed_height_mode(GTK_TREE_VIEW(list), TRUE);
 
 	GtkWidget *wid = PWidget(list);	// No code inside the G_OBJECT macro
 	gtk_container_add(GTK_CONTAINER(PWidget(scroller)), wid);
@@ -1644,10 +1895,35 @@ int ListBoxX::CaretFromEdge() {
 	return 4 + renderer_width;
 }
 
-void ListBoxX::Clear() {
+/* Takes the model away from the view while the items are replaced so the view
+rebuilds its rows once when it is attached again instead of being told about
+each row. */
+GtkTreeModel *ListBoxX::DetachModel() {
 	GtkTreeModel *model = gtk_tree_view_get_model(GTK_TREE_VIEW(list));
-	gtk_list_store_clear(GTK_LIST_STORE(model));
+	g_object_ref(model);
+	gtk_tree_view_set_model(GTK_TREE_VIEW(list), NULL);
+	return model;
+}
+
+void ListBoxX::AttachModel(GtkTreeModel *model) {
+	gtk_tree_view_set_model(GTK_TREE_VIEW(list), model);
+	g_object_unref(model);
+}
+
+void ListBoxX::ClearItems() {
+	itemText.clear();
+	items.clear();
 	maxItemCharacters = 0;
+	// Invalidate iterators on the old items, 0 marks an invalid iterator
+	stamp++;
+	if (stamp == 0)
+		stamp = 1;
+}
+
+void ListBoxX::Clear() {
+	GtkTreeModel *model = DetachModel();
+	ClearItems();
+	AttachModel(model);
 }
 
 static void init_pixmap(ListImage *list_image) {
@@ -1670,48 +1946,62 @@ static void init_pixmap(ListImage *list_image) {
 
 #define SPACING 5
 
+GdkPixbuf *ListBoxX::ItemImage(int n) {
+	int type = items[n].type;
+	if ((type < 0) || !pixhash)
+		return NULL;
+	ListImage *list_image = static_cast<ListImage *>(g_hash_table_lookup((GHashTable *) pixhash
+	             , (gconstpointer) GINT_TO_POINTER(type)));
+	if (!list_image)
+		return NULL;
+	if (NULL == list_image->pixbuf)
+		init_pixmap(list_image);
+	return list_image->pixbuf;
+}
+
+void ListBoxX::ReserveImageWidth(int n) {
+	GdkPixbuf *pixbuf = ItemImage(n);
+	if (pixbuf) {
+		gint pixbuf_width = gdk_pixbuf_get_width(pixbuf);
+		gint renderer_height, renderer_width;
+		gtk_cell_renderer_get_fixed_size(pixbuf_renderer,
+							&renderer_width, &renderer_height);
+		if (pixbuf_width > renderer_width)
+			gtk_cell_renderer_set_fixed_size(pixbuf_renderer,
+							pixbuf_width, -1);
+	}
+}
+
+void ListBoxX::AddItem(const char *s, int len, int type) {
+	ListItem item;
+	item.start = static_cast<int>(itemText.size());
+	item.type = type;
+	itemText.insert(itemText.end(), s, s + len);
+	itemText.push_back('\0');
+	items.push_back(item);
+	// Items of one type tend to be next to each other so only look at the image
+	// when the type changes.
+	if ((type >= 0) && ((items.size() == 1) || (items[items.size() - 2].type != type)))
+		ReserveImageWidth(static_cast<int>(items.size()) - 1);
+	if (maxItemCharacters < static_cast<unsigned int>(len))
+		maxItemCharacters = len;
+}
+
 void ListBoxX::Append(char *s, int type) {
-	ListImage *list_image = NULL;
-	if ((type >= 0) && pixhash) {
-		list_image = static_cast<ListImage *>(g_hash_table_lookup((GHashTable *) pixhash
-		             , (gconstpointer) GINT_TO_POINTER(type)));
-	}
+	AddItem(s, static_cast<int>(strlen(s)), type);
+	GtkTreeModel *model = gtk_tree_view_get_model(GTK_TREE_VIEW(list));
 	GtkTreeIter iter;
-	GtkListStore *store =
-		GTK_LIST_STORE(gtk_tree_view_get_model(GTK_TREE_VIEW(list)));
-	gtk_list_store_append(GTK_LIST_STORE(store), &iter);
-	if (list_image) {
-		if (NULL == list_image->pixbuf)
-			init_pixmap(list_image);
-		if (list_image->pixbuf) {
-			gtk_list_store_set(GTK_LIST_STORE(store), &iter,
-								PIXBUF_COLUMN, list_image->pixbuf,
-								TEXT_COLUMN, s, -1);
-
-			gint pixbuf_width = gdk_pixbuf_get_width(list_image->pixbuf);
-			gint renderer_height, renderer_width;
-			gtk_cell_renderer_get_fixed_size(pixbuf_renderer,
-								&renderer_width, &renderer_height);
-			if (pixbuf_width > renderer_width)
-				gtk_cell_renderer_set_fixed_size(pixbuf_renderer,
-								pixbuf_width, -1);
-		} else {
-			gtk_list_store_set(GTK_LIST_STORE(store), &iter,
-								TEXT_COLUMN, s, -1);
-		}
-	} else {
-			gtk_list_store_set(GTK_LIST_STORE(store), &iter,
-								TEXT_COLUMN, s, -1);
+	if (model && ListModelIter(model, &iter, ItemCount() - 1)) {
+		GtkTreePath *path = gtk_tree_path_new();
+		gtk_tree_path_append_index(path, ItemCount() - 1);
+		gtk_tree_model_row_inserted(model, path, &iter);
+		gtk_tree_path_free(path);
 	}
-	size_t len = strlen(s);
-	if (maxItemCharacters < len)
-		maxItemCharacters = len;
 }
 
 int ListBoxX::Length() {
 	if (wid)
-		return gtk_tree_model_iter_n_children(gtk_tree_view_get_model
-											   (GTK_TREE_VIEW(list)), NULL);
+		return ItemCount();
 	return 0;
 }
 
@@ -1792,40 +2082,21 @@ int ListBoxX::GetSelection() {
 }
 
 int ListBoxX::Find(const char *prefix) {
-	GtkTreeIter iter;
-	GtkTreeModel *model =
-		gtk_tree_view_get_model(GTK_TREE_VIEW(list));
-	bool valid = gtk_tree_model_get_iter_first(model, &iter) != FALSE;
-	int i = 0;
-	while(valid) {
-		gchar *s;
-		gtk_tree_model_get(model, &iter, TEXT_COLUMN, &s, -1);
-		if (s && (0 == strncmp(prefix, s, strlen(prefix)))) {
-			g_free(s);
+	size_t lenPrefix = strlen(prefix);
+	for (int i = 0; i < ItemCount(); i++) {
+		if (0 == strncmp(prefix, ItemText(i), lenPrefix))
 			return i;
-		}
-		g_free(s);
-		valid = gtk_tree_model_iter_next(model, &iter) != FALSE;
-		i++;
 	}
 	return -1;
 }
 
 void ListBoxX::GetValue(int n, char *value, int len) {
-	char *text = NULL;
-	GtkTreeIter iter;
-	GtkTreeModel *model = gtk_tree_view_get_model(GTK_TREE_VIEW(list));
-	bool valid = gtk_tree_model_iter_nth_child(model, &iter, NULL, n) != FALSE;
-	if (valid) {
-		gtk_tree_model_get(model, &iter, TEXT_COLUMN, &text, -1);
-	}
-	if (text && len > 0) {
-		strncpy(value, text, len);
+	if (n >= 0 && n < ItemCount() && len > 0) {
+		strncpy(value, ItemText(n), len);
 		value[len - 1] = '\0';
 	} else {
 		value[0] = '\0';
 	}
-	g_free(text);
 }
 
 // g_return_if_fail causes unnecessary compiler warning in release compile.
@@ -1870,33 +2141,25 @@ void ListBoxX::ClearRegisteredImages() {
 }
 
 void ListBoxX::SetList(const char *listText, char separator, char typesep) {
-	Clear();
-	int count = strlen(listText) + 1;
-	char *words = new char[count];
-	if (words) {
-		memcpy(words, listText, count);
-		char *startword = words;
-		char *numword = NULL;
-		int i = 0;
-		for (; words[i]; i++) {
-			if (words[i] == separator) {
-				words[i] = '\0';
-				if (numword)
-					*numword = '\0';
-				Append(startword, numword?atoi(numword + 1):-1);
-				startword = words + i + 1;
-				numword = NULL;
-			} else if (words[i] == typesep) {
-				numword = words + i;
-			}
-		}
-		if (startword) {
-			if (numword)
-				*numword = '\0';
-			Append(startword, numword?atoi(numword + 1):-1);
+	GtkTreeModel *model = DetachModel();
+	ClearItems();
+	itemText.reserve(strlen(listText) + 1);
+	const char *startword = listText;
+	for (;;) {
+		const char *endword = startword;
+		const char *numword = NULL;
+		while (*endword && *endword != separator) {
+			if (*endword == typesep)
+				numword = endword;
+			endword++;
 		}
-		delete []words;
+		AddItem(startword, static_cast<int>((numword ? numword : endword) - startword),
+			numword ? atoi(numword + 1) : -1);
+		if (!*endword)
+			break;
+		startword = endword + 1;
 	}
+	AttachModel(model);
 }
 
 Menu::Menu() : mid(0) {}
@@ -18,7 +18,9 @@ namespace Scintilla {
 	#define SCI_METHOD
 #endif
 
-enum { dvOriginal=0 };
+// Scintilla numbers its document versions upwards from dvOriginal and lexers test them
+// with >=, so dvSegments is negative to never be taken for one of them.
+enum { dvOriginal=0, dvSegments=-1 };
 
 class IDocument {
 public:
@@ -45,6 +47,14 @@ public:
 	virtual int SCI_METHOD GetLineIndentation(int line) = 0;
 };
 
+class IDocumentWithSegments : public IDocument {
+public:
+	/// Return the contiguous part of the text holding position without moving the
+	/// gap, setting segmentStart and segmentLength to its extent. The pointer stays
+	/// valid until the text is changed or BufferPointer is called.
+	virtual const char * SCI_METHOD SegmentAt(int position, int *segmentStart, int *segmentLength) const = 0;
+};
+
 enum { lvOriginal=0 };
 
 class ILexer {
@@ -439,6 +439,10 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_GETFOLDEXPANDED 2230
 #define SCI_TOGGLEFOLD 2231
 #define SCI_ENSUREVISIBLE 2232
+#define SC_FOLDACTION_CONTRACT 0
+#define SC_FOLDACTION_EXPAND 1
+#define SC_FOLDACTION_TOGGLE 2
+#define SCI_FOLDALL 2662
 #define SC_FOLDFLAG_LINEBEFORE_EXPANDED 0x0002
 #define SC_FOLDFLAG_LINEBEFORE_CONTRACTED 0x0004
 #define SC_FOLDFLAG_LINEAFTER_EXPANDED 0x0008
@@ -736,6 +740,8 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_GETCHARACTERPOINTER 2520
 #define SCI_GETRANGEPOINTER 2643
 #define SCI_GETGAPPOSITION 2644
+#define SCI_CREATESNAPSHOT 9002
+#define SCI_RELEASESNAPSHOT 9003
 #define SCI_SETKEYSUNICODE 2521
 #define SCI_GETKEYSUNICODE 2522
 #define SCI_INDICSETALPHA 2523
@@ -853,6 +859,7 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_FINDINDICATORHIDE 2642
 #define SCI_VCHOMEDISPLAY 2652
 #define SCI_VCHOMEDISPLAYEXTEND 2653
+#define SCI_GETSTYLEMEMORY 9001
 #define SCI_STARTRECORD 3001
 #define SCI_STOPRECORD 3002
 #define SCI_SETLEXER 4001
@@ -987,6 +994,14 @@ struct Sci_TextToFind {
 #define TextRange Sci_TextRange
 #define TextToFind Sci_TextToFind
 
+/* Text of a document at one moment, returned by SCI_CREATESNAPSHOT.
+ * The text is NUL terminated and stays unchanged until SCI_RELEASESNAPSHOT
+ * so it may be read by other threads. */
+struct Sci_TextSnapshot {
+	const char *text;
+	int length;
+};
+
 typedef void *Sci_SurfaceID;
 
 struct Sci_Rectangle {
@@ -15,19 +15,24 @@ namespace Scintilla {
 class LexAccessor {
 private:
 	IDocument *pAccess;
+	/// Set when the document can hand out its text without copying
+	IDocumentWithSegments *pSegments;
 	enum {extremePosition=0x7FFFFFFF};
 	/** @a bufferSize is a trade off between time taken to copy the characters
 	 * and retrieval overhead.
 	 * @a slopSize positions the buffer before the desired position
-	 * in case there is some backtracking. */
-	enum {bufferSize=4000, slopSize=bufferSize/8};
+	 * in case there is some backtracking.
+	 * @a styleBufferSize is larger so styles are sent to the document in long runs. */
+	enum {bufferSize=4000, slopSize=bufferSize/8, styleBufferSize=bufferSize*4};
 	char buf[bufferSize+1];
+	/// Either buf or a segment of the document text, holding startPos to endPos
+	const char *text;
 	int startPos;
 	int endPos;
 	int codePage;
 	int lenDoc;
 	int mask;
-	char styleBuf[bufferSize];
+	char styleBuf[styleBufferSize];
 	int validLen;
 	char chFlags;
 	char chWhile;
@@ -35,6 +40,23 @@ private:
 	int startPosStyling;
 
 	void Fill(int position) {
+		if (pSegments && (position >= 0) && (position < lenDoc)) {
+			int segmentStart = 0;
+			int segmentLength = 0;
+			const char *segment = pSegments->SegmentAt(position, &segmentStart, &segmentLength);
+			const int segmentEnd = segmentStart + segmentLength;
+			// Read the segment in place unless position is so close to the gap that
+			// looking back or ahead would keep switching between the segments.
+			if (segment && (position < segmentEnd) &&
+				((segmentStart == 0) || (position - segmentStart >= slopSize)) &&
+				((segmentEnd == lenDoc) || (segmentEnd - position >= slopSize))) {
+				text = segment;
+				startPos = segmentStart;
+				endPos = segmentEnd;
+				return;
+			}
+		}
+		text = buf;
 		startPos = position - slopSize;
 		if (startPos + bufferSize > lenDoc)
 			startPos = lenDoc - bufferSize;
@@ -48,18 +70,27 @@ private:
 		buf[endPos-startPos] = '\0';
 	}
 
+	/// Calls which notify the container may let it move the gap so the segment
+	/// is looked up again after them.
+	void ReleaseSegment() {
+		if (text != buf)
+			startPos = extremePosition;
+	}
+
 public:
 	LexAccessor(IDocument *pAccess_) :
-		pAccess(pAccess_), startPos(extremePosition), endPos(0),
+		pAccess(pAccess_), pSegments(0), text(buf), startPos(extremePosition), endPos(0),
 		codePage(pAccess->CodePage()), lenDoc(pAccess->Length()),
 		mask(127), validLen(0), chFlags(0), chWhile(0),
 		startSeg(0), startPosStyling(0) {
+		if (pAccess->Version() == dvSegments)
+			pSegments = static_cast<IDocumentWithSegments *>(pAccess);
 	}
 	char operator[](int position) {
 		if (position < startPos || position >= endPos) {
 			Fill(position);
 		}
-		return buf[position - startPos];
+		return text[position - startPos];
 	}
 	/** Safe version of operator[], returning a defined value for invalid position. */
 	char SafeGetCharAt(int position, char chDefault=' ') {
@@ -70,7 +101,7 @@ public:
 				return chDefault;
 			}
 		}
-		return buf[position - startPos];
+		return text[position - startPos];
 	}
 	bool IsLeadByte(char ch) {
 		return pAccess->IsDBCSLeadByte(ch);
@@ -111,7 +142,9 @@ public:
 		return pAccess->GetLineState(line);
 	}
 	int SetLineState(int line, int state) {
-		return pAccess->SetLineState(line, state);
+		const int stateOld = pAccess->SetLineState(line, state);
+		ReleaseSegment();
+		return stateOld;
 	}
 	// Style setting
 	void StartAt(unsigned int start, char chMask=31) {
@@ -138,33 +171,37 @@ public:
 				return;
 			}
 
-			if (validLen + (pos - startSeg + 1) >= bufferSize)
+			const int lengthSeg = pos - startSeg + 1;
+			if (validLen + lengthSeg >= styleBufferSize)
 				Flush();
-			if (validLen + (pos - startSeg + 1) >= bufferSize) {
+			if (validLen + lengthSeg >= styleBufferSize) {
 				// Too big for buffer so send directly
-				pAccess->SetStyleFor(pos - startSeg + 1, static_cast<char>(chAttr));
+				pAccess->SetStyleFor(lengthSeg, static_cast<char>(chAttr));
+				ReleaseSegment();
 			} else {
 				if (chAttr != chWhile)
 					chFlags = 0;
 				chAttr = static_cast<char>(chAttr | chFlags);
-				for (unsigned int i = startSeg; i <= pos; i++) {
-					assert((startPosStyling + validLen) < Length());
-					styleBuf[validLen++] = static_cast<char>(chAttr);
-				}
+				assert((startPosStyling + validLen + lengthSeg) <= Length());
+				memset(styleBuf + validLen, chAttr, lengthSeg);
+				validLen += lengthSeg;
 			}
 		}
 		startSeg = pos+1;
 	}
 	void SetLevel(int line, int level) {
 		pAccess->SetLevel(line, level);
+		ReleaseSegment();
 	}
 	void IndicatorFill(int start, int end, int indicator, int value) {
 		pAccess->DecorationSetCurrentIndicator(indicator);
 		pAccess->DecorationFillRange(start, value, end - start);
+		ReleaseSegment();
 	}
 
 	void ChangeLexerState(int start, int end) {
 		pAccess->ChangeLexerState(start, end);
+		ReleaseSegment();
 	}
 };
 
@@ -83,9 +83,22 @@ void WordList::Clear() {
 		delete []list;
 		delete []words;
 	}
+	delete []hashWords;
 	words = 0;
 	list = 0;
 	len = 0;
+	hashWords = 0;
+	hashMask = 0;
+}
+
+/// FNV-1a hash of a nul terminated string.
+static unsigned int HashWord(const char *s) {
+	unsigned int hash = 2166136261u;
+	for (; *s; s++) {
+		hash ^= static_cast<unsigned char>(*s);
+		hash *= 16777619u;
+	}
+	return hash;
 }
 
 #ifdef _MSC_VER
@@ -122,6 +135,23 @@ void WordList::Set(const char *s) {
 		unsigned char indexChar = words[l][0];
 		starts[indexChar] = l;
 	}
+	// Keyword sets may hold tens of thousands of type names so exact matches are found
+	// through a hash table kept at most half full rather than by scanning every word
+	// with the same first character.
+	unsigned int hashSize = 16;
+	while (hashSize < static_cast<unsigned int>(len) * 2)
+		hashSize *= 2;
+	hashWords = new int[hashSize];
+	hashMask = hashSize - 1;
+	for (unsigned int h = 0; h < hashSize; h++)
+		hashWords[h] = -1;
+	for (int w = 0; w < len; w++) {
+		unsigned int slot = HashWord(words[w]) & hashMask;
+		while (hashWords[slot] >= 0 && strcmp(words[hashWords[slot]], words[w]) != 0)
+			slot = (slot + 1) & hashMask;
+		if (hashWords[slot] < 0)
+			hashWords[slot] = w;
+	}
 }
 
 /** Check whether a string is in the list.
@@ -132,24 +162,13 @@ void WordList::Set(const char *s) {
 bool WordList::InList(const char *s) const {
 	if (0 == words)
 		return false;
-	unsigned char firstChar = s[0];
-	int j = starts[firstChar];
-	if (j >= 0) {
-		while (static_cast<unsigned char>(words[j][0]) == firstChar) {
-			if (s[1] == words[j][1]) {
-				const char *a = words[j] + 1;
-				const char *b = s + 1;
-				while (*a && *a == *b) {
-					a++;
-					b++;
-				}
-				if (!*a && !*b)
-					return true;
-			}
-			j++;
-		}
+	unsigned int slot = HashWord(s) & hashMask;
+	while (hashWords[slot] >= 0) {
+		if (strcmp(words[hashWords[slot]], s) == 0)
+			return true;
+		slot = (slot + 1) & hashMask;
 	}
-	j = starts['^'];
+	int j = starts['^'];
 	if (j >= 0) {
 		while (words[j][0] == '^') {
 			const char *a = words[j] + 1;
@@ -22,8 +22,10 @@ public:
 	int len;
 	bool onlyLineEnds;	///< Delimited by any white space or only line ends
 	int starts[256];
+	int *hashWords;	///< Open addressing table of indices into words, -1 when empty
+	unsigned int hashMask;	///< Size of hashWords minus one, the size is a power of two
 	WordList(bool onlyLineEnds_ = false) :
-		words(0), list(0), len(0), onlyLineEnds(onlyLineEnds_)
+		words(0), list(0), len(0), onlyLineEnds(onlyLineEnds_), hashWords(0), hashMask(0)
 		{}
 	~WordList() { Clear(); }
 	operator bool() const { return len ? true : false; }
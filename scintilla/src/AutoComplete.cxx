@@ -141,50 +141,45 @@ void AutoComplete::Move(int delta) {
 	lb->Select(current);
 }
 
+int AutoComplete::CompareItem(const char *word, size_t lenWord, int item) const {
+	char value[maxItemLen];
+	lb->GetValue(item, value, maxItemLen);
+	if (ignoreCase)
+		return CompareNCaseInsensitive(word, value, lenWord);
+	else
+		return strncmp(word, value, lenWord);
+}
+
 void AutoComplete::Select(const char *word) {
 	size_t lenWord = strlen(word);
 	int location = -1;
-	int start = 0; // lower bound of the api array block to search
-	int end = lb->Length() - 1; // upper bound of the api array block to search
-	while ((start <= end) && (location == -1)) { // Binary searching loop
-		int pivot = (start + end) / 2;
-		char item[maxItemLen];
-		lb->GetValue(pivot, item, maxItemLen);
-		int cond;
-		if (ignoreCase)
-			cond = CompareNCaseInsensitive(word, item, lenWord);
+	int count = lb->Length();
+	// Binary search for the first item starting with word, so long lists with many
+	// matches for a short word are not walked back one item at a time.
+	int start = 0;
+	int end = count;
+	while (start < end) {
+		int pivot = start + (end - start) / 2;
+		if (CompareItem(word, lenWord, pivot) > 0)
+			start = pivot + 1;
 		else
-			cond = strncmp(word, item, lenWord);
-		if (!cond) {
-			// Find first match
-			while (pivot > start) {
-				lb->GetValue(pivot-1, item, maxItemLen);
-				if (ignoreCase)
-					cond = CompareNCaseInsensitive(word, item, lenWord);
-				else
-					cond = strncmp(word, item, lenWord);
-				if (0 != cond)
+			end = pivot;
+	}
+	if (start < count && CompareItem(word, lenWord, start) == 0) {
+		location = start;
+		if (ignoreCase
+			&& ignoreCaseBehaviour == SC_CASEINSENSITIVEBEHAVIOUR_RESPECTCASE) {
+			// Check for exact-case match
+			char item[maxItemLen];
+			for (int pivot = start; pivot < count; pivot++) {
+				lb->GetValue(pivot, item, maxItemLen);
+				if (!strncmp(word, item, lenWord)) {
+					location = pivot;
 					break;
-				--pivot;
-			}
-			location = pivot;
-			if (ignoreCase
-				&& ignoreCaseBehaviour == SC_CASEINSENSITIVEBEHAVIOUR_RESPECTCASE) {
-				// Check for exact-case match
-				for (; pivot <= end; pivot++) {
-					lb->GetValue(pivot, item, maxItemLen);
-					if (!strncmp(word, item, lenWord)) {
-						location = pivot;
-						break;
-					}
-					if (CompareNCaseInsensitive(word, item, lenWord))
-						break;
 				}
+				if (CompareNCaseInsensitive(word, item, lenWord))
+					break;
 			}
-		} else if (cond < 0) {
-			end = pivot - 1;
-		} else if (cond > 0) {
-			start = pivot + 1;
 		}
 	}
 	if (location == -1 && autoHide)
@@ -22,6 +22,9 @@ class AutoComplete {
 	char typesep; // Type seperator
 	enum { maxItemLen=1000 };
 
+	/// Compare the start of an item with word as Select does
+	int CompareItem(const char *word, size_t lenWord, int item) const;
+
 public:
 
 	bool ignoreCase;
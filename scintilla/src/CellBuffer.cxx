@@ -15,6 +15,7 @@
 #include "Scintilla.h"
 #include "SplitVector.h"
 #include "Partitioning.h"
+#include "RunStyles.h"
 #include "CellBuffer.h"
 
 #ifdef SCI_NAMESPACE
@@ -53,6 +54,15 @@ void LineVector::InsertLine(int line, int position, bool lineStart) {
 	}
 }
 
+void LineVector::InsertLines(int line, const int *positions, int lines, bool lineStart) {
+	starts.InsertPartitions(line, positions, lines);
+	if (perLine) {
+		if ((line > 0) && lineStart)
+			line--;
+		perLine->InsertLines(line, lines);
+	}
+}
+
 void LineVector::SetLineStart(int line, int position) {
 	starts.SetPartitionStartPosition(line, position);
 }
@@ -329,12 +339,59 @@ void UndoHistory::CompletedRedoStep() {
 	currentAction++;
 }
 
+// Each style run costs a partition start and a value.
+static const int bytesPerStyleRun = 2 * sizeof(int);
+
+TextSnapshot::TextSnapshot(const char *text_, int length_) : refCount(1), storage(0) {
+	text = text_;
+	length = length_;
+}
+
+TextSnapshot::~TextSnapshot() {
+	delete []storage;
+	storage = 0;
+}
+
+void TextSnapshot::Release() {
+	refCount--;
+	if (refCount == 0)
+		delete this;
+}
+
 CellBuffer::CellBuffer() {
+	styleRuns = new RunStyles();
 	readOnly = false;
 	collectingUndo = true;
+	snapshot = 0;
 }
 
 CellBuffer::~CellBuffer() {
+	DetachSnapshot();
+	delete styleRuns;
+	styleRuns = 0;
+}
+
+/**
+ * Called before the storage of the text is changed. Snapshots still referenced
+ * elsewhere keep the current storage and the buffer continues with a copy.
+ */
+void CellBuffer::DetachSnapshot() {
+	if (snapshot) {
+		if (snapshot->Shared())
+			snapshot->TakeStorage(substance.DetachStorage());
+		snapshot->Release();
+		snapshot = 0;
+	}
+}
+
+TextSnapshot *CellBuffer::CreateSnapshot() {
+	if (!snapshot) {
+		// Moves the gap to the end so the text is contiguous and NUL terminated
+		const char *text = substance.BufferPointer();
+		snapshot = new TextSnapshot(text, substance.Length());
+	}
+	snapshot->AddRef();
+	return snapshot;
 }
 
 char CellBuffer::CharAt(int position) const {
@@ -355,6 +412,11 @@ void CellBuffer::GetCharRange(char *buffer, int position, int lengthRetrieve) co
 }
 
 char CellBuffer::StyleAt(int position) const {
+	if (styleRuns) {
+		if ((position < 0) || (position >= styleRuns->Length()))
+			return 0;
+		return static_cast<char>(styleRuns->ValueAt(position));
+	}
 	return style.ValueAt(position);
 }
 
@@ -363,22 +425,41 @@ void CellBuffer::GetStyleRange(unsigned char *buffer, int position, int lengthRe
 		return;
 	if (position < 0)
 		return;
-	if ((position + lengthRetrieve) > style.Length()) {
+	if ((position + lengthRetrieve) > substance.Length()) {
 		Platform::DebugPrintf("Bad GetStyleRange %d for %d of %d\n", position,
-		                      lengthRetrieve, style.Length());
+		                      lengthRetrieve, substance.Length());
+		return;
+	}
+	if (styleRuns) {
+		const int end = position + lengthRetrieve;
+		while (position < end) {
+			const int runEnd = Platform::Minimum(styleRuns->EndRun(position), end);
+			memset(buffer, styleRuns->ValueAt(position), runEnd - position);
+			buffer += runEnd - position;
+			position = runEnd;
+		}
 		return;
 	}
 	style.GetRange(reinterpret_cast<char *>(buffer), position, lengthRetrieve);
 }
 
 const char *CellBuffer::BufferPointer() {
+	// The text is already contiguous while shared with a snapshot
+	if (snapshot)
+		return snapshot->text;
 	return substance.BufferPointer();
 }
 
 const char *CellBuffer::RangePointer(int position, int rangeLength) {
+	if (snapshot)
+		return snapshot->text + position;
 	return substance.RangePointer(position, rangeLength);
 }
 
+const char *CellBuffer::ContiguousRange(int position, int &lengthContiguous) const {
+	return substance.ContiguousRange(position, lengthContiguous);
+}
+
 int CellBuffer::GapPosition() const {
 	return substance.GapPosition();
 }
@@ -405,6 +486,11 @@ const char *CellBuffer::InsertString(int position, const char *s, int insertLeng
 
 bool CellBuffer::SetStyleAt(int position, char styleValue, char mask) {
 	styleValue &= mask;
+	if (styleRuns) {
+		if ((position < 0) || (position >= styleRuns->Length()))
+			return false;
+		return SetStyleRuns(position, 1, styleValue, mask);
+	}
 	char curVal = style.ValueAt(position);
 	if ((curVal & mask) != styleValue) {
 		style.SetValueAt(position, static_cast<char>((curVal & ~mask) | styleValue));
@@ -417,7 +503,10 @@ bool CellBuffer::SetStyleAt(int position, char styleValue, char mask) {
 bool CellBuffer::SetStyleFor(int position, int lengthStyle, char styleValue, char mask) {
 	bool changed = false;
 	PLATFORM_ASSERT(lengthStyle == 0 ||
-		(lengthStyle > 0 && lengthStyle + position <= style.Length()));
+		(lengthStyle > 0 && lengthStyle + position <= Length()));
+	if (styleRuns) {
+		return SetStyleRuns(position, lengthStyle, styleValue, mask);
+	}
 	while (lengthStyle--) {
 		char curVal = style.ValueAt(position);
 		if ((curVal & mask) != styleValue) {
@@ -429,6 +518,89 @@ bool CellBuffer::SetStyleFor(int position, int lengthStyle, char styleValue, cha
 	return changed;
 }
 
+bool CellBuffer::SetStyles(int position, int lengthStyle, const char *styles, char mask,
+	int &startChanged, int &lengthChanged) {
+	const int end = Platform::Minimum(position + lengthStyle, Length());
+	int endChanged = position;
+	startChanged = end;
+	while (position < end) {
+		if (styleRuns) {
+			// Apply each run of equal styles at once
+			int runEnd = position + 1;
+			while ((runEnd < end) && (((*styles ^ styles[runEnd - position]) & mask) == 0))
+				runEnd++;
+			if (SetStyleRuns(position, runEnd - position, static_cast<char>(*styles & mask), mask)) {
+				startChanged = Platform::Minimum(startChanged, position);
+				endChanged = runEnd;
+			}
+			styles += runEnd - position;
+			position = runEnd;
+		} else {
+			// Write directly into the part of the style buffer before or after its gap
+			int lengthSegment = 0;
+			char *segment = style.ContiguousRange(position, lengthSegment);
+			if (!segment)
+				break;
+			lengthSegment = Platform::Minimum(lengthSegment, end - position);
+			for (int i = 0; i < lengthSegment; i++) {
+				const char newVal = static_cast<char>((segment[i] & ~mask) | (styles[i] & mask));
+				if (segment[i] != newVal) {
+					segment[i] = newVal;
+					startChanged = Platform::Minimum(startChanged, position + i);
+					endChanged = position + i + 1;
+				}
+			}
+			styles += lengthSegment;
+			position += lengthSegment;
+		}
+	}
+	lengthChanged = endChanged - startChanged;
+	return lengthChanged > 0;
+}
+
+bool CellBuffer::SetStyleRuns(int position, int lengthStyle, char styleValue, char mask) {
+	bool changed = false;
+	const int end = Platform::Minimum(position + lengthStyle, styleRuns->Length());
+	while (position < end) {
+		// Masked styling may change runs in different ways so work one run at a time
+		const int runEnd = Platform::Minimum(styleRuns->EndRun(position), end);
+		const char curVal = static_cast<char>(styleRuns->ValueAt(position));
+		if ((curVal & mask) != styleValue) {
+			int fillStart = position;
+			int fillLength = runEnd - position;
+			const unsigned char newVal = static_cast<unsigned char>((curVal & ~mask) | styleValue);
+			if (styleRuns->FillRange(fillStart, newVal, fillLength))
+				changed = true;
+		}
+		position = runEnd;
+	}
+	if (changed && (styleRuns->Runs() > Length() / bytesPerStyleRun)) {
+		// Styles change so often that a byte per character is smaller and faster
+		StyleRunsToBytes();
+	}
+	return changed;
+}
+
+void CellBuffer::StyleRunsToBytes() {
+	const int length = styleRuns->Length();
+	style.DeleteAll();
+	style.ReAllocate(substance.Length() + 1);
+	int position = 0;
+	while (position < length) {
+		const int runEnd = styleRuns->EndRun(position);
+		style.InsertValue(position, runEnd - position, static_cast<char>(styleRuns->ValueAt(position)));
+		position = runEnd;
+	}
+	delete styleRuns;
+	styleRuns = 0;
+}
+
+int CellBuffer::StyleMemory() const {
+	if (styleRuns)
+		return styleRuns->Runs() * bytesPerStyleRun;
+	return style.Length();
+}
+
 // The char* returned is to an allocation owned by the undo history
 const char *CellBuffer::DeleteChars(int position, int deleteLength, bool &startSequence) {
 	// InsertString and DeleteChars are the bottleneck though which all changes occur
@@ -454,8 +626,10 @@ int CellBuffer::Length() const {
 }
 
 void CellBuffer::Allocate(int newSize) {
+	DetachSnapshot();
 	substance.ReAllocate(newSize);
-	style.ReAllocate(newSize);
+	if (!styleRuns)
+		style.ReAllocate(newSize);
 }
 
 void CellBuffer::SetPerLine(PerLine *pl) {
@@ -506,8 +680,17 @@ void CellBuffer::BasicInsertString(int position, const char *s, int insertLength
 		return;
 	PLATFORM_ASSERT(insertLength > 0);
 
+	DetachSnapshot();
 	substance.InsertFromArray(position, s, 0, insertLength);
-	style.InsertValue(position, insertLength, 0);
+	if (styleRuns) {
+		styleRuns->InsertSpace(position, insertLength);
+		// Inserted text is unstyled but InsertSpace may extend the style of a neighbouring run
+		int fillStart = position;
+		int fillLength = insertLength;
+		styleRuns->FillRange(fillStart, 0, fillLength);
+	} else {
+		style.InsertValue(position, insertLength, 0);
+	}
 
 	int lineInsert = lv.LineFromPosition(position) + 1;
 	bool atLineStart = lv.LineStart(lineInsert-1) == position;
@@ -520,23 +703,34 @@ void CellBuffer::BasicInsertString(int position, const char *s, int insertLength
 		InsertLine(lineInsert, position, false);
 		lineInsert++;
 	}
+	// New line starts are gathered and added in blocks so that inserting text
+	// with many lines does not pay for a line insertion per line.
+	const int blockSize = 4000;
+	int lineStarts[blockSize];
+	int linesPending = 0;
 	char ch = ' ';
 	for (int i = 0; i < insertLength; i++) {
 		ch = s[i];
-		if (ch == '\r') {
-			InsertLine(lineInsert, (position + i) + 1, atLineStart);
-			lineInsert++;
+		if (ch == '\r' || ((ch == '\n') && (chPrev != '\r'))) {
+			if (linesPending == blockSize) {
+				lv.InsertLines(lineInsert, lineStarts, linesPending, atLineStart);
+				lineInsert += linesPending;
+				linesPending = 0;
+			}
+			lineStarts[linesPending++] = (position + i) + 1;
 		} else if (ch == '\n') {
-			if (chPrev == '\r') {
-				// Patch up what was end of line
+			// Patch up what was end of line
+			if (linesPending > 0)
+				lineStarts[linesPending - 1] = (position + i) + 1;
+			else
 				lv.SetLineStart(lineInsert - 1, (position + i) + 1);
-			} else {
-				InsertLine(lineInsert, (position + i) + 1, atLineStart);
-				lineInsert++;
-			}
 		}
 		chPrev = ch;
 	}
+	if (linesPending > 0) {
+		lv.InsertLines(lineInsert, lineStarts, linesPending, atLineStart);
+		lineInsert += linesPending;
+	}
 	// Joining two lines where last insertion is cr and following substance starts with lf
 	if (chAfter == '\n') {
 		if (ch == '\r') {
@@ -550,6 +744,8 @@ void CellBuffer::BasicDeleteChars(int position, int deleteLength) {
 	if (deleteLength == 0)
 		return;
 
+	DetachSnapshot();
+
 	if ((position == 0) && (deleteLength == substance.Length())) {
 		// If whole buffer is being deleted, faster to reinitialise lines data
 		// than to delete each line.
@@ -598,7 +794,15 @@ void CellBuffer::BasicDeleteChars(int position, int deleteLength) {
 		}
 	}
 	substance.DeleteRange(position, deleteLength);
-	style.DeleteRange(position, deleteLength);
+	if (styleRuns) {
+		styleRuns->DeleteRange(position, deleteLength);
+	} else {
+		style.DeleteRange(position, deleteLength);
+		if (substance.Length() == 0) {
+			// An emptied document starts again with runs
+			styleRuns = new RunStyles();
+		}
+	}
 }
 
 bool CellBuffer::SetUndoCollection(bool collectUndo) {
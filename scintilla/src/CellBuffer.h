@@ -13,12 +13,19 @@ namespace Scintilla {
 #endif
 
 // Interface to per-line data that wants to see each line insertion and deletion
+class RunStyles;
+
 class PerLine {
 public:
 	virtual ~PerLine() {}
 	virtual void Init()=0;
 	virtual void InsertLine(int)=0;
 	virtual void RemoveLine(int)=0;
+	/// Equivalent to calling InsertLine for each of lines successive lines from line.
+	virtual void InsertLines(int line, int lines) {
+		for (int i = 0; i < lines; i++)
+			InsertLine(line + i);
+	}
 };
 
 /**
@@ -38,6 +45,7 @@ public:
 
 	void InsertText(int line, int delta);
 	void InsertLine(int line, int position, bool lineStart);
+	void InsertLines(int line, const int *positions, int lines, bool lineStart);
 	void SetLineStart(int line, int position);
 	void RemoveLine(int line);
 	int Lines() const {
@@ -126,6 +134,31 @@ public:
 	void CompletedRedoStep();
 };
 
+/**
+ * The text of a CellBuffer at one moment. The text is shared with the buffer until
+ * the buffer is next modified; if the snapshot is still referenced then, it takes
+ * the buffer's storage and the buffer continues with a copy.
+ * The text may be read from any thread but references must only be added and
+ * released on the thread that modifies the document.
+ */
+class TextSnapshot : public Sci_TextSnapshot {
+	int refCount;
+	char *storage;	// Storage taken from the buffer or 0 while shared with it
+public:
+	TextSnapshot(const char *text_, int length_);
+	~TextSnapshot();
+	void AddRef() {
+		refCount++;
+	}
+	void Release();
+	bool Shared() const {
+		return refCount > 1;
+	}
+	void TakeStorage(char *storage_) {
+		storage = storage_;
+	}
+};
+
 /**
  * Holder for an expandable array of characters that supports undo and line markers.
  * Based on article "Data Structures in a Bit-Mapped Text Editor"
@@ -135,6 +168,9 @@ class CellBuffer {
 private:
 	SplitVector<char> substance;
 	SplitVector<char> style;
+	/// While the document has few style changes its styles are held as runs
+	/// here instead of one byte per character in style.
+	RunStyles *styleRuns;
 	bool readOnly;
 
 	bool collectingUndo;
@@ -142,10 +178,17 @@ private:
 
 	LineVector lv;
 
+	/// Snapshot of the current text, sharing the storage of substance, or 0
+	TextSnapshot *snapshot;
+	void DetachSnapshot();
+
 	/// Actions without undo
 	void BasicInsertString(int position, const char *s, int insertLength);
 	void BasicDeleteChars(int position, int deleteLength);
 
+	bool SetStyleRuns(int position, int lengthStyle, char styleValue, char mask);
+	void StyleRunsToBytes();
+
 public:
 
 	CellBuffer();
@@ -158,7 +201,11 @@ public:
 	void GetStyleRange(unsigned char *buffer, int position, int lengthRetrieve) const;
 	const char *BufferPointer();
 	const char *RangePointer(int position, int rangeLength);
+	const char *ContiguousRange(int position, int &lengthContiguous) const;
 	int GapPosition() const;
+	/// Return a referenced snapshot of the text, which is cheap while the text is
+	/// unchanged since the last snapshot.
+	TextSnapshot *CreateSnapshot();
 
 	int Length() const;
 	void Allocate(int newSize);
@@ -174,6 +221,13 @@ public:
 	/// @return true if the style of a character is changed.
 	bool SetStyleAt(int position, char styleValue, char mask='\377');
 	bool SetStyleFor(int position, int length, char styleValue, char mask);
+	/// Set the styles of a range from an array, one byte per character.
+	/// @return true if any style is changed, setting startChanged and lengthChanged
+	/// to a range covering the changes.
+	bool SetStyles(int position, int lengthStyle, const char *styles, char mask,
+		int &startChanged, int &lengthChanged);
+	/// Approximate number of bytes used to hold the styles.
+	int StyleMemory() const;
 
 	const char *DeleteChars(int position, int deleteLength, bool &startSequence);
 
@@ -7,6 +7,8 @@
 
 #include <string.h>
 
+#include <vector>
+
 #include "Platform.h"
 
 #include "SplitVector.h"
@@ -218,6 +220,56 @@ int ContractionState::ContractedNext(int lineDocStart) const {
 	}
 }
 
+static void FillRuns(RunStyles *rs, const char *values, int length) {
+	int position = 0;
+	while (position < length) {
+		int runEnd = position + 1;
+		while ((runEnd < length) && (values[runEnd] == values[position]))
+			runEnd++;
+		if (values[position]) {
+			int fillStart = position;
+			int fillLength = runEnd - position;
+			rs->FillRange(fillStart, 1, fillLength);
+		}
+		position = runEnd;
+	}
+}
+
+// Set whether every line is expanded and visible, one char for each line.
+// The structures are built again in one pass which is much faster than
+// changing one line at a time as each change moves the following display lines.
+void ContractionState::SetFoldState(const char *expandedLines, const char *visibleLines) {
+	EnsureData();
+	const int lines = LinesInDoc();
+
+	RunStyles *expandedNew = new RunStyles();
+	expandedNew->InsertSpace(0, lines);
+	FillRuns(expandedNew, expandedLines, lines);
+	RunStyles *visibleNew = new RunStyles();
+	visibleNew->InsertSpace(0, lines);
+	FillRuns(visibleNew, visibleLines, lines);
+
+	// Display line after the end of each document line
+	std::vector<int> displayEnds(lines);
+	int lineDisplay = 0;
+	for (int line = 0; line < lines; line++) {
+		if (visibleLines[line])
+			lineDisplay += heights->ValueAt(line);
+		displayEnds[line] = lineDisplay;
+	}
+	Partitioning *displayLinesNew = new Partitioning(4);
+	displayLinesNew->InsertPartitions(1, &displayEnds[0], lines);
+	displayLinesNew->InsertText(lines, lineDisplay);
+
+	delete expanded;
+	expanded = expandedNew;
+	delete visible;
+	visible = visibleNew;
+	delete displayLines;
+	displayLines = displayLinesNew;
+	Check();
+}
+
 int ContractionState::GetHeight(int lineDoc) const {
 	if (OneToOne()) {
 		return 1;
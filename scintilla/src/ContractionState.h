@@ -53,6 +53,7 @@ public:
 	bool GetExpanded(int lineDoc) const;
 	bool SetExpanded(int lineDoc, bool expanded);
 	int ContractedNext(int lineDocStart) const;
+	void SetFoldState(const char *expandedLines, const char *visibleLines);
 
 	int GetHeight(int lineDoc) const;
 	bool SetHeight(int lineDoc, int height);
@@ -29,6 +29,7 @@
 #include "Decoration.h"
 #include "Document.h"
 #include "RESearch.h"
+#include "NFARegex.h"
 #include "UniConversion.h"
 
 #ifdef SCI_NAMESPACE
@@ -60,13 +61,52 @@ void LexInterface::Colourise(int start, int end) {
 
 		if (len > 0) {
 			instance->Lex(start, len, styleStart, pdoc);
-			instance->Fold(start, len, styleStart, pdoc);
+			Fold(start, end, styleStart);
 		}
 
 		performingStyle = false;
 	}
 }
 
+/**
+ * Fold the lines from start to end which were just styled. Fold levels only depend on
+ * the text, styles and the level of the previous line, so only the lines whose text or
+ * styles changed are folded first. The following lines are folded in growing chunks
+ * until a chunk leaves every level as it was, after which the remaining lines still
+ * have the levels they would be given. Lines which were never folded are always folded.
+ */
+void LexInterface::Fold(int start, int end, int styleStart) {
+	const int endConverge = Platform::Minimum(end, pdoc->FoldedEnd());
+	const int lineDamaged = pdoc->LineFromPosition(Platform::Maximum(pdoc->FoldDamageEnd(), start));
+	int posFold = Platform::Minimum(end, pdoc->LineStart(lineDamaged + 1));
+	int chunkLines = 32;
+	bool converged = false;
+
+	instance->Fold(start, posFold - start, styleStart, pdoc);
+	while (posFold < endConverge) {
+		const int endChunk = Platform::Minimum(end,
+			pdoc->LineStart(pdoc->LineFromPosition(posFold) + chunkLines));
+		const int changes = pdoc->FoldLevelChanges();
+		instance->Fold(posFold, endChunk - posFold,
+			pdoc->StyleAt(posFold - 1) & pdoc->stylingBitsMask, pdoc);
+		posFold = endChunk;
+		if (changes == pdoc->FoldLevelChanges()) {
+			converged = true;
+			break;
+		}
+		chunkLines *= 2;
+	}
+	if (converged && (posFold < endConverge)) {
+		// Only the lines after those already folded are left
+		posFold = pdoc->LineStart(pdoc->LineFromPosition(endConverge));
+	}
+	if (posFold < end) {
+		instance->Fold(posFold, end - posFold,
+			(posFold > 0) ? (pdoc->StyleAt(posFold - 1) & pdoc->stylingBitsMask) : 0, pdoc);
+	}
+	pdoc->FoldedTo(end, converged);
+}
+
 Document::Document() {
 	refCount = 0;
 	pcf = NULL;
@@ -80,6 +120,9 @@ Document::Document() {
 	stylingBitsMask = 0x1F;
 	stylingMask = 0;
 	endStyled = 0;
+	endFoldDamaged = 0;
+	endFolded = 0;
+	foldLevelChanges = 0;
 	styleClock = 0;
 	enteredModification = 0;
 	enteredStyling = 0;
@@ -152,6 +195,13 @@ void Document::InsertLine(int line) {
 	}
 }
 
+void Document::InsertLines(int line, int lines) {
+	for (int j=0; j<ldSize; j++) {
+		if (perLineData[j])
+			perLineData[j]->InsertLines(line, lines);
+	}
+}
+
 void Document::RemoveLine(int line) {
 	for (int j=0; j<ldSize; j++) {
 		if (perLineData[j])
@@ -293,6 +343,7 @@ int Document::VCHomePosition(int position) const {
 int SCI_METHOD Document::SetLevel(int line, int level) {
 	int prev = static_cast<LineLevels *>(perLineData[ldLevels])->SetLevel(line, level, LinesTotal());
 	if (prev != level) {
+		foldLevelChanges++;
 		DocModification mh(SC_MOD_CHANGEFOLD | SC_MOD_CHANGEMARKER,
 		                   LineStart(line), 0, 0, 0, line);
 		mh.foldLevelNow = level;
@@ -733,6 +784,39 @@ int Document::SafeSegment(const char *text, int length, int lengthSegment) {
 void Document::ModifiedAt(int pos) {
 	if (endStyled > pos)
 		endStyled = pos;
+	// Without knowing what changed, all the lines after pos are folded again
+	if (endFolded > pos)
+		endFolded = pos;
+}
+
+/// Text was inserted or deleted at pos. Only the lines up to the end of the change
+/// and those whose styles then change need to be folded again.
+void Document::TextModifiedAt(int pos, int lengthInserted, int lengthDeleted) {
+	if (endStyled > pos)
+		endStyled = pos;
+	if (endFoldDamaged > pos)
+		endFoldDamaged = Platform::Maximum(pos, endFoldDamaged + lengthInserted - lengthDeleted);
+	FoldDamage(pos + lengthInserted);
+	if (endFolded > pos)
+		endFolded = Platform::Maximum(pos, endFolded + lengthInserted - lengthDeleted);
+}
+
+void Document::FoldDamage(int pos) {
+	if (endFoldDamaged < pos)
+		endFoldDamaged = pos;
+}
+
+/// Lines before pos have been folded. When the levels were still changing at pos, the
+/// lines after it have to be folded again as well.
+void Document::FoldedTo(int pos, bool converged) {
+	const int lineStart = LineStart(LineFromPosition(pos));
+	if (!converged || (endFolded < pos))
+		endFolded = pos;
+	// A line ending after pos was folded from part of its text so it is folded again
+	if ((pos > lineStart) && (pos < Length()))
+		endFolded = lineStart;
+	if (endFoldDamaged <= pos)
+		endFoldDamaged = 0;
 }
 
 void Document::CheckReadOnly() {
@@ -769,9 +853,9 @@ bool Document::DeleteChars(int pos, int len) {
 			if (startSavePoint && cb.IsCollectingUndo())
 				NotifySavePoint(!startSavePoint);
 			if ((pos < Length()) || (pos == 0))
-				ModifiedAt(pos);
+				TextModifiedAt(pos, 0, len);
 			else
-				ModifiedAt(pos-1);
+				TextModifiedAt(pos-1, 0, len);
 			NotifyModified(
 			    DocModification(
 			        SC_MOD_DELETETEXT | SC_PERFORMED_USER | (startSequence?SC_STARTACTION:0),
@@ -807,7 +891,7 @@ bool Document::InsertString(int position, const char *s, int insertLength) {
 			const char *text = cb.InsertString(position, s, insertLength, startSequence);
 			if (startSavePoint && cb.IsCollectingUndo())
 				NotifySavePoint(!startSavePoint);
-			ModifiedAt(position);
+			TextModifiedAt(position, insertLength, 0);
 			NotifyModified(
 			    DocModification(
 			        SC_MOD_INSERTTEXT | SC_PERFORMED_USER | (startSequence?SC_STARTACTION:0),
@@ -1055,6 +1139,13 @@ int SCI_METHOD Document::GetLineIndentation(int line) {
 	return indent;
 }
 
+const char * SCI_METHOD Document::SegmentAt(int position, int *segmentStart, int *segmentLength) const {
+	// The text is held in two parts, before and after the gap
+	const int gap = cb.GapPosition();
+	*segmentStart = (position < gap) ? 0 : gap;
+	return cb.ContiguousRange(*segmentStart, *segmentLength);
+}
+
 void Document::SetLineIndentation(int line, int indent) {
 	int indentOfLine = GetLineIndentation(line);
 	if (indent < 0)
@@ -1441,6 +1532,104 @@ void Document::SetCaseFolder(CaseFolder *pcf_) {
 	pcf = pcf_;
 }
 
+/**
+ * Forward search for a literal pattern that matches byte by byte, either exactly or
+ * through a single byte case folding.
+ * Works on the contiguous segments either side of the gap so the buffer is not
+ * rearranged. Case sensitive searches scan for the first byte with memchr and
+ * case insensitive searches use Boyer-Moore-Horspool over the folded pattern.
+ * Word options are only checked at candidate positions.
+ */
+long Document::FindTextForwardLiteral(int startPos, int endPos, const char *search, int lengthFind,
+	bool caseSensitive, bool word, bool wordStart) {
+	unsigned char foldTable[256];
+	for (int ch = 0; ch < 256; ch++) {
+		if (caseSensitive) {
+			foldTable[ch] = static_cast<unsigned char>(ch);
+		} else {
+			const char chIn = static_cast<char>(ch);
+			char folded[2];
+			pcf->Fold(folded, sizeof(folded), &chIn, 1);
+			foldTable[ch] = static_cast<unsigned char>(folded[0]);
+		}
+	}
+	std::vector<unsigned char> pattern(lengthFind);
+	for (int i = 0; i < lengthFind; i++)
+		pattern[i] = foldTable[static_cast<unsigned char>(search[i])];
+
+	// Skip distances indexed by unfolded document byte
+	int skip[256];
+	if (!caseSensitive) {
+		int skipFolded[256];
+		for (int ch = 0; ch < 256; ch++)
+			skipFolded[ch] = lengthFind;
+		for (int i = 0; i < lengthFind - 1; i++)
+			skipFolded[pattern[i]] = lengthFind - 1 - i;
+		for (int ch = 0; ch < 256; ch++)
+			skip[ch] = skipFolded[foldTable[ch]];
+	}
+
+	const char chFirst = search[0];
+	const unsigned char chLast = pattern[lengthFind - 1];
+	const int endSearch = endPos - lengthFind + 1;
+	int pos = startPos;
+	while (pos < endSearch) {
+		int lengthSegment = 0;
+		const char *segment = cb.ContiguousRange(pos, lengthSegment);
+		const int lengthAvailable = Platform::Minimum(lengthSegment, endPos - pos);
+		if (lengthAvailable >= lengthFind) {
+			// All candidates in [pos, pos + lastOffset] lie wholly within this segment
+			const int lastOffset = lengthAvailable - lengthFind;
+			int offset = 0;
+			if (caseSensitive) {
+				while (offset <= lastOffset) {
+					const char *candidate = static_cast<const char *>(
+						memchr(segment + offset, chFirst, lastOffset - offset + 1));
+					if (!candidate) {
+						offset = lastOffset + 1;
+						break;
+					}
+					offset = static_cast<int>(candidate - segment);
+					if ((memcmp(candidate + 1, search + 1, lengthFind - 1) == 0) &&
+						MatchesWordOptions(word, wordStart, pos + offset, lengthFind)) {
+						return pos + offset;
+					}
+					offset++;
+				}
+			} else {
+				const unsigned char *text = reinterpret_cast<const unsigned char *>(segment);
+				while (offset <= lastOffset) {
+					const unsigned char chText = text[offset + lengthFind - 1];
+					if (foldTable[chText] == chLast) {
+						int indexSearch = lengthFind - 2;
+						while ((indexSearch >= 0) &&
+							(foldTable[text[offset + indexSearch]] == pattern[indexSearch]))
+							indexSearch--;
+						if ((indexSearch < 0) &&
+							MatchesWordOptions(word, wordStart, pos + offset, lengthFind)) {
+							return pos + offset;
+						}
+					}
+					offset += skip[chText];
+				}
+			}
+			pos += offset;
+		} else {
+			// Candidate straddles the gap so compare through CharAt
+			bool found = true;
+			for (int indexSearch = 0; (indexSearch < lengthFind) && found; indexSearch++) {
+				found = foldTable[static_cast<unsigned char>(CharAt(pos + indexSearch))] ==
+					pattern[indexSearch];
+			}
+			if (found && MatchesWordOptions(word, wordStart, pos, lengthFind)) {
+				return pos;
+			}
+			pos++;
+		}
+	}
+	return -1;
+}
+
 /**
  * Find text in document, supporting both forward and backward
  * searches (just pass minPos > maxPos to do a backward search)
@@ -1474,7 +1663,15 @@ long Document::FindText(int minPos, int maxPos, const char *search,
 			// Back all of a character
 			pos = NextPosition(pos, increment);
 		}
-		if (caseSensitive) {
+		if (forward && (caseSensitive ?
+			(!dbcsCodePage || ((SC_CP_UTF8 == dbcsCodePage) &&
+				!UTF8IsTrailByte(static_cast<unsigned char>(search[0])))) :
+			!dbcsCodePage)) {
+			// Byte matching finds the same positions as stepping by character here since
+			// the pattern can not start inside a UTF-8 sequence.
+			return FindTextForwardLiteral(startPos, endPos, search, lengthFind,
+				caseSensitive, word, wordStart);
+		} else if (caseSensitive) {
 			const int endSearch = (startPos <= endPos) ? endPos - lengthFind + 1 : endPos;
 			const char charStartSearch =  search[0];
 			while (forward ? (pos < endSearch) : (pos >= endSearch)) {
@@ -1662,6 +1859,7 @@ bool SCI_METHOD Document::SetStyleFor(int length, char style) {
 		style &= stylingMask;
 		int prevEndStyled = endStyled;
 		if (cb.SetStyleFor(endStyled, length, style, stylingMask)) {
+			FoldDamage(prevEndStyled + length);
 			DocModification mh(SC_MOD_CHANGESTYLE | SC_PERFORMED_USER,
 			                   prevEndStyled, length);
 			NotifyModified(mh);
@@ -1677,24 +1875,16 @@ bool SCI_METHOD Document::SetStyles(int length, const char *styles) {
 		return false;
 	} else {
 		enteredStyling++;
-		bool didChange = false;
+		PLATFORM_ASSERT(endStyled + length <= Length());
 		int startMod = 0;
-		int endMod = 0;
-		for (int iPos = 0; iPos < length; iPos++, endStyled++) {
-			PLATFORM_ASSERT(endStyled < Length());
-			if (cb.SetStyleAt(endStyled, styles[iPos], stylingMask)) {
-				if (!didChange) {
-					startMod = endStyled;
-				}
-				didChange = true;
-				endMod = endStyled;
-			}
-		}
-		if (didChange) {
+		int lengthMod = 0;
+		if (cb.SetStyles(endStyled, length, styles, stylingMask, startMod, lengthMod)) {
+			FoldDamage(startMod + lengthMod);
 			DocModification mh(SC_MOD_CHANGESTYLE | SC_PERFORMED_USER,
-			                   startMod, endMod - startMod + 1);
+			                   startMod, lengthMod);
 			NotifyModified(mh);
 		}
+		endStyled += length;
 		enteredStyling--;
 		return true;
 	}
@@ -1726,6 +1916,8 @@ void Document::LexerChanged() {
 int SCI_METHOD Document::SetLineState(int line, int state) {
 	int statePrevious = static_cast<LineState *>(perLineData[ldState])->SetLineState(line, state);
 	if (state != statePrevious) {
+		// Folders may depend on line states as well as on styles
+		FoldDamage(LineStart(line + 1));
 		DocModification mh(SC_MOD_CHANGELINESTATE, LineStart(line), 0, 0, 0, line);
 		NotifyModified(mh);
 	}
@@ -1741,6 +1933,7 @@ int Document::GetMaxLineState() {
 }
 
 void SCI_METHOD Document::ChangeLexerState(int start, int end) {
+	FoldDamage(end);
 	DocModification mh(SC_MOD_LEXERSTATE, start, end-start, 0, 0, 0);
 	NotifyModified(mh);
 }
@@ -2069,11 +2262,15 @@ int Document::BraceMatch(int position, int /*maxReStyle*/) {
 }
 
 /**
- * Implementation of RegexSearchBase for the default built-in regular expression engine
+ * Implementation of RegexSearchBase for the default built-in regular expression engine.
+ * Searches run on NFARegex in linear time; RESearch is only used for patterns
+ * with back references.
  */
 class BuiltinRegex : public RegexSearchBase {
 public:
-	BuiltinRegex(CharClassify *charClassTable) : search(charClassTable), substituted(NULL) {}
+	BuiltinRegex(CharClassify *charClassTable) : nfa(charClassTable), search(charClassTable), substituted(NULL) {
+		ClearMatches();
+	}
 
 	virtual ~BuiltinRegex() {
 		delete substituted;
@@ -2086,8 +2283,17 @@ public:
 	virtual const char *SubstituteByPosition(Document *doc, const char *text, int *length);
 
 private:
+	enum { MAXTAG=10 };
+	NFARegex nfa;
 	RESearch search;
 	char *substituted;
+	int bopat[MAXTAG];
+	int eopat[MAXTAG];
+
+	void ClearMatches();
+	void GrabMatches(const int *bopatFound, const int *eopatFound);
+	long FindTextBacktracking(Document *doc, int minPos, int maxPos, const char *s,
+                        bool caseSensitive, int flags, int *length);
 };
 
 // Define a way for the Regular Expression code to access the document
@@ -2110,12 +2316,95 @@ public:
 	}
 };
 
+// Lets NFARegex read the two halves of the gap buffer in place
+class DocumentSegments : public SegmentedText {
+	Document *pdoc;
+public:
+	explicit DocumentSegments(Document *pdoc_) : pdoc(pdoc_) {
+	}
+
+	virtual ~DocumentSegments() {
+	}
+
+	virtual const char *Segment(int position, int &lengthSegment) {
+		return pdoc->ContiguousRange(position, lengthSegment);
+	}
+
+	virtual int Length() const {
+		return pdoc->Length();
+	}
+};
+
+void BuiltinRegex::ClearMatches() {
+	for (int i = 0; i < MAXTAG; i++) {
+		bopat[i] = -1;
+		eopat[i] = -1;
+	}
+}
+
+void BuiltinRegex::GrabMatches(const int *bopatFound, const int *eopatFound) {
+	for (int i = 0; i < MAXTAG; i++) {
+		bopat[i] = bopatFound[i];
+		eopat[i] = eopatFound[i];
+	}
+}
+
 long BuiltinRegex::FindText(Document *doc, int minPos, int maxPos, const char *s,
                         bool caseSensitive, bool, bool, int flags,
                         int *length) {
 	bool posix = (flags & SCFIND_POSIX) != 0;
 	int increment = (minPos <= maxPos) ? 1 : -1;
 
+	ClearMatches();
+	const char *errmsg = nfa.Compile(s, *length, caseSensitive, posix, SC_CP_UTF8 == doc->dbcsCodePage);
+	if (errmsg) {
+		if (nfa.NeedsBacktracking())
+			return FindTextBacktracking(doc, minPos, maxPos, s, caseSensitive, flags, length);
+		return -1;
+	}
+
+	// Range endpoints should not be inside DBCS characters, but just in case, move them.
+	const int startPos = doc->MovePositionOutsideChar(minPos, 1, false);
+	const int endPos = doc->MovePositionOutsideChar(maxPos, 1, false);
+
+	DocumentSegments ds(doc);
+	int pos = -1;
+	int lenRet = 0;
+	if (increment == 1) {
+		// One pass over the whole range: unless the pattern asks for line ends,
+		// threads die at the end of each line so matches stay within lines.
+		if (nfa.Execute(ds, startPos, endPos, endPos)) {
+			GrabMatches(nfa.bopat, nfa.eopat);
+			pos = bopat[0];
+			lenRet = eopat[0] - bopat[0];
+		}
+	} else {
+		// Find the last match on the nearest line which has one, in one pass over each line.
+		// Matches start before startPos so searching again from a match finds the previous one.
+		// Unless the pattern asks for line ends they start at most at the line end.
+		const int lineRangeEnd = doc->LineFromPosition(endPos);
+		for (int line = doc->LineFromPosition(startPos); (line >= lineRangeEnd) && (pos < 0); line--) {
+			const int posLine = Platform::Maximum(doc->LineStart(line), endPos);
+			int lineLimit = doc->LineEnd(line);
+			if (nfa.MultiLine())
+				lineLimit = Platform::Maximum(lineLimit, doc->LineStart(line + 1) - 1);
+			const int startLimit = Platform::Minimum(lineLimit, startPos - 1);
+			if ((posLine <= startLimit) && nfa.Execute(ds, posLine, startLimit, startPos, true)) {
+				GrabMatches(nfa.bopat, nfa.eopat);
+				pos = bopat[0];
+				lenRet = eopat[0] - bopat[0];
+			}
+		}
+	}
+	*length = lenRet;
+	return pos;
+}
+
+long BuiltinRegex::FindTextBacktracking(Document *doc, int minPos, int maxPos, const char *s,
+                        bool caseSensitive, int flags, int *length) {
+	bool posix = (flags & SCFIND_POSIX) != 0;
+	int increment = (minPos <= maxPos) ? 1 : -1;
+
 	int startPos = minPos;
 	int endPos = maxPos;
 
@@ -2183,6 +2472,7 @@ long BuiltinRegex::FindText(Document *doc, int minPos, int maxPos, const char *s
 		if (success) {
 			pos = search.bopat[0];
 			lenRet = search.eopat[0] - search.bopat[0];
+			GrabMatches(search.bopat, search.eopat);
 			// There can be only one start of a line, so no need to look for last match in line
 			if ((increment == -1) && (s[0] != '^')) {
 				// Check for the last match on this line.
@@ -2193,6 +2483,7 @@ long BuiltinRegex::FindText(Document *doc, int minPos, int maxPos, const char *s
 						if (search.eopat[0] <= minPos) {
 							pos = search.bopat[0];
 							lenRet = search.eopat[0] - search.bopat[0];
+							GrabMatches(search.bopat, search.eopat);
 						} else {
 							success = 0;
 						}
@@ -2209,15 +2500,13 @@ long BuiltinRegex::FindText(Document *doc, int minPos, int maxPos, const char *s
 const char *BuiltinRegex::SubstituteByPosition(Document *doc, const char *text, int *length) {
 	delete []substituted;
 	substituted = 0;
-	DocumentIndexer di(doc, doc->Length());
-	if (!search.GrabMatches(di))
-		return 0;
 	unsigned int lenResult = 0;
 	for (int i = 0; i < *length; i++) {
 		if (text[i] == '\\') {
 			if (text[i + 1] >= '0' && text[i + 1] <= '9') {
 				unsigned int patNum = text[i + 1] - '0';
-				lenResult += search.eopat[patNum] - search.bopat[patNum];
+				if ((bopat[patNum] >= 0) && (eopat[patNum] > bopat[patNum]))
+					lenResult += eopat[patNum] - bopat[patNum];
 				i++;
 			} else {
 				switch (text[i + 1]) {
@@ -2243,10 +2532,11 @@ const char *BuiltinRegex::SubstituteByPosition(Document *doc, const char *text,
 		if (text[j] == '\\') {
 			if (text[j + 1] >= '0' && text[j + 1] <= '9') {
 				unsigned int patNum = text[j + 1] - '0';
-				unsigned int len = search.eopat[patNum] - search.bopat[patNum];
-				if (search.pat[patNum])	// Will be null if try for a match that did not occur
-					memcpy(o, search.pat[patNum], len);
-				o += len;
+				if ((bopat[patNum] >= 0) && (eopat[patNum] > bopat[patNum])) {	// Not for a match that did not occur
+					unsigned int len = eopat[patNum] - bopat[patNum];
+					doc->GetCharRange(o, bopat[patNum], len);
+					o += len;
+				}
 				j++;
 			} else {
 				j++;
@@ -186,6 +186,7 @@ public:
 	virtual ~LexInterface() {
 	}
 	void Colourise(int start, int end);
+	void Fold(int start, int end, int styleStart);
 	bool UseContainerLexing() const {
 		return instance == 0;
 	}
@@ -193,7 +194,7 @@ public:
 
 /**
  */
-class Document : PerLine, public IDocument, public ILoader {
+class Document : PerLine, public IDocumentWithSegments, public ILoader {
 
 public:
 	/** Used to pair watcher pointer with user data. */
@@ -215,6 +216,13 @@ private:
 	CaseFolder *pcf;
 	char stylingMask;
 	int endStyled;
+	/// Fold levels of lines before the line containing endFoldDamaged may change because
+	/// their text or styles changed since they were last folded.
+	int endFoldDamaged;
+	/// Fold levels have been calculated for lines before endFolded.
+	int endFolded;
+	/// Incremented for each fold level changed, so folding can stop once it stops changing levels
+	int foldLevelChanges;
 	int styleClock;
 	int enteredModification;
 	int enteredStyling;
@@ -258,10 +266,11 @@ public:
 	virtual void Init();
 	bool SetDBCSCodePage(int dbcsCodePage_);
 	virtual void InsertLine(int line);
+	virtual void InsertLines(int line, int lines);
 	virtual void RemoveLine(int line);
 
 	int SCI_METHOD Version() const {
-		return dvOriginal;
+		return dvSegments;
 	}
 
 	void SCI_METHOD SetErrorStatus(int status);
@@ -280,6 +289,12 @@ public:
 
 	// Gateways to modifying document
 	void ModifiedAt(int pos);
+	void TextModifiedAt(int pos, int lengthInserted, int lengthDeleted);
+	void FoldDamage(int pos);
+	int FoldDamageEnd() const { return endFoldDamaged; }
+	int FoldedEnd() const { return endFolded; }
+	void FoldedTo(int pos, bool converged);
+	int FoldLevelChanges() const { return foldLevelChanges; }
 	void CheckReadOnly();
 	bool DeleteChars(int pos, int len);
 	bool InsertString(int position, const char *s, int insertLength);
@@ -301,6 +316,11 @@ public:
 	bool IsSavePoint() { return cb.IsSavePoint(); }
 	const char * SCI_METHOD BufferPointer() { return cb.BufferPointer(); }
 	const char *RangePointer(int position, int rangeLength) { return cb.RangePointer(position, rangeLength); }
+	TextSnapshot *CreateSnapshot() { return cb.CreateSnapshot(); }
+	const char *ContiguousRange(int position, int &lengthContiguous) const {
+		return cb.ContiguousRange(position, lengthContiguous);
+	}
+	const char * SCI_METHOD SegmentAt(int position, int *segmentStart, int *segmentLength) const;
 	int GapPosition() const { return cb.GapPosition(); }
 
 	int SCI_METHOD GetLineIndentation(int line);
@@ -329,6 +349,7 @@ public:
 	void GetStyleRange(unsigned char *buffer, int position, int lengthRetrieve) const {
 		cb.GetStyleRange(buffer, position, lengthRetrieve);
 	}
+	int StyleMemory() const { return cb.StyleMemory(); }
 	int GetMark(int line);
 	int MarkerNext(int lineStart, int mask) const;
 	int AddMark(int line, int markerNum);
@@ -361,6 +382,8 @@ public:
 	void SetCaseFolder(CaseFolder *pcf_);
 	long FindText(int minPos, int maxPos, const char *search, bool caseSensitive, bool word,
 		bool wordStart, bool regExp, int flags, int *length);
+	long FindTextForwardLiteral(int startPos, int endPos, const char *search, int lengthFind,
+		bool caseSensitive, bool word, bool wordStart);
 	const char *SubstituteByPosition(const char *text, int *length);
 	int LinesTotal() const;
 
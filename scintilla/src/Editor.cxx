@@ -197,6 +197,7 @@ Editor::Editor() {
 
 	paintState = notPainting;
 	willRedrawAll = false;
+	needLayoutAroundView = false;
 
 	modEventMask = SC_MODEVENTMASKALL;
 
@@ -986,7 +987,7 @@ void Editor::ScrollTo(int line, bool moveThumb) {
 		// Try to optimise small scrolls
 #ifndef UNDER_CE
 		int linesToMove = topLine - topLineNew;
-		bool performBlit = (abs(linesToMove) <= 10) && (paintState == notPainting);
+		bool performBlit = (abs(linesToMove) < LinesOnScreen()) && (paintState == notPainting);
 		willRedrawAll = !performBlit;
 #endif
 		SetTopLine(topLineNew);
@@ -1007,6 +1008,10 @@ void Editor::ScrollTo(int line, bool moveThumb) {
 		if (moveThumb) {
 			SetVerticalScrollPos();
 		}
+		// Prepare the lines that further scrolling will expose
+		if (!needLayoutAroundView && SetIdle(true)) {
+			needLayoutAroundView = true;
+		}
 	}
 }
 
@@ -1015,6 +1020,39 @@ void Editor::ScrollText(int /* linesToMove */) {
 	Redraw();
 }
 
+/**
+ * Style and lay out the lines in the pages above and below the view so that
+ * when they are scrolled into view their text is already styled and their
+ * segments are measured in the position cache. The document layout cache
+ * keeps the layouts themselves; smaller caches would lose the layouts of the
+ * lines in view so the nearby lines are laid out separately.
+ */
+void Editor::LayoutAroundView() {
+	RefreshStyleData();
+	const int linesPage = LinesOnScreen() + 1;
+	const int lineDisplayStart = Platform::Maximum(topLine - linesPage, 0);
+	const int lineDisplayEnd = topLine + 2 * linesPage;
+	const int lineDocStart = cs.DocFromDisplay(lineDisplayStart);
+	const int lineDocEnd = Platform::Minimum(cs.DocFromDisplay(lineDisplayEnd), pdoc->LinesTotal() - 1);
+	pdoc->EnsureStyledTo(pdoc->LineStart(lineDocEnd + 1));
+	AutoSurface surface(this);
+	if (!surface)
+		return;
+	for (int lineDoc = lineDocStart; lineDoc <= lineDocEnd; lineDoc++) {
+		const int lineDisplay = cs.DisplayFromDoc(lineDoc);
+		// Lines in the view have just been laid out by painting
+		if (cs.GetVisible(lineDoc) && ((lineDisplay < topLine) || (lineDisplay >= topLine + linesPage))) {
+			if (llc.GetLevel() == LineLayoutCache::llcDocument) {
+				AutoLineLayout ll(llc, RetrieveLineLayout(lineDoc));
+				LayoutLine(lineDoc, surface, vs, ll, wrapWidth);
+			} else {
+				LineLayout ll(pdoc->LineStart(lineDoc + 1) - pdoc->LineStart(lineDoc));
+				LayoutLine(lineDoc, surface, vs, &ll, wrapWidth);
+			}
+		}
+	}
+}
+
 void Editor::HorizontalScrollTo(int xPos) {
 	//Platform::DebugPrintf("HorizontalScroll %d\n", xPos);
 	if (xPos < 0)
@@ -1457,6 +1495,49 @@ void Editor::InvalidateCaret() {
 	UpdateSystemCaret();
 }
 
+/**
+ * Return the area drawn by a caret at pos, widened by an average character on
+ * each side so that glyphs overhanging the caret's character are repainted too.
+ */
+PRectangle Editor::RectangleFromCaret(SelectionPosition pos) {
+	Point pt = LocationFromPosition(pos);
+	XYPOSITION widthCharacter = vs.aveCharWidth;
+	const int posAfter = pdoc->MovePositionOutsideChar(pos.Position() + 1, 1);
+	Point ptAfter = LocationFromPosition(posAfter);
+	if ((ptAfter.y == pt.y) && (ptAfter.x > pt.x)) {
+		// Block and overstrike carets cover the character after the caret
+		widthCharacter = Platform::Maximum(widthCharacter, ptAfter.x - pt.x);
+	}
+	PRectangle rc(pt.x - vs.aveCharWidth - vs.caretWidth, pt.y,
+		pt.x + widthCharacter + vs.aveCharWidth + vs.caretWidth, pt.y + vs.lineHeight);
+	// Text may overlap the margin by one pixel
+	if (rc.left < vs.fixedColumnWidth - 1)
+		rc.left = vs.fixedColumnWidth - 1;
+	return rc;
+}
+
+/**
+ * Blinking only changes the carets themselves so avoid repainting whole lines.
+ */
+void Editor::InvalidateCaretBlink() {
+	if (posDrag.IsValid()) {
+		InvalidateCaret();
+		return;
+	}
+	for (size_t r=0; r<sel.Count(); r++) {
+		if ((r == sel.Main()) || additionalCaretsBlink) {
+			SelectionPosition caretPos = sel.Range(r).caret;
+			if (wrapState == eWrapNone) {
+				RedrawRect(RectangleFromCaret(caretPos));
+			} else {
+				// A caret at a wrap point may be drawn at the end of the previous subline
+				InvalidateRange(caretPos.Position(), caretPos.Position() + 1);
+			}
+		}
+	}
+	UpdateSystemCaret();
+}
+
 void Editor::UpdateSystemCaret() {
 }
 
@@ -2777,6 +2858,14 @@ void Editor::DrawLine(Surface *surface, ViewStyle &vsDraw, int line, int lineVis
 	bool drawWhitespaceBackground = (vsDraw.viewWhitespace != wsInvisible) &&
 	        (!overrideBackground) && (vsDraw.whitespaceBackgroundSet);
 
+	// Only segments near the area being painted need to be drawn. Allow a line height
+	// either side for glyphs that overhang their segment.
+	PRectangle rcDraw = rcLine;
+	if (paintState == painting) {
+		rcDraw.left = Platform::Maximum(rcLine.left, rcPaint.left - vsDraw.lineHeight);
+		rcDraw.right = Platform::Minimum(rcLine.right, rcPaint.right + vsDraw.lineHeight);
+	}
+
 	bool inIndentation = subLine == 0;	// Do not handle indentation except on first subline.
 	const XYPOSITION indentWidth = pdoc->IndentSize() * vsDraw.spaceWidth;
 	const XYPOSITION epsilon = 0.0001f;	// A small nudge to avoid floating point precision issues
@@ -2871,7 +2960,10 @@ void Editor::DrawLine(Surface *surface, ViewStyle &vsDraw, int line, int lineVis
 		rcSegment.right = ll->positions[i + 1] + xStart - subLineStart;
 		// Only try to draw if really visible - enhances performance by not calling environment to
 		// draw strings that are completely past the right side of the window.
-		if ((rcSegment.left <= rcLine.right) && (rcSegment.right >= rcLine.left)) {
+		// Segments left of the painted area are still drawn while in indentation as that
+		// decides where indentation guides go.
+		if ((rcSegment.left <= rcDraw.right) && (rcSegment.right >= rcLine.left) &&
+		        ((rcSegment.right >= rcDraw.left) || inIndentation)) {
 			// Clip to line rectangle, since may have a huge position which will not work with some platforms
 			if (rcSegment.left < rcLine.left)
 				rcSegment.left = rcLine.left;
@@ -2913,7 +3005,7 @@ void Editor::DrawLine(Surface *surface, ViewStyle &vsDraw, int line, int lineVis
 					}
 				}
 			}
-		} else if (rcSegment.left > rcLine.right) {
+		} else if (rcSegment.left > rcDraw.right) {
 			break;
 		}
 	}
@@ -2966,7 +3058,10 @@ void Editor::DrawLine(Surface *surface, ViewStyle &vsDraw, int line, int lineVis
 		rcSegment.right = ll->positions[i + 1] + xStart - subLineStart;
 		// Only try to draw if really visible - enhances performance by not calling environment to
 		// draw strings that are completely past the right side of the window.
-		if ((rcSegment.left <= rcLine.right) && (rcSegment.right >= rcLine.left)) {
+		// Segments left of the painted area are still drawn while in indentation as that
+		// decides where indentation guides go.
+		if ((rcSegment.left <= rcDraw.right) && (rcSegment.right >= rcLine.left) &&
+		        ((rcSegment.right >= rcDraw.left) || inIndentation)) {
 			int styleMain = ll->styles[i];
 			ColourDesired textFore = vsDraw.styles[styleMain].fore;
 			Font &textFont = vsDraw.styles[styleMain].font;
@@ -3099,7 +3194,7 @@ void Editor::DrawLine(Surface *surface, ViewStyle &vsDraw, int line, int lineVis
 				rcUL.bottom = rcUL.top + 1;
 				surface->FillRectangle(rcUL, textFore);
 			}
-		} else if (rcSegment.left > rcLine.right) {
+		} else if (rcSegment.left > rcDraw.right) {
 			break;
 		}
 	}
@@ -3632,9 +3727,14 @@ void Editor::Paint(Surface *surfaceWindow, PRectangle rcArea) {
 				DrawCarets(surface, vs, lineDoc, xStart, rcLine, ll, subLine);
 
 				if (bufferedDraw) {
-					Point from(vs.fixedColumnWidth-leftTextOverlap, 0);
+					// Only the part of the line inside the painted area has been drawn
 					PRectangle rcCopyArea(vs.fixedColumnWidth-leftTextOverlap, yposScreen,
 					        rcClient.right - vs.rightMarginWidth, yposScreen + vs.lineHeight);
+					if (paintState == painting) {
+						rcCopyArea.left = Platform::Maximum(rcCopyArea.left, rcPaint.left);
+						rcCopyArea.right = Platform::Minimum(rcCopyArea.right, rcPaint.right);
+					}
+					Point from(rcCopyArea.left, 0);
 					surfaceWindow->Copy(rcCopyArea, from, *pixmapLine);
 				}
 
@@ -4500,9 +4600,9 @@ void Editor::NotifySavePoint(Document *, void *, bool atSavePoint) {
 
 void Editor::CheckModificationForWrap(DocModification mh) {
 	if (mh.modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)) {
-		llc.Invalidate(LineLayout::llCheckTextAndStyle);
 		int lineDoc = pdoc->LineFromPosition(mh.position);
 		int lines = Platform::Maximum(0, mh.linesAdded);
+		llc.InvalidateLines(lineDoc, lineDoc + lines, LineLayout::llCheckTextAndStyle);
 		if (wrapState != eWrapNone) {
 			NeedWrapping(lineDoc, lineDoc + lines + 1);
 		}
@@ -4562,7 +4662,7 @@ void Editor::NotifyModified(Document *, DocModification mh, void *) {
 			pdoc->IncrementStyleClock();
 		}
 		if (paintState == notPainting) {
-			if (mh.position < pdoc->LineStart(topLine)) {
+			if ((mh.position < pdoc->LineStart(topLine)) && (mh.modificationType & SC_MOD_CHANGESTYLE)) {
 				// Styling performed before this view
 				Redraw();
 			} else {
@@ -4570,7 +4670,8 @@ void Editor::NotifyModified(Document *, DocModification mh, void *) {
 			}
 		}
 		if (mh.modificationType & SC_MOD_CHANGESTYLE) {
-			llc.Invalidate(LineLayout::llCheckTextAndStyle);
+			llc.InvalidateLines(pdoc->LineFromPosition(mh.position),
+				pdoc->LineFromPosition(mh.position + mh.length), LineLayout::llCheckTextAndStyle);
 		}
 	} else {
 		// Move selection and brace highlights
@@ -4607,8 +4708,10 @@ void Editor::NotifyModified(Document *, DocModification mh, void *) {
 			int lineOfPos = pdoc->LineFromPosition(mh.position);
 			if (mh.linesAdded > 0) {
 				cs.InsertLines(lineOfPos, mh.linesAdded);
+				llc.InsertLines(lineOfPos + 1, mh.linesAdded);
 			} else {
 				cs.DeleteLines(lineOfPos, -mh.linesAdded);
+				llc.DeleteLines(lineOfPos + 1, -mh.linesAdded);
 			}
 		}
 		if (mh.modificationType & SC_MOD_CHANGEANNOTATION) {
@@ -6619,7 +6722,7 @@ void Editor::Tick() {
 			caret.on = !caret.on;
 			timer.ticksToWait = caret.period;
 			if (caret.active) {
-				InvalidateCaret();
+				InvalidateCaretBlink();
 			}
 		}
 	}
@@ -6653,12 +6756,20 @@ bool Editor::Idle() {
 			wrappingDone = true;
 	}
 
+	bool layoutDone = !needLayoutAroundView;
+
+	if (!layoutDone) {
+		LayoutAroundView();
+		needLayoutAroundView = false;
+		layoutDone = true;
+	}
+
 	// Add more idle things to do here, but make sure idleDone is
 	// set correctly before the function returns. returning
 	// false will stop calling this idle funtion until SetIdle() is
 	// called again.
 
-	idleDone = wrappingDone; // && thatDone && theOtherThingDone...
+	idleDone = wrappingDone && layoutDone; // && thatDone && theOtherThingDone...
 
 	return !idleDone;
 }
@@ -6751,8 +6862,27 @@ void Editor::CheckForChangeOutsidePaint(Range r) {
 	}
 }
 
+/**
+ * Invalidate the lines from the first to the last highlighted brace as the
+ * highlighted indentation guide is drawn on all of them.
+ */
+void Editor::InvalidateBraces() {
+	int start = braces[0];
+	int end = braces[1];
+	if (start == INVALID_POSITION)
+		start = end;
+	if (end == INVALID_POSITION)
+		end = start;
+	if (start != INVALID_POSITION) {
+		InvalidateRange(Platform::Minimum(start, end), Platform::Maximum(start, end) + 1);
+	}
+}
+
 void Editor::SetBraceHighlight(Position pos0, Position pos1, int matchStyle) {
 	if ((pos0 != braces[0]) || (pos1 != braces[1]) || (matchStyle != bracesMatchStyle)) {
+		if (paintState == notPainting) {
+			InvalidateBraces();
+		}
 		if ((braces[0] != pos0) || (matchStyle != bracesMatchStyle)) {
 			CheckForChangeOutsidePaint(Range(braces[0]));
 			CheckForChangeOutsidePaint(Range(pos0));
@@ -6765,7 +6895,7 @@ void Editor::SetBraceHighlight(Position pos0, Position pos1, int matchStyle) {
 		}
 		bracesMatchStyle = matchStyle;
 		if (paintState == notPainting) {
-			Redraw();
+			InvalidateBraces();
 		}
 	}
 }
@@ -6899,6 +7029,63 @@ void Editor::ToggleContraction(int line) {
 	}
 }
 
+/**
+ * Expand or contract every fold header, working out which lines are visible in one pass
+ * over the fold levels instead of toggling each header.
+ */
+void Editor::FoldAll(int action) {
+	pdoc->EnsureStyledTo(pdoc->Length());
+	const int maxLine = pdoc->LinesTotal();
+	bool expanding = action == SC_FOLDACTION_EXPAND;
+	if (action == SC_FOLDACTION_TOGGLE) {
+		// Toggle to the opposite of the first header's state
+		for (int lineSeek = 0; lineSeek < maxLine; lineSeek++) {
+			if (pdoc->GetLevel(lineSeek) & SC_FOLDLEVELHEADERFLAG) {
+				expanding = !cs.GetExpanded(lineSeek);
+				break;
+			}
+		}
+	}
+
+	std::vector<char> expandedLines(maxLine);
+	std::vector<char> visibleLines(maxLine);
+	int lineHiddenEnd = -1;	// Lines up to this one are inside a contracted fold
+	for (int line = 0; line < maxLine; line++) {
+		const int levelLine = pdoc->GetLevel(line);
+		const bool header = (levelLine & SC_FOLDLEVELHEADERFLAG) != 0;
+		bool expandedLine = cs.GetExpanded(line);
+		int lineMaxSubord = line;
+		if (header) {
+			if (expanding) {
+				expandedLine = true;
+			} else {
+				// Like ToggleContraction, leave headers without children as they are
+				lineMaxSubord = pdoc->GetLastChild(line, levelLine & SC_FOLDLEVELNUMBERMASK);
+				if (lineMaxSubord > line)
+					expandedLine = false;
+			}
+		}
+		expandedLines[line] = expandedLine;
+		if (line <= lineHiddenEnd) {
+			visibleLines[line] = false;
+		} else {
+			// Contracting everything leaves lines hidden with SCI_HIDELINES hidden
+			visibleLines[line] = expanding ? true : cs.GetVisible(line);
+			if (header && !expandedLine)
+				lineHiddenEnd = lineMaxSubord;
+		}
+	}
+	cs.SetFoldState(&expandedLines[0], &visibleLines[0]);
+
+	int lineCurrent = pdoc->LineFromPosition(sel.MainCaret());
+	if (!cs.GetVisible(lineCurrent)) {
+		// This does not re-expand the fold
+		EnsureCaretVisible();
+	}
+	SetScrollBars();
+	Redraw();
+}
+
 int Editor::ContractedFoldNext(int lineStart) {
 	for (int line = lineStart; line<pdoc->LinesTotal();) {
 		if (!cs.GetExpanded(line) && (pdoc->GetLevel(line) & SC_FOLDLEVELHEADERFLAG))
@@ -7593,6 +7780,9 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_GETLENGTH:
 		return pdoc->Length();
 
+	case SCI_GETSTYLEMEMORY:
+		return pdoc->StyleMemory();
+
 	case SCI_ALLOCATE:
 		pdoc->Allocate(wParam);
 		break;
@@ -8054,7 +8244,8 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_SETHIGHLIGHTGUIDE:
 		if ((highlightGuideColumn != static_cast<int>(wParam)) || (wParam > 0)) {
 			highlightGuideColumn = wParam;
-			Redraw();
+			// The guide is only highlighted between the braces
+			InvalidateBraces();
 		}
 		break;
 
@@ -8301,6 +8492,8 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_SETSTYLEBITS:
 		vs.EnsureStyle((1 << wParam) - 1);
 		pdoc->SetStylingBits(wParam);
+		// Cached layouts hold styles masked with the old bits
+		llc.Invalidate(LineLayout::llCheckTextAndStyle);
 		break;
 
 	case SCI_GETSTYLEBITS:
@@ -8398,6 +8591,10 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 		ToggleContraction(wParam);
 		break;
 
+	case SCI_FOLDALL:
+		FoldAll(wParam);
+		break;
+
 	case SCI_CONTRACTEDFOLDNEXT:
 		return ContractedFoldNext(wParam);
 
@@ -8985,6 +9182,16 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
 	case SCI_GETRANGEPOINTER:
 		return reinterpret_cast<sptr_t>(pdoc->RangePointer(wParam, lParam));
 
+	case SCI_CREATESNAPSHOT: {
+			Sci_TextSnapshot *snapshot = pdoc->CreateSnapshot();
+			return reinterpret_cast<sptr_t>(snapshot);
+		}
+
+	case SCI_RELEASESNAPSHOT:
+		if (lParam)
+			static_cast<TextSnapshot *>(reinterpret_cast<Sci_TextSnapshot *>(lParam))->Release();
+		break;
+
 	case SCI_GETGAPPOSITION:
 		return pdoc->GapPosition();
 
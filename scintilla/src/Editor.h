@@ -228,6 +228,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	PRectangle rcPaint;
 	bool paintingAllText;
 	bool willRedrawAll;
+	bool needLayoutAroundView;
 	StyleNeeded styleNeeded;
 
 	int modEventMask;
@@ -340,6 +341,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 
 	void ScrollTo(int line, bool moveThumb=true);
 	virtual void ScrollText(int linesToMove);
+	void LayoutAroundView();
 	void HorizontalScrollTo(int xPos);
 	void VerticalCentreCaret();
 	void MoveSelectedLines(int lineDelta);
@@ -359,6 +361,8 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	void ShowCaretAtCurrentPosition();
 	void DropCaret();
 	void InvalidateCaret();
+	PRectangle RectangleFromCaret(SelectionPosition pos);
+	void InvalidateCaretBlink();
 	virtual void UpdateSystemCaret();
 
 	void NeedWrapping(int docLineStart = 0, int docLineEnd = wrapLineLarge);
@@ -524,6 +528,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	virtual bool PaintContains(PRectangle rc);
 	bool PaintContainsMargin();
 	void CheckForChangeOutsidePaint(Range r);
+	void InvalidateBraces();
 	void SetBraceHighlight(Position pos0, Position pos1, int matchStyle);
 
 	void SetAnnotationHeights(int start, int end);
@@ -533,6 +538,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 
 	void Expand(int &line, bool doExpand);
 	void ToggleContraction(int line);
+	void FoldAll(int action);
 	int ContractedFoldNext(int lineStart);
 	void EnsureLineVisible(int lineDoc, bool enforcePolicy);
 	int GetTag(char *tagValue, int tagNumber);
@@ -0,0 +1,813 @@
+// Scintilla source code edit control
+/** @file NFARegex.cxx
+ ** Linear time regular expression search over segmented text.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+/*
+ * The pattern syntax is that of RESearch: literal characters, '.', [sets],
+ * the \d \D \s \S \w \W classes, \xHH, the C escapes, the closures '*', '+'
+ * and '?' which may be followed by '?' to make them lazy, \( \) tags (or
+ * ( ) in POSIX mode), \< \> word boundaries and ^ $ anchors at the start and
+ * end of the pattern. Closures may also be applied to tagged groups and more
+ * than 9 groups may be used although only the first 9 are recorded.
+ * Back references can not be matched in linear time so patterns using them
+ * are rejected with NeedsBacktracking() set so callers can fall back.
+ *
+ * The compiled program is executed as a Pike VM: all threads advance in lock
+ * step over the text, each instruction is visited at most once per position
+ * and thread order gives the same leftmost, greedy-first results as a
+ * backtracking matcher.
+ */
+
+#include <string.h>
+
+#include <vector>
+
+#include "Platform.h"
+
+#include "CharClassify.h"
+#include "UniConversion.h"
+#include "NFARegex.h"
+
+#ifdef SCI_NAMESPACE
+using namespace Scintilla;
+#endif
+
+// Node types of the parsed pattern
+enum { ntChar, ntAny, ntSet, ntBol, ntEol, ntBow, ntEow, ntGroup, ntStar, ntPlus, ntQuest };
+
+// Invalid UTF-8 bytes are mapped above the Unicode range so they only match '.' and negated sets
+static const int invalidCharacterBase = 0x110000;
+
+#ifdef SCI_NAMESPACE
+namespace Scintilla {
+#endif
+
+class NFACharSet {
+public:
+	unsigned char bits[32];
+	std::vector<int> ranges;	// Pairs of first and last for characters above 0xFF
+	bool negated;
+	bool wordAbove;		// \w in Unicode mode: characters above 0x7F classified as words
+	bool notWordAbove;	// \W in Unicode mode
+	bool allAbove;		// \D or \S in Unicode mode: all characters above 0xFF
+
+	NFACharSet() : negated(false), wordAbove(false), notWordAbove(false), allAbove(false) {
+		memset(bits, 0, sizeof(bits));
+	}
+	void Add(int ch) {
+		if (ch < 0x100) {
+			bits[ch >> 3] |= static_cast<unsigned char>(1 << (ch & 7));
+		} else {
+			ranges.push_back(ch);
+			ranges.push_back(ch);
+		}
+	}
+	void AddWithCase(int ch, bool caseSensitive) {
+		Add(ch);
+		if (!caseSensitive) {
+			if ((ch >= 'a') && (ch <= 'z'))
+				Add(ch - 'a' + 'A');
+			else if ((ch >= 'A') && (ch <= 'Z'))
+				Add(ch - 'A' + 'a');
+		}
+	}
+	void AddRange(int first, int last, bool caseSensitive) {
+		for (; (first <= last) && (first < 0x100); first++)
+			AddWithCase(first, caseSensitive);
+		if (first <= last) {
+			ranges.push_back(first);
+			ranges.push_back(last);
+		}
+	}
+	bool Has(int ch) const {
+		if (ch < 0x100)
+			return (bits[ch >> 3] & (1 << (ch & 7))) != 0;
+		for (size_t r = 0; r < ranges.size(); r += 2) {
+			if ((ch >= ranges[r]) && (ch <= ranges[r + 1]))
+				return true;
+		}
+		return false;
+	}
+};
+
+#ifdef SCI_NAMESPACE
+}
+#endif
+
+struct NFARegex::Node {
+	int type;
+	int value;	// Character, set index, tag number or greediness
+	int value2;	// Other case of character
+	std::vector<int> children;
+	Node(int type_, int value_, int value2_) : type(type_), value(value_), value2(value2_) {
+	}
+};
+
+void NFARegex::ThreadList::Allocate(size_t size, int stride_) {
+	stride = stride_;
+	pcs.resize(size);
+	caps.resize(size * stride);
+	count = 0;
+}
+
+void NFARegex::ThreadList::Add(int pc, const int *capsThread) {
+	pcs[count] = pc;
+	memcpy(&caps[count * stride], capsThread, sizeof(int) * stride);
+	count++;
+}
+
+NFARegex::NFARegex(CharClassify *charClassTable) :
+	charClass(charClassTable), unicode(false), caseSensitive(true), multiLine(false),
+	needsBacktracking(false), firstByte(-1), capsLength(2), text(0), segment(0), segmentStart(0),
+	segmentEnd(0), generation(0), caps(2 * MAXTAG), capsMatch(2 * MAXTAG) {
+	for (int i = 0; i < MAXTAG; i++) {
+		bopat[i] = NOTFOUND;
+		eopat[i] = NOTFOUND;
+	}
+}
+
+NFARegex::~NFARegex() {
+	Clear();
+}
+
+void NFARegex::Clear() {
+	for (size_t s = 0; s < sets.size(); s++)
+		delete sets[s];
+	sets.clear();
+	for (size_t n = 0; n < nodes.size(); n++)
+		delete nodes[n];
+	nodes.clear();
+	prog.clear();
+	multiLine = false;
+	needsBacktracking = false;
+	firstByte = -1;
+}
+
+int NFARegex::NewNode(int type, int value, int value2) {
+	nodes.push_back(new Node(type, value, value2));
+	return static_cast<int>(nodes.size()) - 1;
+}
+
+/// Read one character from the pattern, decoding UTF-8 in Unicode mode.
+int NFARegex::PatternChar(const char *pattern, int length, int &i) const {
+	const unsigned char lead = static_cast<unsigned char>(pattern[i]);
+	if (!unicode || UTF8IsAscii(lead)) {
+		i++;
+		return lead;
+	}
+	const int widthCharBytes = UTF8BytesOfLead[lead];
+	if (i + widthCharBytes > length) {
+		i++;
+		return lead;
+	}
+	const unsigned char *us = reinterpret_cast<const unsigned char *>(pattern + i);
+	const int utf8status = UTF8Classify(us, widthCharBytes);
+	if (utf8status & UTF8MaskInvalid) {
+		i++;
+		return lead;
+	}
+	int ch;
+	switch (utf8status & UTF8MaskWidth) {
+	case 2:
+		ch = ((us[0] & 0x1F) << 6) | (us[1] & 0x3F);
+		break;
+	case 3:
+		ch = ((us[0] & 0xF) << 12) | ((us[1] & 0x3F) << 6) | (us[2] & 0x3F);
+		break;
+	default:
+		ch = ((us[0] & 0x7) << 18) | ((us[1] & 0x3F) << 12) | ((us[2] & 0x3F) << 6) | (us[3] & 0x3F);
+		break;
+	}
+	i += utf8status & UTF8MaskWidth;
+	return ch;
+}
+
+static int HexaValue(char hd) {
+	if (hd >= '0' && hd <= '9')
+		return hd - '0';
+	else if (hd >= 'A' && hd <= 'F')
+		return hd - 'A' + 10;
+	else if (hd >= 'a' && hd <= 'f')
+		return hd - 'a' + 10;
+	return -1;
+}
+
+/**
+ * Interpret the expression after a backslash at pattern[i], advancing i past it.
+ * @return the character it stands for or -1 when it is a class which is added to set.
+ */
+int NFARegex::BackslashExpression(const char *pattern, int length, int &i, NFACharSet *set) {
+	const char bsc = pattern[i];
+	int ch = -1;
+	switch (bsc) {
+	case 'a':	ch = '\a';	break;
+	case 'b':	ch = '\b';	break;
+	case 'f':	ch = '\f';	break;
+	case 'n':	ch = '\n';	break;
+	case 'r':	ch = '\r';	break;
+	case 't':	ch = '\t';	break;
+	case 'v':	ch = '\v';	break;
+	case 'x':
+		if ((i + 2 < length) && (HexaValue(pattern[i + 1]) >= 0) && (HexaValue(pattern[i + 2]) >= 0)) {
+			ch = HexaValue(pattern[i + 1]) * 16 + HexaValue(pattern[i + 2]);
+			i += 2;
+		} else {
+			ch = 'x';	// \x without 2 digits: see it as 'x'
+		}
+		break;
+	case 'd':
+	case 'D':
+	case 's':
+	case 'S':
+	case 'w':
+	case 'W': {
+			const int limit = unicode ? 0x80 : 0x100;
+			for (int c = 0; c < 0x100; c++) {
+				bool in;
+				switch (bsc) {
+				case 'd':	in = (c >= '0') && (c <= '9');	break;
+				case 'D':	in = (c < '0') || (c > '9');	break;
+				case 's':	in = (c == ' ') || ((c >= 0x09) && (c <= 0x0D));	break;
+				case 'S':	in = (c != ' ') && !((c >= 0x09) && (c <= 0x0D));	break;
+				case 'w':	in = (c < limit) && charClass->IsWord(static_cast<unsigned char>(c));	break;
+				default:	in = (c < limit) && !charClass->IsWord(static_cast<unsigned char>(c));	break;
+				}
+				if (in)
+					set->Add(c);
+			}
+			if (unicode) {
+				if (bsc == 'w')
+					set->wordAbove = true;
+				else if (bsc == 'W')
+					set->notWordAbove = true;
+				else if ((bsc == 'D') || (bsc == 'S'))
+					set->allAbove = true;
+			}
+		}
+		i++;
+		return -1;
+	default:
+		return PatternChar(pattern, length, i);
+	}
+	i++;
+	if ((ch == '\n') || (ch == '\r'))
+		multiLine = true;
+	return ch;
+}
+
+/// Parse a [set] with pattern[i] just after the '['.
+const char *NFARegex::ParseSet(const char *pattern, int length, int &i, int &node) {
+	NFACharSet *set = new NFACharSet();
+	sets.push_back(set);
+	node = NewNode(ntSet, static_cast<int>(sets.size()) - 1);
+	int prevChar = 0;
+	if ((i < length) && (pattern[i] == '^')) {
+		set->negated = true;
+		i++;
+	}
+	if ((i < length) && (pattern[i] == '-')) {	// real dash
+		prevChar = '-';
+		set->Add('-');
+		i++;
+	}
+	if ((i < length) && (pattern[i] == ']')) {	// real brace
+		prevChar = ']';
+		set->Add(']');
+		i++;
+	}
+	while ((i < length) && (pattern[i] != ']')) {
+		if (pattern[i] == '-') {
+			if (prevChar < 0) {
+				// Previous def. was a char class like \d, take dash literally
+				prevChar = '-';
+				set->Add('-');
+				i++;
+			} else if (i + 1 >= length) {
+				return "Missing ]";
+			} else if (pattern[i + 1] == ']') {
+				// Dash before the ], take it literally
+				prevChar = '-';
+				set->Add('-');
+				i++;
+			} else {
+				const int first = prevChar + 1;
+				int last;
+				i++;
+				if (pattern[i] == '\\') {
+					if (i + 1 >= length)
+						return "Missing ]";
+					i++;
+					last = BackslashExpression(pattern, length, i, set);
+				} else {
+					last = PatternChar(pattern, length, i);
+				}
+				if (last < 0) {
+					// Char after dash is char class like \d, take dash literally
+					prevChar = '-';
+					set->Add('-');
+				} else {
+					set->AddRange(first, last, caseSensitive);
+					prevChar = last;
+				}
+			}
+		} else if ((pattern[i] == '\\') && (i + 1 < length)) {
+			i++;
+			const int ch = BackslashExpression(pattern, length, i, set);
+			if (ch >= 0) {
+				// Convention: \c (c is any char) is case sensitive, whatever the option
+				set->Add(ch);
+			}
+			prevChar = ch;
+		} else {
+			prevChar = PatternChar(pattern, length, i);
+			set->AddWithCase(prevChar, caseSensitive);
+		}
+	}
+	if (i >= length)
+		return "Missing ]";
+	i++;
+	return 0;
+}
+
+/**
+ * Parse pattern from i into the children of group until the end of the
+ * pattern or the closing bracket of the group.
+ */
+const char *NFARegex::ParseSequence(const char *pattern, int length, int &i, bool posix,
+	int &tagCount, int depth, int group, bool &closed) {
+	closed = false;
+	while (i < length) {
+		const char ch = pattern[i];
+		int node = -1;
+		if ((ch == '*') || (ch == '+') || (ch == '?')) {
+			std::vector<int> &children = nodes[group]->children;
+			if (children.empty())
+				return "Empty closure";
+			Node *prev = nodes[children.back()];
+			switch (prev->type) {
+			case ntBol:
+			case ntEol:
+			case ntBow:
+			case ntEow:
+				return "Illegal closure";
+			case ntStar:
+			case ntPlus:
+			case ntQuest:
+				// x*? x+? and x?? are lazy, other repeated closures are equivalent to one
+				if (ch == '?')
+					prev->value = 0;
+				break;
+			default:
+				node = NewNode((ch == '*') ? ntStar : ((ch == '+') ? ntPlus : ntQuest), 1);
+				nodes[node]->children.push_back(children.back());
+				children.back() = node;
+				break;
+			}
+			i++;
+			continue;
+		}
+		const bool open = posix ? (ch == '(') :
+			((ch == '\\') && (i + 1 < length) && (pattern[i + 1] == '('));
+		const bool close = posix ? (ch == ')') :
+			((ch == '\\') && (i + 1 < length) && (pattern[i + 1] == ')'));
+		if (close) {
+			if (depth == 0)
+				return posix ? "Unmatched )" : "Unmatched \\)";
+			i += posix ? 1 : 2;
+			closed = true;
+			return 0;
+		} else if (open) {
+			i += posix ? 1 : 2;
+			// Groups past the 9th are matched but not recorded
+			node = NewNode(ntGroup, (tagCount < MAXTAG) ? tagCount++ : -1);
+			bool closedGroup = false;
+			const char *errmsg = ParseSequence(pattern, length, i, posix, tagCount, depth + 1,
+				node, closedGroup);
+			if (errmsg)
+				return errmsg;
+			if (!closedGroup)
+				return posix ? "Unmatched (" : "Unmatched \\(";
+		} else if (ch == '.') {
+			node = NewNode(ntAny);
+			i++;
+		} else if ((ch == '^') && (i == 0)) {
+			node = NewNode(ntBol);
+			i++;
+		} else if ((ch == '$') && (i == length - 1)) {
+			node = NewNode(ntEol);
+			i++;
+		} else if (ch == '[') {
+			i++;
+			const char *errmsg = ParseSet(pattern, length, i, node);
+			if (errmsg)
+				return errmsg;
+		} else if ((ch == '\\') && (i + 1 < length)) {
+			i++;
+			const char bsc = pattern[i];
+			if (bsc == '<') {
+				node = NewNode(ntBow);
+				i++;
+			} else if (bsc == '>') {
+				node = NewNode(ntEow);
+				i++;
+			} else if ((bsc >= '1') && (bsc <= '9')) {
+				needsBacktracking = true;
+				return "Back references need backtracking";
+			} else {
+				NFACharSet *set = new NFACharSet();
+				const int chEscaped = BackslashExpression(pattern, length, i, set);
+				if (chEscaped >= 0) {
+					delete set;
+					node = NewNode(ntChar, chEscaped, chEscaped);
+				} else {
+					sets.push_back(set);
+					node = NewNode(ntSet, static_cast<int>(sets.size()) - 1);
+				}
+			}
+		} else {
+			// An ordinary character, including a '\' at the end of the pattern
+			const int chLiteral = PatternChar(pattern, length, i);
+			int chOther = chLiteral;
+			if (!caseSensitive) {
+				if ((chLiteral >= 'a') && (chLiteral <= 'z'))
+					chOther = chLiteral - 'a' + 'A';
+				else if ((chLiteral >= 'A') && (chLiteral <= 'Z'))
+					chOther = chLiteral - 'A' + 'a';
+			}
+			node = NewNode(ntChar, chLiteral, chOther);
+		}
+		nodes[group]->children.push_back(node);
+	}
+	return 0;
+}
+
+int NFARegex::Emit(int op, int x, int y) {
+	prog.push_back(Instruction(op, x, y));
+	return static_cast<int>(prog.size()) - 1;
+}
+
+void NFARegex::Generate(int node) {
+	const Node *pnode = nodes[node];
+	switch (pnode->type) {
+	case ntChar:
+		Emit(opChar, pnode->value, pnode->value2);
+		break;
+	case ntAny:
+		Emit(opAny);
+		break;
+	case ntSet:
+		Emit(opSet, pnode->value);
+		break;
+	case ntBol:
+		Emit(opBol);
+		break;
+	case ntEol:
+		Emit(opEol);
+		break;
+	case ntBow:
+		Emit(opBow);
+		break;
+	case ntEow:
+		Emit(opEow);
+		break;
+	case ntGroup:
+		if (pnode->value >= 0)
+			Emit(opSave, 2 * pnode->value);
+		for (size_t c = 0; c < pnode->children.size(); c++)
+			Generate(pnode->children[c]);
+		if (pnode->value >= 0)
+			Emit(opSave, 2 * pnode->value + 1);
+		break;
+	case ntStar: {
+			// L1: split L2, L3; L2: child; jump L1; L3:
+			const int split = Emit(opSplit);
+			Generate(pnode->children[0]);
+			Emit(opJump, split);
+			const int after = static_cast<int>(prog.size());
+			prog[split].x = pnode->value ? split + 1 : after;
+			prog[split].y = pnode->value ? after : split + 1;
+		}
+		break;
+	case ntPlus: {
+			// L1: child; split L1, L3; L3:
+			const int start = static_cast<int>(prog.size());
+			Generate(pnode->children[0]);
+			const int split = Emit(opSplit);
+			prog[split].x = pnode->value ? start : split + 1;
+			prog[split].y = pnode->value ? split + 1 : start;
+		}
+		break;
+	case ntQuest: {
+			// split L1, L2; L1: child; L2:
+			const int split = Emit(opSplit);
+			Generate(pnode->children[0]);
+			const int after = static_cast<int>(prog.size());
+			prog[split].x = pnode->value ? split + 1 : after;
+			prog[split].y = pnode->value ? after : split + 1;
+		}
+		break;
+	}
+}
+
+/// When every match starts with the same byte, remember it so execution can skip to it.
+void NFARegex::FindFirstByte() {
+	firstByte = -1;
+	size_t pc = 0;
+	while ((pc < prog.size()) && (prog[pc].op == opSave))
+		pc++;
+	if ((pc < prog.size()) && (prog[pc].op == opChar) && (prog[pc].x == prog[pc].y)) {
+		const int ch = prog[pc].x;
+		if (!unicode || (ch < 0x80)) {
+			firstByte = ch;
+		} else if (ch < 0x800) {
+			firstByte = 0xC0 | (ch >> 6);
+		} else if (ch < 0x10000) {
+			firstByte = 0xE0 | (ch >> 12);
+		} else {
+			firstByte = 0xF0 | (ch >> 18);
+		}
+	}
+}
+
+const char *NFARegex::Compile(const char *pattern, int length, bool caseSensitive_, bool posix, bool unicode_) {
+	Clear();
+	if (!pattern || !length)
+		return "No previous regular expression";
+	caseSensitive = caseSensitive_;
+	unicode = unicode_;
+
+	const int root = NewNode(ntGroup, 0);
+	int tagCount = 1;
+	int i = 0;
+	bool closed = false;
+	const char *errmsg = ParseSequence(pattern, length, i, posix, tagCount, 0, root, closed);
+	if (!errmsg) {
+		Generate(root);
+		Emit(opMatch);
+		FindFirstByte();
+		capsLength = 2 * tagCount;
+		marks.assign(prog.size(), 0);
+		generation = 0;
+		threadsA.Allocate(prog.size(), capsLength);
+		threadsB.Allocate(prog.size(), capsLength);
+	} else {
+		prog.clear();
+	}
+	for (size_t n = 0; n < nodes.size(); n++)
+		delete nodes[n];
+	nodes.clear();
+	return errmsg;
+}
+
+unsigned char NFARegex::ByteAt(int position) {
+	if ((position >= segmentStart) && (position < segmentEnd))
+		return segment[position - segmentStart];
+	int lengthSegment = 0;
+	const char *s = text->Segment(position, lengthSegment);
+	if (!s || (lengthSegment <= 0))
+		return 0;
+	segment = s;
+	segmentStart = position;
+	segmentEnd = position + lengthSegment;
+	return segment[0];
+}
+
+/// Find the first occurrence of ch in [position, limit) or return -1.
+int NFARegex::FindByte(int position, int limit, unsigned char ch) {
+	while (position < limit) {
+		int lengthSegment = 0;
+		const char *s = text->Segment(position, lengthSegment);
+		if (!s || (lengthSegment <= 0))
+			return -1;
+		if (lengthSegment > limit - position)
+			lengthSegment = limit - position;
+		const char *found = static_cast<const char *>(memchr(s, ch, lengthSegment));
+		if (found)
+			return position + static_cast<int>(found - s);
+		position += lengthSegment;
+	}
+	return -1;
+}
+
+/// Return the character at position and its width in bytes, decoding UTF-8 in Unicode mode.
+int NFARegex::CharacterAt(int position, int &width) {
+	const unsigned char lead = ByteAt(position);
+	width = 1;
+	if (!unicode || UTF8IsAscii(lead))
+		return lead;
+	const int widthCharBytes = UTF8BytesOfLead[lead];
+	unsigned char us[UTF8MaxBytes] = {lead, 0, 0, 0};
+	for (int b = 1; b < widthCharBytes; b++)
+		us[b] = ByteAt(position + b);
+	const int utf8status = UTF8Classify(us, widthCharBytes);
+	if (utf8status & UTF8MaskInvalid)
+		return invalidCharacterBase + lead;
+	width = utf8status & UTF8MaskWidth;
+	switch (width) {
+	case 2:
+		return ((us[0] & 0x1F) << 6) | (us[1] & 0x3F);
+	case 3:
+		return ((us[0] & 0xF) << 12) | ((us[1] & 0x3F) << 6) | (us[2] & 0x3F);
+	default:
+		return ((us[0] & 0x7) << 18) | ((us[1] & 0x3F) << 12) | ((us[2] & 0x3F) << 6) | (us[3] & 0x3F);
+	}
+}
+
+bool NFARegex::IsWordByte(int position) {
+	return charClass->IsWord(ByteAt(position));
+}
+
+bool NFARegex::AssertionHolds(int op, int position) {
+	switch (op) {
+	case opBol: {
+			if (position <= 0)
+				return true;
+			const unsigned char chPrev = ByteAt(position - 1);
+			return (chPrev == '\n') || ((chPrev == '\r') && (ByteAt(position) != '\n'));
+		}
+	case opEol: {
+			if (position >= text->Length())
+				return true;
+			const unsigned char ch = ByteAt(position);
+			return (ch == '\r') || ((ch == '\n') && ((position == 0) || (ByteAt(position - 1) != '\r')));
+		}
+	case opBow:
+		return !IsWordByte(position - 1) && IsWordByte(position);
+	case opEow:
+		return IsWordByte(position - 1) && !IsWordByte(position);
+	}
+	return false;
+}
+
+/// Classify non-ASCII characters by the lead byte of their UTF-8 form, as Document does.
+bool NFARegex::IsWordCharacter(int ch) const {
+	unsigned char lead;
+	if (ch >= invalidCharacterBase)
+		lead = static_cast<unsigned char>(ch - invalidCharacterBase);
+	else if (ch < 0x80)
+		lead = static_cast<unsigned char>(ch);
+	else if (ch < 0x800)
+		lead = static_cast<unsigned char>(0xC0 | (ch >> 6));
+	else if (ch < 0x10000)
+		lead = static_cast<unsigned char>(0xE0 | (ch >> 12));
+	else
+		lead = static_cast<unsigned char>(0xF0 | (ch >> 18));
+	return charClass->IsWord(lead);
+}
+
+bool NFARegex::CharacterMatches(const Instruction &inst, int ch) const {
+	switch (inst.op) {
+	case opChar:
+		return (ch == inst.x) || (ch == inst.y);
+	case opAny:
+		return (ch != '\r') && (ch != '\n');
+	case opSet: {
+			const NFACharSet *set = sets[inst.x];
+			bool in = set->Has(ch);
+			if (!in && unicode && (ch >= 0x80)) {
+				in = (set->allAbove && (ch >= 0x100)) ||
+					((set->wordAbove || set->notWordAbove) &&
+					(IsWordCharacter(ch) ? set->wordAbove : set->notWordAbove));
+			}
+			return in != set->negated;
+		}
+	}
+	return false;
+}
+
+/// Add the thread at pc to list following jumps, splits, saves and assertions.
+void NFARegex::AddThread(ThreadList &list, unsigned int gen, int pc, int *capsThread, int position) {
+	if (marks[pc] == gen)
+		return;
+	marks[pc] = gen;
+	const Instruction &inst = prog[pc];
+	switch (inst.op) {
+	case opJump:
+		AddThread(list, gen, inst.x, capsThread, position);
+		break;
+	case opSplit:
+		AddThread(list, gen, inst.x, capsThread, position);
+		AddThread(list, gen, inst.y, capsThread, position);
+		break;
+	case opSave: {
+			const int saved = capsThread[inst.x];
+			capsThread[inst.x] = position;
+			AddThread(list, gen, pc + 1, capsThread, position);
+			capsThread[inst.x] = saved;
+		}
+		break;
+	case opBol:
+	case opEol:
+	case opBow:
+	case opEow:
+		if (AssertionHolds(inst.op, position))
+			AddThread(list, gen, pc + 1, capsThread, position);
+		break;
+	default:
+		list.Add(pc, capsThread);
+		break;
+	}
+}
+
+/// Add a thread starting a match at position.
+void NFARegex::AddStart(ThreadList &list, unsigned int gen, int position) {
+	// Unless the pattern asks for line ends, matches do not start between CR and LF
+	if (!multiLine && (position > 0) && (ByteAt(position) == '\n') && (ByteAt(position - 1) == '\r'))
+		return;
+	for (int c = 0; c < 2 * MAXTAG; c++)
+		caps[c] = NOTFOUND;
+	AddThread(list, gen, 0, &caps[0], position);
+}
+
+/**
+ * Find the leftmost match which starts between startPos and startLimit and
+ * ends before endPos. Text outside the range is only examined by assertions.
+ * If last is true, find the match which starts nearest to startLimit instead,
+ * still in one pass over the text.
+ * If a match is found, bopat[0] and eopat[0] are set to the beginning and the
+ * end of the matched fragment and the other elements to any tagged groups.
+ */
+bool NFARegex::Execute(SegmentedText &text_, int startPos, int startLimit, int endPos, bool last) {
+	for (int i = 0; i < MAXTAG; i++) {
+		bopat[i] = NOTFOUND;
+		eopat[i] = NOTFOUND;
+	}
+	if (prog.empty())
+		return false;
+	if (generation > 0x7fffffff) {
+		marks.assign(prog.size(), 0);
+		generation = 0;
+	}
+	text = &text_;
+	segment = 0;
+	segmentStart = 0;
+	segmentEnd = 0;
+
+	ThreadList *current = &threadsA;
+	ThreadList *next = &threadsB;
+	current->count = 0;
+	unsigned int genCurrent = ++generation;
+	bool matched = false;
+	int pos = startPos;
+	bool started = false;	// The thread starting at pos is already in current
+	for (;;) {
+		if (!started && (!matched || last) && (pos <= startLimit)) {
+			if ((current->count == 0) && (firstByte >= 0)) {
+				pos = FindByte(pos, Platform::Minimum(startLimit + 1, endPos),
+					static_cast<unsigned char>(firstByte));
+				if (pos < 0)
+					break;
+			}
+			AddStart(*current, genCurrent, pos);
+		}
+		started = false;
+		if ((current->count == 0) && ((matched && !last) || (pos >= startLimit)))
+			break;
+
+		int width = 0;
+		int ch = -1;
+		if (pos < endPos) {
+			ch = CharacterAt(pos, width);
+			if ((pos + width > endPos) || (!multiLine && ((ch == '\r') || (ch == '\n'))))
+				ch = -1;
+		}
+		next->count = 0;
+		const unsigned int genNext = ++generation;
+		if (last && (current->count > 0) && (pos < endPos) && (pos + width <= startLimit)) {
+			// Threads added first have priority so a later start wins over earlier ones
+			AddStart(*next, genNext, pos + width);
+			started = true;
+		}
+		for (int t = 0; t < current->count; t++) {
+			const int pc = current->pcs[t];
+			const int *capsThread = &current->caps[t * capsLength];
+			if (prog[pc].op == opMatch) {
+				// Lower priority threads are cut off
+				matched = true;
+				memcpy(&capsMatch[0], capsThread, sizeof(int) * capsLength);
+				break;
+			}
+			if ((ch >= 0) && CharacterMatches(prog[pc], ch)) {
+				memcpy(&caps[0], capsThread, sizeof(int) * capsLength);
+				AddThread(*next, genNext, pc + 1, &caps[0], pos + width);
+			}
+		}
+		ThreadList *swap = current;
+		current = next;
+		next = swap;
+		genCurrent = genNext;
+		if (pos >= endPos)
+			break;
+		pos += width;
+	}
+	if (matched) {
+		for (int i = 0; 2 * i < capsLength; i++) {
+			bopat[i] = capsMatch[2 * i];
+			eopat[i] = capsMatch[2 * i + 1];
+		}
+	}
+	text = 0;
+	return matched;
+}
@@ -0,0 +1,141 @@
+// Scintilla source code edit control
+/** @file NFARegex.h
+ ** Linear time regular expression search over segmented text.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#ifndef NFAREGEX_H
+#define NFAREGEX_H
+
+#ifdef SCI_NAMESPACE
+namespace Scintilla {
+#endif
+
+/**
+ * Text that is made of a small number of contiguous segments, such as the
+ * two halves of a gap buffer.
+ */
+class SegmentedText {
+public:
+	virtual ~SegmentedText() {
+	}
+	/// Return a pointer to the text at position and set lengthSegment to the
+	/// number of bytes that can be read from it. Returns 0 outside the text.
+	virtual const char *Segment(int position, int &lengthSegment) = 0;
+	virtual int Length() const = 0;
+};
+
+class NFACharSet;
+
+/**
+ * Regular expression engine accepting the same syntax as RESearch except for
+ * back references. Patterns are compiled into a Thompson NFA which is run as
+ * a Pike VM so matching time is linear in the length of the text times the
+ * length of the pattern, without backtracking.
+ * In Unicode mode the pattern and text are decoded as UTF-8 so classes and
+ * '.' match whole characters.
+ * Matches do not extend over line ends unless the pattern asks for line end
+ * characters with \n, \r, \x0A or \x0D.
+ */
+class NFARegex {
+public:
+	explicit NFARegex(CharClassify *charClassTable);
+	~NFARegex();
+
+	const char *Compile(const char *pattern, int length, bool caseSensitive, bool posix, bool unicode);
+	bool Execute(SegmentedText &text, int startPos, int startLimit, int endPos, bool last=false);
+
+	/// Pattern could not be compiled as it needs back references
+	bool NeedsBacktracking() const {
+		return needsBacktracking;
+	}
+	bool MultiLine() const {
+		return multiLine;
+	}
+
+	enum { MAXTAG=10 };
+	enum { NOTFOUND=-1 };
+
+	int bopat[MAXTAG];
+	int eopat[MAXTAG];
+
+private:
+	enum { opChar, opAny, opSet, opSplit, opJump, opSave, opBol, opEol, opBow, opEow, opMatch };
+
+	struct Instruction {
+		int op;
+		int x;
+		int y;
+		Instruction(int op_=opMatch, int x_=0, int y_=0) : op(op_), x(x_), y(y_) {
+		}
+	};
+
+	struct Node;
+
+	/// Threads waiting to consume the character at one position
+	class ThreadList {
+	public:
+		std::vector<int> pcs;
+		std::vector<int> caps;
+		int count;
+		int stride;
+		ThreadList() : count(0), stride(0) {
+		}
+		void Allocate(size_t size, int stride_);
+		void Add(int pc, const int *capsThread);
+	};
+
+	CharClassify *charClass;
+	bool unicode;
+	bool caseSensitive;
+	bool multiLine;
+	bool needsBacktracking;
+	int firstByte;	// Byte every match must start with or -1
+	int capsLength;	// Number of positions recorded for the groups in the pattern
+
+	std::vector<Instruction> prog;
+	std::vector<NFACharSet *> sets;
+	std::vector<Node *> nodes;
+
+	// Execution state
+	SegmentedText *text;
+	const char *segment;
+	int segmentStart;
+	int segmentEnd;
+	ThreadList threadsA;
+	ThreadList threadsB;
+	std::vector<unsigned int> marks;
+	unsigned int generation;
+	std::vector<int> caps;
+	std::vector<int> capsMatch;
+
+	void Clear();
+
+	// Compilation
+	int NewNode(int type, int value=0, int value2=0);
+	int PatternChar(const char *pattern, int length, int &i) const;
+	int BackslashExpression(const char *pattern, int length, int &i, NFACharSet *set);
+	const char *ParseSet(const char *pattern, int length, int &i, int &node);
+	const char *ParseSequence(const char *pattern, int length, int &i, bool posix,
+		int &tagCount, int depth, int group, bool &closed);
+	int Emit(int op, int x=0, int y=0);
+	void Generate(int node);
+	void FindFirstByte();
+
+	// Execution
+	unsigned char ByteAt(int position);
+	int FindByte(int position, int limit, unsigned char ch);
+	int CharacterAt(int position, int &width);
+	bool IsWordByte(int position);
+	bool AssertionHolds(int op, int position);
+	bool IsWordCharacter(int ch) const;
+	bool CharacterMatches(const Instruction &inst, int ch) const;
+	void AddThread(ThreadList &list, unsigned int gen, int pc, int *capsThread, int position);
+	void AddStart(ThreadList &list, unsigned int gen, int position);
+};
+
+#ifdef SCI_NAMESPACE
+}
+#endif
+
+#endif
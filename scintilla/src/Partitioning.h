@@ -105,6 +105,17 @@ public:
 		stepPartition++;
 	}
 
+	/// Insert count partitions starting at the ascending positions in one operation.
+	void InsertPartitions(int partition, const int *positions, int count) {
+		if (count <= 0)
+			return;
+		if (stepPartition < partition) {
+			ApplyStep(partition);
+		}
+		body->InsertFromArray(partition, positions, 0, count);
+		stepPartition += count;
+	}
+
 	void SetPartitionStartPosition(int partition, int pos) {
 		ApplyStep(partition+1);
 		if ((partition < 0) || (partition > body->Length())) {
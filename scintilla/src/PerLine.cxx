@@ -144,6 +144,12 @@ void LineMarkers::InsertLine(int line) {
 	}
 }
 
+void LineMarkers::InsertLines(int line, int lines) {
+	if (markers.Length()) {
+		markers.InsertValue(line, lines, 0);
+	}
+}
+
 void LineMarkers::RemoveLine(int line) {
 	// Retain the markers from the deleted line by oring them into the previous line
 	if (markers.Length()) {
@@ -260,6 +266,13 @@ void LineLevels::InsertLine(int line) {
 	}
 }
 
+void LineLevels::InsertLines(int line, int lines) {
+	if (levels.Length()) {
+		int level = (line < levels.Length()) ? levels[line] : SC_FOLDLEVELBASE;
+		levels.InsertValue(line, lines, level);
+	}
+}
+
 void LineLevels::RemoveLine(int line) {
 	if (levels.Length()) {
 		// Move up following lines but merge header flag from this line
@@ -318,6 +331,14 @@ void LineState::InsertLine(int line) {
 	}
 }
 
+void LineState::InsertLines(int line, int lines) {
+	if (lineStates.Length()) {
+		lineStates.EnsureLength(line);
+		int val = (line < lineStates.Length()) ? lineStates[line] : 0;
+		lineStates.InsertValue(line, lines, val);
+	}
+}
+
 void LineState::RemoveLine(int line) {
 	if (lineStates.Length() > line) {
 		lineStates.Delete(line);
@@ -382,6 +403,13 @@ void LineAnnotation::InsertLine(int line) {
 	}
 }
 
+void LineAnnotation::InsertLines(int line, int lines) {
+	if (annotations.Length()) {
+		annotations.EnsureLength(line);
+		annotations.InsertValue(line, lines, 0);
+	}
+}
+
 void LineAnnotation::RemoveLine(int line) {
 	if (annotations.Length() && (line < annotations.Length())) {
 		delete []annotations[line];
@@ -51,6 +51,7 @@ public:
 	virtual ~LineMarkers();
 	virtual void Init();
 	virtual void InsertLine(int line);
+	virtual void InsertLines(int line, int lines);
 	virtual void RemoveLine(int line);
 
 	int MarkValue(int line);
@@ -68,6 +69,7 @@ public:
 	virtual ~LineLevels();
 	virtual void Init();
 	virtual void InsertLine(int line);
+	virtual void InsertLines(int line, int lines);
 	virtual void RemoveLine(int line);
 
 	void ExpandLevels(int sizeNew=-1);
@@ -84,6 +86,7 @@ public:
 	virtual ~LineState();
 	virtual void Init();
 	virtual void InsertLine(int line);
+	virtual void InsertLines(int line, int lines);
 	virtual void RemoveLine(int line);
 
 	int SetLineState(int line, int state);
@@ -99,6 +102,7 @@ public:
 	virtual ~LineAnnotation();
 	virtual void Init();
 	virtual void InsertLine(int line);
+	virtual void InsertLines(int line, int lines);
 	virtual void RemoveLine(int line);
 
 	bool AnySet() const;
@@ -13,6 +13,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <algorithm>
 
 #include "Platform.h"
 
@@ -50,6 +51,7 @@ LineLayout::LineLayout(int maxLineLength_) :
 	lenLineStarts(0),
 	lineNumber(-1),
 	inCache(false),
+	lastUsed(0),
 	maxLineLength(-1),
 	numCharsInLine(0),
 	numCharsBeforeEOL(0),
@@ -208,7 +210,8 @@ int LineLayout::EndLineStyle() const {
 
 LineLayoutCache::LineLayoutCache() :
 	level(0), length(0), size(0), cache(0),
-	allInvalidated(false), styleClock(-1), useCount(0) {
+	allInvalidated(false), styleClock(-1), useCount(0),
+	memoryUsed(0), clock(0) {
 	Allocate(0);
 }
 
@@ -242,21 +245,53 @@ void LineLayoutCache::AllocateForLevel(int linesOnScreen, int linesInDoc) {
 		lengthForLevel = linesInDoc;
 	}
 	if (lengthForLevel > size) {
-		Deallocate();
-		Allocate(lengthForLevel);
-	} else {
-		if (lengthForLevel < length) {
-			for (int i = lengthForLevel; i < length; i++) {
-				delete cache[i];
-				cache[i] = 0;
-			}
+		// Grow keeping the cached layouts as the document gains lines
+		int sizeNew = (lengthForLevel / 16 + 1) * 16;
+		LineLayout **cacheNew = new LineLayout * [sizeNew];
+		for (int i = 0; i < sizeNew; i++)
+			cacheNew[i] = (i < length) ? cache[i] : 0;
+		delete []cache;
+		cache = cacheNew;
+		size = sizeNew;
+	} else if (lengthForLevel < length) {
+		for (int i = lengthForLevel; i < length; i++) {
+			Discard(i);
 		}
-		length = lengthForLevel;
 	}
+	length = lengthForLevel;
 	PLATFORM_ASSERT(length == lengthForLevel);
 	PLATFORM_ASSERT(cache != NULL || length == 0);
 }
 
+static size_t MemoryForLayout(const LineLayout *ll) {
+	return sizeof(LineLayout) + (ll->maxLineLength + 1) *
+		(sizeof(ll->chars[0]) + sizeof(ll->styles[0]) + sizeof(ll->indicators[0]) + sizeof(ll->positions[0]));
+}
+
+void LineLayoutCache::Discard(int pos) {
+	if (cache[pos]) {
+		memoryUsed -= MemoryForLayout(cache[pos]);
+		delete cache[pos];
+		cache[pos] = 0;
+	}
+}
+
+/**
+ * Discard the layouts that were retrieved longest ago until a quarter of the
+ * memory limit is free. The most recent layout is always kept.
+ */
+void LineLayoutCache::DiscardLeastRecentlyUsed() {
+	std::vector<std::pair<unsigned int, int> > uses;
+	for (int i = 0; i < length; i++) {
+		if (cache[i])
+			uses.push_back(std::pair<unsigned int, int>(cache[i]->lastUsed, i));
+	}
+	std::sort(uses.begin(), uses.end());
+	for (size_t u = 0; (u + 1 < uses.size()) && (memoryUsed > memoryLimit / 4 * 3); u++) {
+		Discard(uses[u].second);
+	}
+}
+
 void LineLayoutCache::Deallocate() {
 	PLATFORM_ASSERT(useCount == 0);
 	for (int i = 0; i < length; i++)
@@ -265,6 +300,7 @@ void LineLayoutCache::Deallocate() {
 	cache = 0;
 	length = 0;
 	size = 0;
+	memoryUsed = 0;
 }
 
 void LineLayoutCache::Invalidate(LineLayout::validLevel validity_) {
@@ -280,6 +316,69 @@ void LineLayoutCache::Invalidate(LineLayout::validLevel validity_) {
 	}
 }
 
+/**
+ * Invalidate the layouts of the lines from lineFirst to lineLast inclusive
+ * after their text or styles changed.
+ */
+void LineLayoutCache::InvalidateLines(int lineFirst, int lineLast, LineLayout::validLevel validity_) {
+	if (!cache)
+		return;
+	if (level == llcDocument) {
+		lineFirst = Platform::Maximum(lineFirst, 0);
+		lineLast = Platform::Minimum(lineLast, length - 1);
+		for (int line = lineFirst; line <= lineLast; line++) {
+			if (cache[line])
+				cache[line]->Invalidate(validity_);
+		}
+	} else {
+		for (int i = 0; i < length; i++) {
+			if (cache[i] && (cache[i]->lineNumber >= lineFirst) && (cache[i]->lineNumber <= lineLast))
+				cache[i]->Invalidate(validity_);
+		}
+	}
+}
+
+/**
+ * Move the layouts of the lines from line onwards down to make room for lines
+ * inserted into the document. Other levels key the layouts by line so they are
+ * all checked against the text instead.
+ */
+void LineLayoutCache::InsertLines(int line, int lines) {
+	if ((level != llcDocument) || (line > length)) {
+		Invalidate(LineLayout::llCheckTextAndStyle);
+		return;
+	}
+	PLATFORM_ASSERT(useCount == 0);
+	const int lengthOld = length;
+	AllocateForLevel(0, length + lines);
+	memmove(cache + line + lines, cache + line, sizeof(cache[0]) * (lengthOld - line));
+	for (int i = line; i < line + lines; i++)
+		cache[i] = 0;
+	for (int i = line + lines; i < length; i++) {
+		if (cache[i])
+			cache[i]->lineNumber = i;
+	}
+}
+
+void LineLayoutCache::DeleteLines(int line, int lines) {
+	if ((level != llcDocument) || (line >= length)) {
+		Invalidate(LineLayout::llCheckTextAndStyle);
+		return;
+	}
+	PLATFORM_ASSERT(useCount == 0);
+	lines = Platform::Minimum(lines, length - line);
+	for (int i = line; i < line + lines; i++)
+		Discard(i);
+	memmove(cache + line, cache + line + lines, sizeof(cache[0]) * (length - line - lines));
+	for (int i = length - lines; i < length; i++)
+		cache[i] = 0;
+	length -= lines;
+	for (int i = line; i < length; i++) {
+		if (cache[i])
+			cache[i]->lineNumber = i;
+	}
+}
+
 void LineLayoutCache::SetLevel(int level_) {
 	allInvalidated = false;
 	if ((level_ != -1) && (level != level_)) {
@@ -292,7 +391,9 @@ LineLayout *LineLayoutCache::Retrieve(int lineNumber, int lineCaret, int maxChar
                                       int linesOnScreen, int linesInDoc) {
 	AllocateForLevel(linesOnScreen, linesInDoc);
 	if (styleClock != styleClock_) {
-		Invalidate(LineLayout::llCheckTextAndStyle);
+		// The document cache is invalidated line by line as text and styles change
+		if (level != llcDocument)
+			Invalidate(LineLayout::llCheckTextAndStyle);
 		styleClock = styleClock_;
 	}
 	allInvalidated = false;
@@ -315,16 +416,20 @@ LineLayout *LineLayoutCache::Retrieve(int lineNumber, int lineCaret, int maxChar
 			if (cache[pos]) {
 				if ((cache[pos]->lineNumber != lineNumber) ||
 				        (cache[pos]->maxLineLength < maxChars)) {
-					delete cache[pos];
-					cache[pos] = 0;
+					Discard(pos);
 				}
 			}
 			if (!cache[pos]) {
 				cache[pos] = new LineLayout(maxChars);
+				memoryUsed += MemoryForLayout(cache[pos]);
 			}
 			if (cache[pos]) {
 				cache[pos]->lineNumber = lineNumber;
 				cache[pos]->inCache = true;
+				cache[pos]->lastUsed = ++clock;
+				if ((level == llcDocument) && (memoryUsed > memoryLimit)) {
+					DiscardLeastRecentlyUsed();
+				}
 				ret = cache[pos];
 				useCount++;
 			}
@@ -26,6 +26,7 @@ private:
 	/// Drawing is only performed for @a maxLineLength characters on each line.
 	int lineNumber;
 	bool inCache;
+	unsigned int lastUsed;
 public:
 	enum { wrapWidthInfinite = 0x7ffffff };
 	int maxLineLength;
@@ -79,8 +80,15 @@ class LineLayoutCache {
 	bool allInvalidated;
 	int styleClock;
 	int useCount;
+	/// Approximate memory used by the cached layouts and the limit above which the
+	/// least recently used layouts are discarded in document mode
+	size_t memoryUsed;
+	enum { memoryLimit = 0x200000 };
+	unsigned int clock;
 	void Allocate(int length_);
 	void AllocateForLevel(int linesOnScreen, int linesInDoc);
+	void Discard(int pos);
+	void DiscardLeastRecentlyUsed();
 public:
 	LineLayoutCache();
 	virtual ~LineLayoutCache();
@@ -92,6 +100,9 @@ public:
 		llcDocument=SC_CACHE_DOCUMENT
 	};
 	void Invalidate(LineLayout::validLevel validity_);
+	void InvalidateLines(int lineFirst, int lineLast, LineLayout::validLevel validity_);
+	void InsertLines(int line, int lines);
+	void DeleteLines(int line, int lines);
 	void SetLevel(int level_);
 	int GetLevel() const { return level; }
 	LineLayout *Retrieve(int lineNumber, int lineCaret, int maxChars, int styleClock_,
@@ -262,6 +262,19 @@ public:
 		return body;
 	}
 
+	/// Return the storage, which the caller must delete [], after moving the gap
+	/// to the end. The vector continues with a copy of its elements so the
+	/// returned storage can be kept unchanged elsewhere.
+	T *DetachStorage() {
+		GapTo(lengthBody);
+		T *bodyOld = body;
+		if (bodyOld) {
+			body = new T[size];
+			memcpy(body, bodyOld, sizeof(T) * lengthBody);
+		}
+		return bodyOld;
+	}
+
 	T *RangePointer(int position, int rangeLength) {
 		if (position < part1Length) {
 			if ((position + rangeLength) > part1Length) {
@@ -276,8 +289,30 @@ public:
 		}
 	}
 
+	/// Return a pointer to the elements starting at position without moving the gap.
+	/// lengthContiguous is set to the number of elements that may be read from the
+	/// pointer before reaching either the gap or the end of the buffer.
+	const T *ContiguousRange(int position, int &lengthContiguous) const {
+		if ((position < 0) || (position >= lengthBody)) {
+			lengthContiguous = 0;
+			return 0;
+		}
+		if (position < part1Length) {
+			lengthContiguous = part1Length - position;
+			return body + position;
+		} else {
+			lengthContiguous = lengthBody - position;
+			return body + position + gapLength;
+		}
+	}
+
+	T *ContiguousRange(int position, int &lengthContiguous) {
+		return const_cast<T *>(
+			static_cast<const SplitVector<T> *>(this)->ContiguousRange(position, lengthContiguous));
+	}
+
 	int GapPosition() const {
-		return part1Length; 
+		return part1Length;
 	}
 };
 
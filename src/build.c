@@ -61,6 +61,7 @@
 #include "win32.h"
 #include "toolbar.h"
 #include "geanymenubuttonaction.h"
+#include "profile.h"
 #include "gtkcompat.h"
 
 /* g_spawn_async_with_pipes doesn't work on Windows */
@@ -71,10 +72,96 @@
 /* Number of editor indicators to draw - limited as this can affect performance */
 #define GEANY_BUILD_ERR_HIGHLIGHT_MAX 50
 
+/* Size of the chunks build output is read in */
+#define BUILD_READ_SIZE 65536
+/* Maximum number of output lines added to the compiler tab in one main loop iteration */
+#define BUILD_RECORDS_PER_IDLE 1000
+
 
 GeanyBuildInfo build_info = {GEANY_GBG_FT, 0, 0, NULL, GEANY_FILETYPES_NONE, NULL, 0};
 
-static gchar *current_dir_entered = NULL;
+/* State for parsing build output lines, see build_parser_parse_line() */
+typedef struct BuildParser
+{
+	GRegex *error_regex;	/* reference to the filetype error regex or NULL */
+	gint file_type_id;
+	gchar *dir;				/* locale encoded working directory */
+	gchar *dir_entered;		/* directory make reported it entered, or NULL */
+	gchar *current_file;	/* file name for messages without one, or NULL */
+}
+BuildParser;
+
+/* A line of build output after parsing */
+typedef struct BuildRecord
+{
+	gchar *text;
+	gchar *filename;		/* locale encoded file name of an error or NULL */
+	gint line;				/* line of an error, counting from 1, or -1 */
+	gint color;
+}
+BuildRecord;
+
+#ifndef SYNC_SPAWN
+/* A chunk of output read from the build command */
+typedef struct BuildChunk
+{
+	gint stream;			/* 0 for stdout, 1 for stderr */
+	gsize len;
+	gchar *data;
+}
+BuildChunk;
+
+struct BuildJob;
+
+/* user_data of the output channels of a job */
+typedef struct BuildStream
+{
+	struct BuildJob *job;
+	gint index;				/* 0 for stdout, 1 for stderr */
+}
+BuildStream;
+
+/* A build command that is queued or running. Several jobs can run at the same time,
+ * e.g. for Compile All Open Files, see build_jobs_start().
+ * The output of a job is read in large chunks on the main loop and split into lines
+ * and parsed on a separate thread, so the error regexes don't block the UI when a
+ * parallel make produces lots of output. The parsed records come back to the main
+ * thread in batches through an idle callback. */
+typedef struct BuildJob
+{
+	gchar **argv;
+	gchar *working_dir;		/* locale encoded */
+	GPid pid;
+	BuildStream streams[2];
+
+	GThread *thread;
+	GAsyncQueue *chunks;	/* BuildChunk to parse, build_chunk_end when done */
+	BuildParser parser;		/* only used by the parser thread */
+	GString *partial[2];	/* incomplete last line of each stream, parser thread only */
+
+	GMutex *lock;			/* protects the members below up to pending */
+	GPtrArray *records;		/* parsed BuildRecord waiting for the main thread */
+	gboolean idle_pending;	/* build_job_idle() is scheduled */
+	gboolean parsed_all;	/* the parser thread has finished */
+
+	/* only used by the main thread */
+	GPtrArray *pending;		/* records taken from records but not added yet */
+	guint pending_pos;
+	gint open_streams;
+	gboolean exited;
+	gboolean failure;
+}
+BuildJob;
+
+static BuildChunk build_chunk_end;
+static GQueue build_queue = G_QUEUE_INIT;	/* jobs waiting to be started */
+static GList *build_jobs = NULL;	/* started jobs whose output isn't all shown yet */
+static guint build_jobs_running = 0;	/* number of jobs whose command is running */
+#endif
+/* maximum number of build commands to run at the same time, 0 for one per processor */
+static gint build_max_jobs = 0;
+/* set to add the output of the next command to that of the running or last one */
+static gboolean build_keep_output = FALSE;
 
 typedef struct RunInfo
 {
@@ -129,9 +216,21 @@ static void run_exit_cb(GPid child_pid, gint status, gpointer user_data);
 static void on_set_build_commands_activate(GtkWidget *w, gpointer u);
 static void on_build_next_error(GtkWidget *menuitem, gpointer user_data);
 static void on_build_previous_error(GtkWidget *menuitem, gpointer user_data);
+static void on_build_compile_all(GtkWidget *menuitem, gpointer user_data);
 static void kill_process(GPid *pid);
 static void show_build_result_message(gboolean failure);
-static void process_build_output_line(const gchar *line, gint color);
+static void build_parser_init(BuildParser *parser, GeanyDocument *doc);
+static void build_parser_clear(BuildParser *parser);
+static BuildRecord *build_parser_parse_line(BuildParser *parser, const gchar *str, gint color);
+static void build_records_free(BuildRecord **records, guint count);
+static void build_add_records(BuildRecord **records, guint count);
+#ifndef SYNC_SPAWN
+static BuildJob *build_job_new(GeanyDocument *doc, gchar **argv, gchar *working_dir,
+		const gchar *header);
+static void build_job_wake(BuildJob *job);
+static void build_job_check_done(BuildJob *job);
+static void build_jobs_start(void);
+#endif
 static void show_build_commands_dialog(void);
 static void on_build_menu_item(GtkWidget *w, gpointer user_data);
 
@@ -666,11 +765,15 @@ static void clear_all_errors(void)
 
 
 #ifdef SYNC_SPAWN
-static void parse_build_output(const gchar **output, gint status)
+static void parse_build_output(GeanyDocument *doc, const gchar **output, gint status)
 {
 	guint x, i, len;
 	gchar *line, **lines;
+	BuildParser parser;
+	BuildRecord *record;
+	GPtrArray *records = g_ptr_array_new();
 
+	build_parser_init(&parser, doc);
 	for (x = 0; x < 2; x++)
 	{
 		if (NZV(output[x]))
@@ -689,12 +792,18 @@ static void parse_build_output(const gchar **output, gint status)
 							*line = 32;
 						line++;
 					}
-					process_build_output_line(lines[i], COLOR_BLACK);
+					record = build_parser_parse_line(&parser, lines[i], COLOR_BLACK);
+					if (record != NULL)
+						g_ptr_array_add(records, record);
 				}
 			}
 			g_strfreev(lines);
 		}
 	}
+	build_add_records((BuildRecord **) records->pdata, records->len);
+	build_records_free((BuildRecord **) records->pdata, records->len);
+	g_ptr_array_free(records, TRUE);
+	build_parser_clear(&parser);
 
 	show_build_result_message(status != 0);
 	utils_beep();
@@ -767,18 +876,16 @@ static gchar *build_replace_placeholder(const GeanyDocument *doc, const gchar *s
  * idx document directory */
 static GPid build_spawn_cmd(GeanyDocument *doc, const gchar *cmd, const gchar *dir)
 {
-	GError *error = NULL;
 	gchar **argv;
 	gchar *working_dir;
 	gchar *utf8_working_dir;
 	gchar *cmd_string;
 	gchar *utf8_cmd_string;
+	gchar *header;
 #ifdef SYNC_SPAWN
+	GError *error = NULL;
 	gchar *output[2];
 	gint status;
-#else
-	gint stdout_fd;
-	gint stderr_fd;
 #endif
 
 	if (!((doc != NULL && NZV(doc->file_name)) || NZV(dir)))
@@ -788,9 +895,6 @@ static GPid build_spawn_cmd(GeanyDocument *doc, const gchar *cmd, const gchar *d
 		return (GPid) 1;
 	}
 
-	clear_all_errors();
-	SETPTR(current_dir_entered, NULL);
-
 	cmd_string = g_strdup(cmd);
 
 #ifdef G_OS_WIN32
@@ -807,9 +911,15 @@ static GPid build_spawn_cmd(GeanyDocument *doc, const gchar *cmd, const gchar *d
 	utf8_working_dir = NZV(dir) ? g_strdup(dir) : g_path_get_dirname(doc->file_name);
 	working_dir = utils_get_locale_from_utf8(utf8_working_dir);
 
-	gtk_list_store_clear(msgwindow.store_compiler);
+	/* the output of the last build is replaced, unless this command joins running ones */
+	if (! build_keep_output && build_info.pid == 0)
+	{
+		clear_all_errors();
+		msgwin_compiler_clear();
+		build_info.message_count = 0;
+	}
 	gtk_notebook_set_current_page(GTK_NOTEBOOK(msgwindow.notebook), MSG_COMPILER);
-	msgwin_compiler_add(COLOR_BLUE, _("%s (in directory: %s)"), utf8_cmd_string, utf8_working_dir);
+	header = g_strdup_printf(_("%s (in directory: %s)"), utf8_cmd_string, utf8_working_dir);
 	g_free(utf8_working_dir);
 	g_free(utf8_cmd_string);
 
@@ -817,16 +927,13 @@ static GPid build_spawn_cmd(GeanyDocument *doc, const gchar *cmd, const gchar *d
 	g_free(build_info.dir);
 	build_info.dir = g_strdup(working_dir);
 	build_info.file_type_id = (doc == NULL) ? GEANY_FILETYPES_NONE : doc->file_type->id;
-	build_info.message_count = 0;
 
 #ifdef SYNC_SPAWN
+	msgwin_compiler_add_string(COLOR_BLUE, header);
+	g_free(header);
+
 	if (! utils_spawn_sync(working_dir, argv, NULL, G_SPAWN_SEARCH_PATH,
 			NULL, NULL, &output[0], &output[1], &status, &error))
-#else
-	if (! g_spawn_async_with_pipes(working_dir, argv, NULL,
-			G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD, NULL, NULL,
-			&(build_info.pid), NULL, &stdout_fd, &stderr_fd, &error))
-#endif
 	{
 		geany_debug("build command spawning failed: %s", error->message);
 		ui_set_statusbar(TRUE, _("Process failed (%s)"), error->message);
@@ -837,27 +944,18 @@ static GPid build_spawn_cmd(GeanyDocument *doc, const gchar *cmd, const gchar *d
 		return (GPid) 0;
 	}
 
-#ifdef SYNC_SPAWN
-	parse_build_output((const gchar**) output, status);
+	parse_build_output(doc, (const gchar**) output, status);
 	g_free(output[0]);
 	g_free(output[1]);
-#else
-	if (build_info.pid > 0)
-	{
-		g_child_watch_add(build_info.pid, (GChildWatchFunc) build_exit_cb, NULL);
-		build_menu_update(doc);
-		ui_progress_bar_start(NULL);
-	}
-
-	/* use GIOChannels to monitor stdout and stderr */
-	utils_set_up_io_channel(stdout_fd, G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP | G_IO_NVAL,
-		TRUE, build_iofunc, GINT_TO_POINTER(0));
-	utils_set_up_io_channel(stderr_fd, G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP | G_IO_NVAL,
-		TRUE, build_iofunc, GINT_TO_POINTER(1));
-#endif
 
 	g_strfreev(argv);
 	g_free(working_dir);
+#else
+	/* the job parses its output using the build info set above */
+	g_queue_push_tail(&build_queue, build_job_new(doc, argv, working_dir, header));
+	g_free(header);
+	build_jobs_start();
+#endif
 
 	return build_info.pid;
 }
@@ -1063,11 +1161,37 @@ static GPid build_run_cmd(GeanyDocument *doc, guint cmdindex)
 }
 
 
-static void process_build_output_line(const gchar *str, gint color)
+/* doc is the document the command was run for, or NULL. Errors without a file name are
+ * reported for its file. */
+static void build_parser_init(BuildParser *parser, GeanyDocument *doc)
+{
+	parser->error_regex = filetypes_get_error_regex(filetypes[build_info.file_type_id]);
+	if (parser->error_regex != NULL)
+		g_regex_ref(parser->error_regex);
+	parser->file_type_id = build_info.file_type_id;
+	parser->dir = g_strdup(build_info.dir);
+	parser->dir_entered = NULL;
+	parser->current_file = (doc != NULL) ? g_strdup(doc->file_name) : NULL;
+}
+
+
+static void build_parser_clear(BuildParser *parser)
+{
+	if (parser->error_regex != NULL)
+		g_regex_unref(parser->error_regex);
+	g_free(parser->dir);
+	g_free(parser->dir_entered);
+	g_free(parser->current_file);
+}
+
+
+/* Parses a line of build output. This doesn't use any global state so it can be run
+ * from the parser thread.
+ * Returns: the parsed line or NULL if it is empty. */
+static BuildRecord *build_parser_parse_line(BuildParser *parser, const gchar *str, gint color)
 {
+	BuildRecord *record;
 	gchar *msg, *tmp;
-	gchar *filename;
-	gint line;
 
 	msg = g_strdup(str);
 
@@ -1076,58 +1200,537 @@ static void process_build_output_line(const gchar *str, gint color)
 	if (! NZV(msg))
 	{
 		g_free(msg);
-		return;
+		return NULL;
 	}
 
 	if (build_parse_make_dir(msg, &tmp))
 	{
-		SETPTR(current_dir_entered, tmp);
+		SETPTR(parser->dir_entered, tmp);
 	}
-	msgwin_parse_compiler_error_line(msg, current_dir_entered, &filename, &line);
 
-	if (line != -1 && filename != NULL)
+	record = g_new(BuildRecord, 1);
+	record->text = msg;
+	msgwin_parse_compiler_error_line_full(msg,
+		(parser->dir_entered != NULL) ? parser->dir_entered : parser->dir,
+		parser->file_type_id, parser->error_regex, parser->current_file,
+		&record->filename, &record->line);
+
+	if (record->line != -1 && record->filename != NULL)
+		color = COLOR_RED;	/* error message parsed on the line */
+	else
 	{
-		GeanyDocument *doc = document_find_by_filename(filename);
+		SETPTR(record->filename, NULL);
+		record->line = -1;
+	}
+	record->color = color;
+	return record;
+}
+
+
+static void build_records_free(BuildRecord **records, guint count)
+{
+	guint i;
+
+	for (i = 0; i < count; i++)
+	{
+		g_free(records[i]->text);
+		g_free(records[i]->filename);
+		g_free(records[i]);
+	}
+}
+
+
+static gint compare_lines(gconstpointer a, gconstpointer b)
+{
+	return *(const gint *) a - *(const gint *) b;
+}
+
+
+static void set_error_indicators(gpointer key, gpointer value, gpointer user_data)
+{
+	GeanyDocument *doc = key;
+	GArray *lines = value;
+	guint i;
+
+	/* compilers often report several errors on a line, only mark each line once */
+	g_array_sort(lines, compare_lines);
+	for (i = 0; i < lines->len; i++)
+	{
+		gint line = g_array_index(lines, gint, i);
+
+		if (i == 0 || line != g_array_index(lines, gint, i - 1))
+			editor_indicator_set_on_line(doc->editor, GEANY_INDICATOR_ERROR, line);
+	}
+	g_array_free(lines, TRUE);
+}
+
+
+/* Adds parsed build output to the compiler tab and marks the errors in open documents.
+ * The documents are looked up once per file name and the indicators are set per
+ * document after all records are known. */
+static void build_add_records(BuildRecord **records, guint count)
+{
+	GHashTable *docs;	/* file name -> GeanyDocument, or NULL when the file isn't open */
+	GHashTable *doc_lines;	/* GeanyDocument -> GArray of lines to mark */
+	const gchar **texts;
+	const gchar **filenames;
+	gint *colors;
+	gint *lines;
+	guint i;
+
+	if (count == 0)
+		return;
+
+	docs = g_hash_table_new(g_str_hash, g_str_equal);
+	doc_lines = g_hash_table_new(g_direct_hash, g_direct_equal);
+	texts = g_new(const gchar *, count);
+	filenames = g_new(const gchar *, count);
+	colors = g_new(gint, count);
+	lines = g_new(gint, count);
+
+	for (i = 0; i < count; i++)
+	{
+		BuildRecord *record = records[i];
+
+		texts[i] = record->text;
+		filenames[i] = record->filename;
+		colors[i] = record->color;
+		lines[i] = record->line;
+
+		if (record->filename == NULL)
+			continue;
 
 		/* limit number of indicators */
-		if (doc && editor_prefs.use_indicators &&
+		if (editor_prefs.use_indicators &&
 			build_info.message_count < GEANY_BUILD_ERR_HIGHLIGHT_MAX)
 		{
-			if (line > 0) /* some compilers, like pdflatex report errors on line 0 */
-				line--;   /* so only adjust the line number if it is greater than 0 */
-			editor_indicator_set_on_line(doc->editor, GEANY_INDICATOR_ERROR, line);
+			GeanyDocument *doc;
+			gpointer value;
+
+			if (g_hash_table_lookup_extended(docs, record->filename, NULL, &value))
+				doc = value;
+			else
+			{
+				doc = document_find_by_filename(record->filename);
+				/* the errors are marked by build_mark_errors() when the file is read */
+				if (doc != NULL && document_is_pending(doc))
+					doc = NULL;
+				g_hash_table_insert(docs, record->filename, doc);
+			}
+			if (doc != NULL)
+			{
+				GArray *marks = g_hash_table_lookup(doc_lines, doc);
+				gint line = record->line;
+
+				if (marks == NULL)
+				{
+					marks = g_array_new(FALSE, FALSE, sizeof(gint));
+					g_hash_table_insert(doc_lines, doc, marks);
+				}
+				if (line > 0) /* some compilers, like pdflatex report errors on line 0 */
+					line--;   /* so only adjust the line number if it is greater than 0 */
+				g_array_append_val(marks, line);
+			}
 		}
 		build_info.message_count++;
-		color = COLOR_RED;	/* error message parsed on the line */
 	}
-	g_free(filename);
+	g_hash_table_foreach(doc_lines, set_error_indicators, NULL);
+
+	msgwin_compiler_add_strings(count, colors, texts, filenames, lines);
+
+	g_hash_table_destroy(docs);
+	g_hash_table_destroy(doc_lines);
+	g_free(texts);
+	g_free(filenames);
+	g_free(colors);
+	g_free(lines);
+}
+
+
+/* Marks the errors of the last build in doc, when it was opened after the errors were
+ * reported. */
+void build_mark_errors(GeanyDocument *doc)
+{
+	const gint *lines;
+	guint count, marked, i;
+
+	if (! editor_prefs.use_indicators || doc->real_path == NULL)
+		return;
 
-	msgwin_compiler_add_string(color, msg);
-	g_free(msg);
+	count = msgwin_compiler_get_error_lines(doc->real_path, &lines);
+	/* limit number of indicators, lines with several errors are only counted once */
+	marked = 0;
+	for (i = 0; i < count && marked < GEANY_BUILD_ERR_HIGHLIGHT_MAX; i++)
+	{
+		gint line = lines[i];
+
+		if (i > 0 && line == lines[i - 1])
+			continue;
+		if (line > 0) /* some compilers, like pdflatex report errors on line 0 */
+			line--;
+		editor_indicator_set_on_line(doc->editor, GEANY_INDICATOR_ERROR, line);
+		marked++;
+	}
 }
 
 
 #ifndef SYNC_SPAWN
+static void build_job_free(BuildJob *job)
+{
+	build_parser_clear(&job->parser);
+	g_strfreev(job->argv);
+	g_free(job->working_dir);
+	g_string_free(job->partial[0], TRUE);
+	g_string_free(job->partial[1], TRUE);
+	g_async_queue_unref(job->chunks);
+	g_mutex_free(job->lock);
+	build_records_free((BuildRecord **) job->records->pdata, job->records->len);
+	g_ptr_array_free(job->records, TRUE);
+	build_records_free((BuildRecord **) job->pending->pdata + job->pending_pos,
+		job->pending->len - job->pending_pos);
+	g_ptr_array_free(job->pending, TRUE);
+	g_free(job);
+}
+
+
+static void build_job_finish(BuildJob *job)
+{
+	if (job->thread != NULL)
+		g_thread_join(job->thread);
+
+	show_build_result_message(job->failure);
+
+	build_jobs = g_list_remove(build_jobs, job);
+	build_job_free(job);
+
+	if (build_jobs != NULL)
+	{
+		/* show the output the next job has collected meanwhile */
+		build_job_wake(build_jobs->data);
+	}
+	else
+	{
+		utils_beep();
+		build_info.pid = 0;
+		ui_progress_bar_stop();
+	}
+	/* enable build items again */
+	build_menu_update(NULL);
+}
+
+
+/* Adds some of the parsed records to the compiler tab, limited so that the UI stays
+ * responsive when there are lots of them.
+ * Only the oldest running job adds its records, the others keep them until it has
+ * finished, so that the output of each job stays together. */
+static gboolean build_job_idle(gpointer data)
+{
+	BuildJob *job = data;
+	gboolean head = build_jobs != NULL && build_jobs->data == job;
+	gboolean more, finished;
+	guint count;
+
+	g_mutex_lock(job->lock);
+	for (count = 0; count < job->records->len; count++)
+		g_ptr_array_add(job->pending, g_ptr_array_index(job->records, count));
+	g_ptr_array_set_size(job->records, 0);
+	g_mutex_unlock(job->lock);
+
+	if (head)
+	{
+		ProfileTimer timer;
+
+		profile_timer_start(&timer, PROFILE_BUILD_RECORDS);
+		count = MIN(job->pending->len - job->pending_pos, BUILD_RECORDS_PER_IDLE);
+		build_add_records((BuildRecord **) job->pending->pdata + job->pending_pos, count);
+		build_records_free((BuildRecord **) job->pending->pdata + job->pending_pos, count);
+		job->pending_pos += count;
+		if (job->pending_pos == job->pending->len)
+		{
+			g_ptr_array_set_size(job->pending, 0);
+			job->pending_pos = 0;
+		}
+		profile_timer_stop(&timer);
+	}
+
+	g_mutex_lock(job->lock);
+	more = head && (job->pending->len > 0 || job->records->len > 0);
+	finished = head && job->parsed_all && ! more;
+	if (! more)
+		job->idle_pending = FALSE;
+	g_mutex_unlock(job->lock);
+
+	if (finished)
+		build_job_finish(job);
+	return more;
+}
+
+
+/* Makes sure build_job_idle() runs for job. */
+static void build_job_wake(BuildJob *job)
+{
+	g_mutex_lock(job->lock);
+	if (! job->idle_pending)
+	{
+		job->idle_pending = TRUE;
+		g_idle_add(build_job_idle, job);
+	}
+	g_mutex_unlock(job->lock);
+}
+
+
+/* Hands the records in batch to the main thread and empties batch.
+ * last is set when there will be no more output. */
+static void build_job_deliver(BuildJob *job, GPtrArray *batch, gboolean last)
+{
+	guint i;
+
+	if (batch->len == 0 && ! last)
+		return;
+
+	g_mutex_lock(job->lock);
+	for (i = 0; i < batch->len; i++)
+		g_ptr_array_add(job->records, g_ptr_array_index(batch, i));
+	g_ptr_array_set_size(batch, 0);
+	if (last)
+		job->parsed_all = TRUE;
+	g_mutex_unlock(job->lock);
+
+	build_job_wake(job);
+}
+
+
+/* Splits a chunk of output into lines and parses them, or parses the incomplete last
+ * lines when the chunk is build_chunk_end. */
+static void build_job_parse_chunk(BuildJob *job, BuildChunk *chunk)
+{
+	GPtrArray *batch = g_ptr_array_new();
+	BuildRecord *record;
+
+	if (chunk == &build_chunk_end)
+	{
+		gint stream;
+
+		for (stream = 0; stream < 2; stream++)
+		{
+			record = build_parser_parse_line(&job->parser, job->partial[stream]->str,
+				stream ? COLOR_DARK_RED : COLOR_BLACK);
+			if (record != NULL)
+				g_ptr_array_add(batch, record);
+		}
+		build_job_deliver(job, batch, TRUE);
+	}
+	else
+	{
+		GString *partial = job->partial[chunk->stream];
+		gint color = chunk->stream ? COLOR_DARK_RED : COLOR_BLACK;
+		const gchar *pos = chunk->data;
+		const gchar *end = chunk->data + chunk->len;
+
+		while (pos < end)
+		{
+			const gchar *eol = pos;
+
+			while (eol < end && *eol != '\n' && *eol != '\r')
+				eol++;
+			g_string_append_len(partial, pos, eol - pos);
+			if (eol == end)
+				break;
+
+			record = build_parser_parse_line(&job->parser, partial->str, color);
+			if (record != NULL)
+				g_ptr_array_add(batch, record);
+			g_string_truncate(partial, 0);
+			pos = eol + 1;
+		}
+		build_job_deliver(job, batch, FALSE);
+
+		g_free(chunk->data);
+		g_free(chunk);
+	}
+	g_ptr_array_free(batch, TRUE);
+}
+
+
+static gpointer build_job_thread(gpointer data)
+{
+	BuildJob *job = data;
+	BuildChunk *chunk;
+
+	do
+	{
+		chunk = g_async_queue_pop(job->chunks);
+		build_job_parse_chunk(job, chunk);
+	}
+	while (chunk != &build_chunk_end);
+
+	return NULL;
+}
+
+
+static void build_job_push(BuildJob *job, BuildChunk *chunk)
+{
+	if (job->thread != NULL)
+		g_async_queue_push(job->chunks, chunk);
+	else
+		build_job_parse_chunk(job, chunk);
+}
+
+
+/* Creates a job to run argv in the locale encoded working_dir, taking ownership of both.
+ * The errors are parsed using the current build_info, and those without a file name are
+ * reported for the file of doc. header is shown before the output of the job. */
+static BuildJob *build_job_new(GeanyDocument *doc, gchar **argv, gchar *working_dir,
+		const gchar *header)
+{
+	BuildJob *job = g_new0(BuildJob, 1);
+	BuildRecord *record = g_new(BuildRecord, 1);
+
+	job->argv = argv;
+	job->working_dir = working_dir;
+	build_parser_init(&job->parser, doc);
+	job->partial[0] = g_string_new(NULL);
+	job->partial[1] = g_string_new(NULL);
+	job->streams[0].job = job;
+	job->streams[0].index = 0;
+	job->streams[1].job = job;
+	job->streams[1].index = 1;
+	job->chunks = g_async_queue_new();
+	job->lock = g_mutex_new();
+	job->records = g_ptr_array_new();
+	job->pending = g_ptr_array_new();
+
+	record->text = g_strdup(header);
+	record->filename = NULL;
+	record->line = -1;
+	record->color = COLOR_BLUE;
+	g_ptr_array_add(job->pending, record);
+	return job;
+}
+
+
+/* Returns: FALSE if the command couldn't be started. */
+static gboolean build_job_spawn(BuildJob *job)
+{
+	GError *error = NULL;
+	gint stdout_fd;
+	gint stderr_fd;
+
+	if (! g_spawn_async_with_pipes(job->working_dir, job->argv, NULL,
+			G_SPAWN_SEARCH_PATH | G_SPAWN_DO_NOT_REAP_CHILD, NULL, NULL,
+			&job->pid, NULL, &stdout_fd, &stderr_fd, &error))
+	{
+		geany_debug("build command spawning failed: %s", error->message);
+		ui_set_statusbar(TRUE, _("Process failed (%s)"), error->message);
+		g_error_free(error);
+		return FALSE;
+	}
+
+	job->thread = g_thread_create(build_job_thread, job, TRUE, &error);
+	if (job->thread == NULL)
+	{
+		/* not fatal, the output will be parsed on the main thread instead */
+		geany_debug("Could not create the build output thread: %s", error->message);
+		g_error_free(error);
+	}
+
+	g_child_watch_add(job->pid, (GChildWatchFunc) build_exit_cb, job);
+
+	/* use GIOChannels to monitor stdout and stderr */
+	utils_set_up_io_channel(stdout_fd, G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP | G_IO_NVAL,
+		TRUE, build_iofunc, &job->streams[0]);
+	utils_set_up_io_channel(stderr_fd, G_IO_IN | G_IO_PRI | G_IO_ERR | G_IO_HUP | G_IO_NVAL,
+		TRUE, build_iofunc, &job->streams[1]);
+	job->open_streams = 2;
+	return TRUE;
+}
+
+
+static guint get_max_jobs(void)
+{
+	if (build_max_jobs > 0)
+		return build_max_jobs;
+#ifdef _SC_NPROCESSORS_ONLN
+	{
+		glong processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+		if (processors > 0)
+			return processors;
+	}
+#endif
+	return 1;
+}
+
+
+/* Starts queued jobs while fewer than the maximum number of jobs are running. */
+static void build_jobs_start(void)
+{
+	while (build_jobs_running < get_max_jobs() && ! g_queue_is_empty(&build_queue))
+	{
+		BuildJob *job = g_queue_pop_head(&build_queue);
+
+		if (! build_job_spawn(job))
+		{
+			build_job_free(job);
+			continue;
+		}
+		if (build_jobs == NULL)
+			ui_progress_bar_start(NULL);
+		build_jobs = g_list_append(build_jobs, job);
+		build_jobs_running++;
+		build_info.pid = job->pid;
+
+		if (build_jobs->data == job)
+			build_job_wake(job);	/* show the header */
+	}
+}
+
+
+/* Once the command has exited and all its output is read, tells the parser there is no
+ * more output. The job is finished when the last records have been added. */
+static void build_job_check_done(BuildJob *job)
+{
+	if (job->exited && job->open_streams == 0)
+		build_job_push(job, &build_chunk_end);
+}
+
+
 static gboolean build_iofunc(GIOChannel *ioc, GIOCondition cond, gpointer data)
 {
+	static gchar buf[BUILD_READ_SIZE];
+	BuildStream *stream = data;
+	BuildJob *job = stream->job;
+
 	if (cond & (G_IO_IN | G_IO_PRI))
 	{
-		gchar *msg;
 		GIOStatus st;
+		gsize len;
+		ProfileTimer timer;
 
-		while ((st = g_io_channel_read_line(ioc, &msg, NULL, NULL, NULL)) == G_IO_STATUS_NORMAL && msg)
+		profile_timer_start(&timer, PROFILE_BUILD_READ);
+		while ((st = g_io_channel_read_chars(ioc, buf, sizeof(buf), &len, NULL)) ==
+			G_IO_STATUS_NORMAL && len > 0)
 		{
-			gint color = (GPOINTER_TO_INT(data)) ? COLOR_DARK_RED : COLOR_BLACK;
+			BuildChunk *chunk = g_new(BuildChunk, 1);
 
-			process_build_output_line(msg, color);
- 			g_free(msg);
+			chunk->stream = stream->index;
+			chunk->len = len;
+			chunk->data = g_memdup(buf, len);
+			build_job_push(job, chunk);
 		}
-		if (st == G_IO_STATUS_ERROR || st == G_IO_STATUS_EOF) return FALSE;
+		profile_timer_stop(&timer);
+		if (st == G_IO_STATUS_ERROR || st == G_IO_STATUS_EOF)
+			goto closed;
 	}
 	if (cond & (G_IO_ERR | G_IO_HUP | G_IO_NVAL))
-		return FALSE;
+		goto closed;
 
 	return TRUE;
+
+	closed:
+	job->open_streams--;
+	build_job_check_done(job);
+	return FALSE;
 }
 #endif
 
@@ -1205,6 +1808,7 @@ static void show_build_result_message(gboolean failure)
 #ifndef SYNC_SPAWN
 static void build_exit_cb(GPid child_pid, gint status, gpointer user_data)
 {
+	BuildJob *job = user_data;
 	gboolean failure = FALSE;
 
 #ifdef G_OS_WIN32
@@ -1225,15 +1829,15 @@ static void build_exit_cb(GPid child_pid, gint status, gpointer user_data)
 		failure = TRUE;
 	}
 #endif
-	show_build_result_message(failure);
-
-	utils_beep();
 	g_spawn_close_pid(child_pid);
 
-	build_info.pid = 0;
-	/* enable build items again */
-	build_menu_update(NULL);
-	ui_progress_bar_stop();
+	/* the result is shown once the remaining output has been parsed */
+	job->failure = failure;
+	job->exited = TRUE;
+	build_job_check_done(job);
+
+	build_jobs_running--;
+	build_jobs_start();
 }
 #endif
 
@@ -1428,7 +2032,8 @@ static void on_build_menu_item(GtkWidget *w, gpointer user_data)
 #define MENU_NEXT_ERROR  (MENU_SEPARATOR + 1)
 #define MENU_PREV_ERROR  (MENU_NEXT_ERROR + 1)
 #define MENU_COMMANDS	(MENU_PREV_ERROR + 1)
-#define MENU_DONE		(MENU_COMMANDS + 1)
+#define MENU_COMPILE_ALL (MENU_COMMANDS + 1)
+#define MENU_DONE		(MENU_COMPILE_ALL + 1)
 
 
 static struct BuildMenuItemSpec {
@@ -1445,6 +2050,8 @@ static struct BuildMenuItemSpec {
 		GBO_TO_CMD(GEANY_GBO_BUILD), NULL, on_build_menu_item},
 	{NULL, -1, MENU_FT_REST,
 		GBO_TO_CMD(GEANY_GBO_BUILD) + 1, NULL, on_build_menu_item},
+	{NULL, -1, MENU_COMPILE_ALL,
+		GBF_COMPILE_ALL, N_("Compile _All Open Files"), on_build_compile_all},
 	{NULL, -1, MENU_SEPARATOR,
 		GBF_SEP_1, NULL, NULL},
 	{NULL, GEANY_KEYS_BUILD_MAKE, GBO_TO_GBG(GEANY_GBO_MAKE_ALL),
@@ -1611,6 +2218,11 @@ void build_menu_update(GeanyDocument *doc)
 			case MENU_COMMANDS:
 				vis |= TRUE;
 				break;
+			case MENU_COMPILE_ALL:
+				gtk_widget_set_sensitive(menu_items.menu_item[GBG_FIXED][bs->build_cmd],
+					! build_running);
+				vis |= TRUE;
+				break;
 			default: /* all configurable commands */
 				if (bs->build_grp >= GEANY_GBG_COUNT)
 				{
@@ -1804,8 +2416,7 @@ static void kill_process(GPid *pid)
 
 static void on_build_next_error(GtkWidget *menuitem, gpointer user_data)
 {
-	if (ui_tree_view_find_next(GTK_TREE_VIEW(msgwindow.tree_compiler),
-		msgwin_goto_compiler_file_line))
+	if (msgwin_compiler_goto_next_error(TRUE))
 	{
 		gtk_notebook_set_current_page(GTK_NOTEBOOK(msgwindow.notebook), MSG_COMPILER);
 	}
@@ -1816,8 +2427,7 @@ static void on_build_next_error(GtkWidget *menuitem, gpointer user_data)
 
 static void on_build_previous_error(GtkWidget *menuitem, gpointer user_data)
 {
-	if (ui_tree_view_find_previous(GTK_TREE_VIEW(msgwindow.tree_compiler),
-		msgwin_goto_compiler_file_line))
+	if (msgwin_compiler_goto_next_error(FALSE))
 	{
 		gtk_notebook_set_current_page(GTK_NOTEBOOK(msgwindow.notebook), MSG_COMPILER);
 	}
@@ -1826,6 +2436,37 @@ static void on_build_previous_error(GtkWidget *menuitem, gpointer user_data)
 }
 
 
+/* Compiles each open document that has a compile command. The commands run at the same
+ * time, up to the maximum number of build jobs. */
+static void on_build_compile_all(GtkWidget *menuitem, gpointer user_data)
+{
+	guint i;
+	guint cmd = GBO_TO_CMD(GEANY_GBO_COMPILE);
+	gboolean started = FALSE;
+
+	foreach_document(i)
+	{
+		GeanyDocument *doc = documents[i];
+
+		if (doc->file_name == NULL || get_build_cmd(doc, GEANY_GBG_FT, cmd, NULL) == NULL)
+			continue;
+		if (doc->changed && ! document_save_file(doc, FALSE))
+			continue;
+
+		if (! started)
+			g_signal_emit_by_name(geany_object, "build-start");
+		build_command(doc, GEANY_GBG_FT, cmd, NULL);
+		/* show the output of all files together */
+		build_keep_output = TRUE;
+		started = TRUE;
+	}
+	build_keep_output = FALSE;
+
+	if (! started)
+		ui_set_statusbar(FALSE, _("No open file can be compiled."));
+}
+
+
 void build_toolbutton_build_clicked(GtkAction *action, gpointer unused)
 {
 	if (last_toolbutton_action == GBO_TO_POINTER(GEANY_GBO_BUILD))
@@ -2759,6 +3400,16 @@ void build_set_group_count(GeanyBuildGroup grp, gint count)
 }
 
 
+/* Sets the maximum number of build commands to run at the same time,
+ * 0 for one per processor. */
+void build_set_max_jobs(gint count)
+{
+	g_return_if_fail(count >= 0);
+
+	build_max_jobs = count;
+}
+
+
 /** Get the count of commands for the group
  *
  * Get the number of commands in the group specified by @a grp.
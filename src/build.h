@@ -91,6 +91,7 @@ enum GeanyBuildFixedMenuItems
 	GBF_SEP_2,
 	GBF_SEP_3,
 	GBF_SEP_4,
+	GBF_COMPILE_ALL,
 	GBF_COUNT
 };
 
@@ -177,6 +178,8 @@ gboolean build_parse_make_dir(const gchar *string, gchar **prefix);
 
 void build_menu_update(GeanyDocument *doc);
 
+void build_mark_errors(GeanyDocument *doc);
+
 void build_toolbutton_build_clicked(GtkAction *action, gpointer user_data);
 
 void build_remove_menu_item(const GeanyBuildSource src, const GeanyBuildGroup grp, const gint cmd);
@@ -200,6 +203,8 @@ void build_save_menu(GKeyFile *config, gpointer ptr, GeanyBuildSource src);
 
 void build_set_group_count(GeanyBuildGroup grp, gint count);
 
+void build_set_max_jobs(gint count);
+
 guint build_get_group_count(const GeanyBuildGroup grp);
 
 gchar **build_get_regex(GeanyBuildGroup grp, GeanyFiletype *ft, guint *from);
@@ -65,6 +65,7 @@
 #include "toolbar.h"
 #include "highlighting.h"
 #include "pluginutils.h"
+#include "profile.h"
 #include "gtkcompat.h"
 
 
@@ -618,6 +619,9 @@ G_MODULE_EXPORT void on_notebook1_switch_page_after(GtkNotebook *notebook, gpoin
 
 	if (doc != NULL)
 	{
+		/* read the file of a restored session document when it is first shown */
+		document_load_pending(doc);
+
 		sidebar_select_openfiles_item(doc);
 		ui_save_buttons_toggle(doc->changed);
 		ui_set_window_title(doc);
@@ -1967,6 +1971,12 @@ G_MODULE_EXPORT void on_debug_messages1_activate(GtkMenuItem *menuitem, gpointer
 }
 
 
+G_MODULE_EXPORT void on_performance1_activate(GtkMenuItem *menuitem, gpointer user_data)
+{
+	profile_show_dialog();
+}
+
+
 G_MODULE_EXPORT void on_send_selection_to_vte1_activate(GtkMenuItem *menuitem, gpointer user_data)
 {
 #ifdef HAVE_VTE
@@ -570,6 +570,10 @@ G_MODULE_EXPORT void
 on_debug_messages1_activate			(GtkMenuItem	 *menuitem,
 										gpointer		 user_data);
 
+G_MODULE_EXPORT void
+on_performance1_activate			   (GtkMenuItem	 *menuitem,
+										gpointer		 user_data);
+
 G_MODULE_EXPORT void
 on_menu_show_white_space1_toggled	  (GtkCheckMenuItem *checkmenuitem,
 										gpointer		 user_data);
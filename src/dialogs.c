@@ -1145,7 +1145,8 @@ void dialogs_show_file_properties(GeanyDocument *doc)
 {
 	GtkWidget *dialog, *label, *table, *hbox, *image, *perm_table, *check, *vbox;
 	gchar *file_size, *title, *base_name, *time_changed, *time_modified, *time_accessed, *enctext;
-	gchar *short_name;
+	gchar *short_name, *style_size, *style_saved, *style_text;
+	gint style_memory;
 	GdkPixbuf *pixbuf;
 #ifdef HAVE_SYS_TYPES_H
 	struct stat st;
@@ -1236,7 +1237,7 @@ void dialogs_show_file_properties(GeanyDocument *doc)
 	gtk_box_pack_start(GTK_BOX(hbox), label, TRUE, TRUE, 0);
 	gtk_box_pack_start(GTK_BOX(vbox), hbox, TRUE, TRUE, 0);
 
-	table = gtk_table_new(8, 2, FALSE);
+	table = gtk_table_new(9, 2, FALSE);
 	gtk_table_set_row_spacings(GTK_TABLE(table), 10);
 	gtk_table_set_col_spacings(GTK_TABLE(table), 10);
 
@@ -1363,6 +1364,29 @@ void dialogs_show_file_properties(GeanyDocument *doc)
 					(GtkAttachOptions) (0), 0, 0);
 	gtk_misc_set_alignment(GTK_MISC(label), 0, 0);
 
+	label = gtk_label_new(_("<b>Style memory:</b>"));
+	gtk_table_attach(GTK_TABLE(table), label, 0, 1, 8, 9,
+					(GtkAttachOptions) (GTK_FILL),
+					(GtkAttachOptions) (0), 0, 0);
+	gtk_label_set_use_markup(GTK_LABEL(label), TRUE);
+	gtk_misc_set_alignment(GTK_MISC(label), 1, 0);
+
+	/* styles of documents with long style runs are held as runs instead of a byte per character */
+	style_memory = sci_get_style_memory(doc->editor->sci);
+	style_size = utils_make_human_readable_str(style_memory, 1, 0);
+	style_saved = utils_make_human_readable_str(
+		MAX(sci_get_length(doc->editor->sci) - style_memory, 0), 1, 0);
+	style_text = g_strdup_printf(_("%s (%s saved)"), style_size, style_saved);
+	label = gtk_label_new(style_text);
+	gtk_label_set_selectable(GTK_LABEL(label), TRUE);
+	gtk_table_attach(GTK_TABLE(table), label, 1, 2, 8, 9,
+					(GtkAttachOptions) (GTK_FILL),
+					(GtkAttachOptions) (0), 0, 0);
+	gtk_misc_set_alignment(GTK_MISC(label), 0, 0);
+	g_free(style_size);
+	g_free(style_saved);
+	g_free(style_text);
+
 	/* add table */
 	gtk_box_pack_start(GTK_BOX(vbox), table, TRUE, TRUE, 0);
 
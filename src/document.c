@@ -72,11 +72,13 @@
 #include "search.h"
 #include "filetypesprivate.h"
 #include "project.h"
+#include "profile.h"
 
 #include "SciLexer.h"
 
 
 GeanyFilePrefs file_prefs;
+DocumentPrefsPrivate document_prefs_priv;
 
 /** Dynamic array of GeanyDocument pointers holding information about the notebook tabs.
  * Once a pointer is added to this, it is never freed. This means you can keep a pointer
@@ -105,6 +107,110 @@ typedef struct
 static void document_undo_clear(GeanyDocument *doc);
 static void document_redo_add(GeanyDocument *doc, guint type, gpointer data);
 static gboolean remove_page(guint page_num);
+static void pending_load_free(PendingLoad *pending);
+
+/* Indexes of the valid documents by GeanyDocument::file_name and GeanyDocument::real_path.
+ * They are rebuilt on the next lookup after document_index_invalidate() was called. */
+static GHashTable *filename_index = NULL;
+static GHashTable *real_path_index = NULL;
+static gboolean index_dirty = TRUE;
+
+/* Resolved directories used by get_real_path_from_utf8(), keyed by the unresolved ones */
+static GHashTable *real_dir_cache = NULL;
+#define REAL_DIR_CACHE_SIZE 256
+
+
+/* Call when a document is added or removed, or its file_name or real_path changes. */
+static void document_index_invalidate(void)
+{
+	index_dirty = TRUE;
+}
+
+
+/* keys compare like utils_filenamecmp() */
+static gchar *get_index_key(const gchar *filename)
+{
+#ifdef G_OS_WIN32
+	return g_utf8_strdown(filename, -1);
+#else
+	return g_strdup(filename);
+#endif
+}
+
+
+static void index_add(GHashTable *index, const gchar *filename, GeanyDocument *doc)
+{
+	gchar *key = get_index_key(filename);
+
+	/* keep the first document, like a search of documents_array would */
+	if (g_hash_table_lookup(index, key) == NULL)
+		g_hash_table_insert(index, key, doc);
+	else
+		g_free(key);
+}
+
+
+static void document_index_rebuild(void)
+{
+	guint i;
+
+	if (filename_index == NULL)
+	{
+		filename_index = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+		real_path_index = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	}
+	else
+	{
+		g_hash_table_remove_all(filename_index);
+		g_hash_table_remove_all(real_path_index);
+	}
+
+	for (i = 0; i < documents_array->len; i++)
+	{
+		GeanyDocument *doc = documents[i];
+
+		if (! doc->is_valid)
+			continue;
+		if (doc->file_name != NULL)
+			index_add(filename_index, doc->file_name, doc);
+		if (doc->real_path != NULL)
+			index_add(real_path_index, doc->real_path, doc);
+	}
+	index_dirty = FALSE;
+}
+
+
+static GeanyDocument *document_index_lookup(gboolean by_real_path, const gchar *filename)
+{
+	gboolean rebuilt = FALSE;
+
+	while (TRUE)
+	{
+		GeanyDocument *doc;
+		const gchar *name;
+		gchar *key;
+
+		if (index_dirty)
+		{
+			document_index_rebuild();
+			rebuilt = TRUE;
+		}
+
+		key = get_index_key(filename);
+		doc = g_hash_table_lookup(by_real_path ? real_path_index : filename_index, key);
+		g_free(key);
+		if (doc == NULL)
+			return NULL;
+
+		/* check the document still matches, in case its names were changed elsewhere */
+		name = by_real_path ? doc->real_path : doc->file_name;
+		if (doc->is_valid && name != NULL && utils_filenamecmp(filename, name) == 0)
+			return doc;
+		if (rebuilt)
+			return NULL;
+		document_index_invalidate();
+	}
+}
 
 
 /**
@@ -122,24 +228,71 @@ static gboolean remove_page(guint page_num);
  **/
 GeanyDocument* document_find_by_real_path(const gchar *realname)
 {
-	guint i;
-
 	if (! realname)
 		return NULL;	/* file doesn't exist on disk */
 
-	for (i = 0; i < documents_array->len; i++)
-	{
-		GeanyDocument *doc = documents[i];
+	return document_index_lookup(TRUE, realname);
+}
 
-		if (! doc->is_valid || ! doc->real_path)
-			continue;
 
-		if (utils_filenamecmp(realname, doc->real_path) == 0)
+/* Resolves an absolute locale_name by looking up its directory in real_dir_cache,
+ * so that only the file itself has to be checked. Returns NULL when the path has to
+ * be resolved fully. */
+static gchar *get_real_path_using_cache(const gchar *locale_name, gboolean *exists)
+{
+	gchar *dir, *real_dir, *base, *path;
+	struct stat st;
+
+	*exists = TRUE;
+	if (! g_path_is_absolute(locale_name))
+		return NULL;	/* would depend on the current directory */
+
+	if (real_dir_cache == NULL)
+		real_dir_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+
+	dir = g_path_get_dirname(locale_name);
+	real_dir = g_hash_table_lookup(real_dir_cache, dir);
+	if (real_dir == NULL)
+	{
+		real_dir = tm_get_real_path(dir);
+		if (real_dir == NULL)
 		{
-			return doc;
+			g_free(dir);
+			return NULL;
 		}
+		/* keep the cache bounded, it is cheap to fill again */
+		if (g_hash_table_size(real_dir_cache) >= REAL_DIR_CACHE_SIZE)
+			g_hash_table_remove_all(real_dir_cache);
+		g_hash_table_insert(real_dir_cache, dir, real_dir);
 	}
-	return NULL;
+	else
+		g_free(dir);
+
+	base = g_path_get_basename(locale_name);
+	if (utils_str_equal(base, ".") || utils_str_equal(base, "..") ||
+		utils_str_equal(base, G_DIR_SEPARATOR_S))
+	{
+		g_free(base);
+		return NULL;
+	}
+	path = g_build_filename(real_dir, base, NULL);
+	g_free(base);
+
+	/* the file itself may be a symlink or missing, which realpath() would handle */
+	if (g_lstat(path, &st) != 0)
+	{
+		*exists = FALSE;
+		g_free(path);
+		return NULL;
+	}
+#ifdef S_ISLNK
+	if (S_ISLNK(st.st_mode))
+	{
+		g_free(path);
+		return NULL;
+	}
+#endif
+	return path;
 }
 
 
@@ -147,7 +300,11 @@ GeanyDocument* document_find_by_real_path(const gchar *realname)
 static gchar *get_real_path_from_utf8(const gchar *utf8_filename)
 {
 	gchar *locale_name = utils_get_locale_from_utf8(utf8_filename);
-	gchar *realname = tm_get_real_path(locale_name);
+	gboolean exists;
+	gchar *realname = get_real_path_using_cache(locale_name, &exists);
+
+	if (realname == NULL && exists)
+		realname = tm_get_real_path(locale_name);
 
 	g_free(locale_name);
 	return realname;
@@ -167,7 +324,6 @@ static gchar *get_real_path_from_utf8(const gchar *utf8_filename)
  **/
 GeanyDocument *document_find_by_filename(const gchar *utf8_filename)
 {
-	guint i;
 	GeanyDocument *doc;
 	gchar *realname;
 
@@ -175,18 +331,16 @@ GeanyDocument *document_find_by_filename(const gchar *utf8_filename)
 
 	/* First search GeanyDocument::file_name, so we can find documents with a
 	 * filename set but not saved on disk, like vcdiff produces */
-	for (i = 0; i < documents_array->len; i++)
-	{
-		doc = documents[i];
-
-		if (! doc->is_valid || doc->file_name == NULL)
-			continue;
+	doc = document_index_lookup(FALSE, utf8_filename);
+	if (doc != NULL)
+		return doc;
+
+	/* No need to resolve the path when no document has one to match */
+	if (index_dirty)
+		document_index_rebuild();
+	if (g_hash_table_size(real_path_index) == 0)
+		return NULL;
 
-		if (utils_filenamecmp(utf8_filename, doc->file_name) == 0)
-		{
-			return doc;
-		}
-	}
 	/* Now try matching based on the realpath(), which is unique per file on disk */
 	realname = get_real_path_from_utf8(utf8_filename);
 	doc = document_find_by_real_path(realname);
@@ -279,6 +433,14 @@ void document_finalize()
 	for (i = 0; i < documents_array->len; i++)
 		g_free(documents[i]);
 	g_ptr_array_free(documents_array, TRUE);
+
+	if (filename_index != NULL)
+	{
+		g_hash_table_destroy(filename_index);
+		g_hash_table_destroy(real_path_index);
+	}
+	if (real_dir_cache != NULL)
+		g_hash_table_destroy(real_dir_cache);
 }
 
 
@@ -377,8 +539,10 @@ static gint document_get_new_idx(void)
 
 static void queue_colourise(GeanyDocument *doc)
 {
-	/* Colourise the editor before it is next drawn */
-	doc->priv->colourise_needed = TRUE;
+	/* Colourise the editor before it is next drawn, except for large files which
+	 * Scintilla colourises as they are shown */
+	if (! doc->priv->large_file)
+		doc->priv->colourise_needed = TRUE;
 
 	/* If the editor doesn't need drawing (e.g. after saving the current
 	 * document), we need to force a redraw, so the expose event is triggered.
@@ -551,6 +715,7 @@ static GeanyDocument *document_create(const gchar *utf8_filename)
 	ui_document_buttons_update();
 
 	doc->is_valid = TRUE;	/* do this last to prevent UI updating with NULL items. */
+	document_index_invalidate();
 	return doc;
 }
 
@@ -591,6 +756,7 @@ static gboolean remove_page(guint page_num)
 		ui_add_recent_document(doc);
 
 	doc->is_valid = FALSE;
+	document_index_invalidate();
 
 	if (! main_status.quitting)
 	{
@@ -599,6 +765,8 @@ static gboolean remove_page(guint page_num)
 		navqueue_remove_file(doc->file_name);
 		msgwin_status_add(_("File %s closed."), DOC_FILENAME(doc));
 	}
+	if (doc->priv->pending_load != NULL)
+		pending_load_free(doc->priv->pending_load);
 	g_free(doc->encoding);
 	g_free(doc->priv->saved_encoding.encoding);
 	g_free(doc->file_name);
@@ -777,9 +945,71 @@ typedef struct
 	gboolean	 bom;
 	time_t		 mtime;	/* modification time, read by stat::st_mtime */
 	gboolean	 readonly;
+	gboolean	 large;	/* whether to open in large file mode */
+	GMappedFile	*mapped;	/* mapping holding data instead of an allocation, or NULL */
 } FileData;
 
 
+static void mapped_file_free(GMappedFile *mapped)
+{
+#if GLIB_CHECK_VERSION(2, 22, 0)
+	g_mapped_file_unref(mapped);
+#else
+	g_mapped_file_free(mapped);
+#endif
+}
+
+
+static void free_file_data_text(FileData *filedata)
+{
+	if (filedata->mapped != NULL)
+		mapped_file_free(filedata->mapped);
+	else
+		g_free(filedata->data);
+	filedata->mapped = NULL;
+	filedata->data = NULL;
+}
+
+
+/* Maps a large file read-only instead of reading it into memory. This only works for
+ * UTF-8 files as the mapped text is given to Scintilla without conversion. */
+static gboolean load_mapped_text_file(const gchar *locale_filename, FileData *filedata,
+		const gchar *forced_enc)
+{
+	GMappedFile *mapped;
+	gchar *contents;
+	gsize len;
+
+	if (forced_enc != NULL && ! utils_str_equal(forced_enc, "UTF-8"))
+		return FALSE;
+
+	mapped = g_mapped_file_new(locale_filename, FALSE, NULL);
+	if (mapped == NULL)
+		return FALSE;
+
+	contents = g_mapped_file_get_contents(mapped);
+	len = g_mapped_file_get_length(mapped);
+	/* this also rejects NULL bytes, which would otherwise need truncating */
+	if (contents == NULL || ! g_utf8_validate(contents, (gssize) len, NULL))
+	{
+		mapped_file_free(mapped);
+		return FALSE;
+	}
+
+	filedata->bom = (len >= 3 && memcmp(contents, "\xef\xbb\xbf", 3) == 0);
+	if (filedata->bom)
+	{
+		contents += 3;
+		len -= 3;
+	}
+	filedata->mapped = mapped;
+	filedata->data = contents;
+	filedata->len = len;
+	filedata->enc = g_strdup("UTF-8");
+	return TRUE;
+}
+
+
 /* loads textfile data, verifies and converts to forced_enc or UTF-8. Also handles BOM. */
 static gboolean load_text_file(const gchar *locale_filename, const gchar *display_filename,
 	FileData *filedata, const gchar *forced_enc)
@@ -792,6 +1022,8 @@ static gboolean load_text_file(const gchar *locale_filename, const gchar *displa
 	filedata->enc = NULL;
 	filedata->bom = FALSE;
 	filedata->readonly = FALSE;
+	filedata->large = FALSE;
+	filedata->mapped = NULL;
 
 	if (g_stat(locale_filename, &st) != 0)
 	{
@@ -801,6 +1033,14 @@ static gboolean load_text_file(const gchar *locale_filename, const gchar *displa
 	}
 
 	filedata->mtime = st.st_mtime;
+	filedata->large = (document_prefs_priv.large_file_size > 0 &&
+		(gint64) st.st_size >= (gint64) document_prefs_priv.large_file_size * 1024 * 1024);
+
+	if (filedata->large && document_prefs_priv.large_file_mmap &&
+		load_mapped_text_file(locale_filename, filedata, forced_enc))
+	{
+		return TRUE;
+	}
 
 	if (! g_file_get_contents(locale_filename, &filedata->data, NULL, &err))
 	{
@@ -1023,8 +1263,10 @@ void document_apply_indent_settings(GeanyDocument *doc)
 	const GeanyIndentPrefs *iprefs = editor_get_indent_prefs(NULL);
 	GeanyIndentType type = iprefs->type;
 	gint width = iprefs->width;
+	/* detection searches the whole document, which is too slow for large files */
+	gboolean detect = ! doc->priv->large_file;
 
-	if (iprefs->detect_type && document_detect_indent_type(doc, &type))
+	if (detect && iprefs->detect_type && document_detect_indent_type(doc, &type))
 	{
 		if (type != iprefs->type)
 		{
@@ -1051,7 +1293,7 @@ void document_apply_indent_settings(GeanyDocument *doc)
 	else if (doc->file_type->indent_type > -1)
 		type = doc->file_type->indent_type;
 
-	if (iprefs->detect_width && detect_indent_width(doc->editor, type, &width))
+	if (detect && iprefs->detect_width && detect_indent_width(doc->editor, type, &width))
 	{
 		if (width != iprefs->width)
 		{
@@ -1075,6 +1317,7 @@ void document_show_tab(GeanyDocument *doc)
 
 /* To open a new file, set doc to NULL; filename should be locale encoded.
  * To reload a file, set the doc for the document to be reloaded; filename should be NULL.
+ * A document opened with document_open_file_deferred() is read like a new file.
  * pos is the cursor position, which can be overridden by --line and --column.
  * forced_enc can be NULL to detect the file encoding.
  * Returns: doc of the opened file or NULL if an error occurred. */
@@ -1082,14 +1325,15 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 		gboolean readonly, GeanyFiletype *ft, const gchar *forced_enc)
 {
 	gint editor_mode;
-	gboolean reload = (doc == NULL) ? FALSE : TRUE;
+	gboolean pending = (doc != NULL && doc->priv->pending_load != NULL);
+	gboolean reload = (doc != NULL && ! pending);
 	gchar *utf8_filename = NULL;
 	gchar *display_filename = NULL;
 	gchar *locale_filename = NULL;
 	GeanyFiletype *use_ft;
 	FileData filedata;
 
-	if (reload)
+	if (doc != NULL)
 	{
 		utf8_filename = g_strdup(doc->file_name);
 		locale_filename = utils_get_locale_from_utf8(utf8_filename);
@@ -1115,13 +1359,20 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 		doc = document_find_by_filename(utf8_filename);
 		if (doc != NULL)
 		{
+			/* read a restored session file first, so the cursor is set in its text */
+			if (! document_load_pending(doc))
+			{
+				g_free(utf8_filename);
+				g_free(locale_filename);
+				return NULL;
+			}
 			ui_add_recent_document(doc);	/* either add or reorder recent item */
 			/* show the doc before reload dialog */
 			document_show_tab(doc);
 			document_check_disk_status(doc, TRUE);	/* force a file changed check */
 		}
 	}
-	if (reload || doc == NULL)
+	if (reload || pending || doc == NULL)
 	{	/* doc possibly changed */
 		display_filename = utils_str_middle_truncate(utf8_filename, 100);
 
@@ -1133,32 +1384,49 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 			return NULL;
 		}
 
-		if (! reload)
+		if (pending)
+			monitor_file_setup(doc);
+		else if (! reload)
 		{
 			doc = document_create(utf8_filename);
 			g_return_val_if_fail(doc != NULL, NULL); /* really should not happen */
 
 			/* file exists on disk, set real_path */
 			SETPTR(doc->real_path, tm_get_real_path(locale_filename));
+			document_index_invalidate();
 
 			doc->priv->is_remote = utils_is_remote_path(locale_filename);
 			monitor_file_setup(doc);
 		}
+		doc->priv->large_file = filedata.large;
 
+		/* a reload must not turn undo collection back on in on_editor_notify() */
+		doc->priv->undo_deferred = FALSE;
 		sci_set_undo_collection(doc->editor->sci, FALSE); /* avoid creation of an undo action */
 		sci_empty_undo_buffer(doc->editor->sci);
 
 		/* add the text to the ScintillaObject */
 		sci_set_readonly(doc->editor->sci, FALSE);	/* to allow replacing text */
-		sci_set_text(doc->editor->sci, filedata.data);	/* NULL terminated data */
+		if (filedata.mapped != NULL)
+		{	/* mapped data is not NULL terminated */
+			sci_set_text(doc->editor->sci, "");
+			scintilla_send_message(doc->editor->sci, SCI_APPENDTEXT,
+				(uptr_t) filedata.len, (sptr_t) filedata.data);
+		}
+		else
+			sci_set_text(doc->editor->sci, filedata.data);	/* NULL terminated data */
 		queue_colourise(doc);	/* Ensure the document gets colourised. */
 
 		/* detect & set line endings */
 		editor_mode = utils_get_line_endings(filedata.data, filedata.len);
 		sci_set_eol_mode(doc->editor->sci, editor_mode);
-		g_free(filedata.data);
+		free_file_data_text(&filedata);
 
-		sci_set_undo_collection(doc->editor->sci, TRUE);
+		/* large files are often only viewed, so don't collect undo actions until the
+		 * first edit, see on_editor_notify() */
+		doc->priv->undo_deferred = doc->priv->large_file;
+		if (! doc->priv->undo_deferred)
+			sci_set_undo_collection(doc->editor->sci, TRUE);
 
 		doc->priv->mtime = filedata.mtime; /* get the modification time from file and keep it */
 		g_free(doc->encoding);	/* if reloading, free old encoding */
@@ -1166,7 +1434,8 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 		doc->has_bom = filedata.bom;
 		store_saved_encoding(doc);	/* store the opened encoding for undo/redo */
 
-		doc->readonly = readonly || filedata.readonly;
+		/* a mapped file is shown read-only as it was not copied for editing */
+		doc->readonly = readonly || filedata.readonly || filedata.mapped != NULL;
 		sci_set_readonly(doc->editor->sci, doc->readonly);
 
 		/* update line number margin width */
@@ -1181,6 +1450,9 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 				doc->editor);
 
 			use_ft = (ft != NULL) ? ft : filetypes_detect_from_document(doc);
+			/* the filetype of a pending document was only set for display */
+			if (pending)
+				doc->file_type = NULL;
 		}
 		else
 		{	/* reloading */
@@ -1191,8 +1463,9 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 		/* update taglist, typedef keywords and build menu if necessary */
 		document_set_filetype(doc, use_ft);
 
-		/* set indentation settings after setting the filetype */
-		if (reload)
+		/* set indentation settings after setting the filetype, keeping the settings
+		 * already applied to a pending document */
+		if (reload || pending)
 			editor_set_indent(doc->editor, doc->editor->indent_type, doc->editor->indent_width); /* resetup sci */
 		else
 			document_apply_indent_settings(doc);
@@ -1201,9 +1474,12 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 		ui_document_show_hide(doc);	/* update the document menu */
 
 		/* finally add current file to recent files menu, but not the files from the last session */
-		if (! main_status.opening_session_files)
+		if (! main_status.opening_session_files && ! pending)
 			ui_add_recent_document(doc);
 
+		/* show errors from the last build */
+		build_mark_errors(doc);
+
 		if (reload)
 		{
 			g_signal_emit_by_name(geany_object, "document-reload", doc);
@@ -1217,7 +1493,12 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 			 * (it is replaced with the string ", read-only"). */
 			msgwin_status_add(_("File %s opened(%d%s)."),
 				display_filename, gtk_notebook_get_n_pages(GTK_NOTEBOOK(main_widgets.notebook)),
-				(readonly) ? _(", read-only") : "");
+				(doc->readonly) ? _(", read-only") : "");
+		}
+		if (doc->priv->large_file)
+		{
+			msgwin_status_add(_("File %s is large, so symbols, folding, indentation detection "
+				"and brace matching are disabled for it."), display_filename);
 		}
 	}
 
@@ -1237,6 +1518,154 @@ GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename
 }
 
 
+static guint pending_load_source = 0;
+
+
+static void pending_load_free(PendingLoad *pending)
+{
+	g_free(pending->forced_enc);
+	g_free(pending);
+}
+
+
+static gboolean on_idle_close_failed(gpointer data)
+{
+	GeanyDocument *doc = data;
+
+	/* doc may have been closed and its slot reused meanwhile */
+	if (DOC_VALID(doc) && doc->priv->pending_load != NULL && doc->priv->pending_load->failed)
+		document_close(doc);
+	return FALSE;
+}
+
+
+/* Reads the files of the pending documents in tab order, one per call. */
+static gboolean on_idle_load_pending(gpointer data)
+{
+	gint i, n_pages = gtk_notebook_get_n_pages(GTK_NOTEBOOK(main_widgets.notebook));
+
+	for (i = 0; i < n_pages; i++)
+	{
+		GeanyDocument *doc = document_get_from_page(i);
+
+		if (doc != NULL && doc->priv->pending_load != NULL && ! doc->priv->pending_load->failed)
+		{
+			document_load_pending(doc);
+			return TRUE;
+		}
+	}
+	pending_load_source = 0;
+	return FALSE;
+}
+
+
+/* Adds a tab for a file without reading it, e.g. when restoring a session.
+ * The arguments are the same as for document_open_file_full(). The file is read by
+ * document_load_pending() when the tab is first shown or otherwise in idle time.
+ * Until then the document is empty and only its name, filetype, encoding and
+ * read-only state are set.
+ * Returns: doc of the added tab. */
+GeanyDocument *document_open_file_deferred(const gchar *locale_filename, gint pos,
+		gboolean readonly, GeanyFiletype *ft, const gchar *forced_enc)
+{
+	GeanyDocument *doc;
+	gchar *tidy_filename;
+	gchar *utf8_filename;
+
+	g_return_val_if_fail(locale_filename != NULL, NULL);
+
+	tidy_filename = g_strdup(locale_filename);
+	utils_tidy_path(tidy_filename);
+	utf8_filename = utils_get_utf8_from_locale(tidy_filename);
+
+	doc = document_find_by_filename(utf8_filename);
+	if (doc != NULL)
+	{
+		g_free(utf8_filename);
+		g_free(tidy_filename);
+		return doc;
+	}
+
+	doc = document_create(utf8_filename);
+	g_return_val_if_fail(doc != NULL, NULL); /* really should not happen */
+
+	SETPTR(doc->real_path, tm_get_real_path(tidy_filename));
+	document_index_invalidate();
+	doc->priv->is_remote = utils_is_remote_path(tidy_filename);
+
+	doc->priv->pending_load = g_new0(PendingLoad, 1);
+	doc->priv->pending_load->pos = pos;
+	doc->priv->pending_load->ft = ft;
+	doc->priv->pending_load->forced_enc = g_strdup(forced_enc);
+
+	/* shown in the UI and stored in the session until the file is read */
+	doc->file_type = (ft != NULL) ? ft : filetypes[GEANY_FILETYPES_NONE];
+	doc->encoding = g_strdup(forced_enc);
+	doc->readonly = readonly;
+	sci_set_readonly(doc->editor->sci, readonly);
+
+	if (pending_load_source == 0)
+		pending_load_source = g_idle_add_full(G_PRIORITY_LOW, on_idle_load_pending, NULL, NULL);
+
+	g_free(utf8_filename);
+	g_free(tidy_filename);
+	return doc;
+}
+
+
+/* Reads the file of a document added by document_open_file_deferred().
+ * If the file cannot be read, the document is closed in idle time.
+ * Returns: FALSE if the file of the document could not be read. */
+gboolean document_load_pending(GeanyDocument *doc)
+{
+	PendingLoad *pending;
+	gboolean loaded;
+
+	g_return_val_if_fail(doc != NULL, FALSE);
+
+	pending = doc->priv->pending_load;
+	if (pending == NULL)
+		return TRUE;
+	if (pending->failed)
+		return FALSE;
+
+	profile_begin("document", doc->file_name);
+	loaded = document_open_file_full(doc, NULL, pending->pos, doc->readonly, pending->ft,
+		pending->forced_enc) != NULL;
+	profile_end();
+	if (! loaded)
+	{
+		pending->failed = TRUE;
+		g_idle_add(on_idle_close_failed, doc);
+		return FALSE;
+	}
+	doc->priv->pending_load = NULL;
+	pending_load_free(pending);
+	return TRUE;
+}
+
+
+/* Returns: TRUE if the file of a document added by document_open_file_deferred() has
+ * not been read yet. */
+gboolean document_is_pending(GeanyDocument *doc)
+{
+	g_return_val_if_fail(doc != NULL, FALSE);
+
+	return doc->priv->pending_load != NULL;
+}
+
+
+/* Returns: the cursor position of a document, including one whose file has not been read yet. */
+gint document_get_pending_pos(GeanyDocument *doc)
+{
+	g_return_val_if_fail(doc != NULL, 0);
+
+	if (doc->priv->pending_load != NULL)
+		return doc->priv->pending_load->pos;
+	return sci_get_current_position(doc->editor->sci);
+}
+
+
 /* Takes a new line separated list of filename URIs and opens each file.
  * length is the length of the string */
 void document_open_file_list(const gchar *data, gsize length)
@@ -1455,6 +1884,7 @@ gboolean document_save_file_as(GeanyDocument *doc, const gchar *utf8_fname)
 
 	/* reset real path, it's retrieved again in document_save() */
 	SETPTR(doc->real_path, NULL);
+	document_index_invalidate();
 
 	/* detect filetype */
 	if (doc->file_type->id == GEANY_FILETYPES_NONE)
@@ -1655,6 +2085,7 @@ static gchar *save_doc(GeanyDocument *doc, const gchar *locale_filename,
 	if (doc->real_path == NULL)
 	{
 		doc->real_path = tm_get_real_path(locale_filename);
+		document_index_invalidate();
 		doc->priv->is_remote = utils_is_remote_path(locale_filename);
 		monitor_file_setup(doc);
 	}
@@ -1697,6 +2128,10 @@ gboolean document_save_file(GeanyDocument *doc, gboolean force)
 
 	g_return_val_if_fail(doc != NULL, FALSE);
 
+	/* never write the empty buffer of a file which has not been read yet */
+	if (! document_load_pending(doc))
+		return FALSE;
+
 	if (document_need_save_as(doc))
 	{
 		/* ensure doc is the current tab before showing the dialog */
@@ -2225,14 +2660,16 @@ gint document_replace_all(GeanyDocument *doc, const gchar *find_text, const gcha
  */
 void document_update_tags(GeanyDocument *doc)
 {
-	guchar *buffer_ptr;
+	struct Sci_TextSnapshot *snapshot;
 	gsize len;
+	ProfileTimer timer;
 
 	g_return_if_fail(DOC_VALID(doc));
 	g_return_if_fail(app->tm_workspace != NULL);
 
-	/* early out if it's a new file or doesn't support tags */
-	if (! doc->file_name || ! doc->file_type || !filetype_has_tags(doc->file_type))
+	/* early out if it's a new file, a large file or doesn't support tags */
+	if (! doc->file_name || ! doc->file_type || !filetype_has_tags(doc->file_type) ||
+		doc->priv->large_file)
 	{
 		/* We must call sidebar_update_tag_list() before returning,
 		 * to ensure that the symbol list is always updated properly (e.g.
@@ -2279,13 +2716,18 @@ void document_update_tags(GeanyDocument *doc)
 		return;
 	}
 
-	/* Parse Scintilla's buffer directly using TagManager
+	profile_timer_start(&timer, PROFILE_DOCUMENT_UPDATE_TAGS);
+
+	/* Parse a snapshot of Scintilla's buffer directly using TagManager
 	 * Note: this buffer *MUST NOT* be modified */
-	buffer_ptr = (guchar *) scintilla_send_message(doc->editor->sci, SCI_GETCHARACTERPOINTER, 0, 0);
-	tm_source_file_buffer_update(doc->tm_file, buffer_ptr, len, TRUE);
+	snapshot = sci_create_snapshot(doc->editor->sci);
+	tm_source_file_buffer_update(doc->tm_file, (guchar *) snapshot->text, snapshot->length, TRUE);
+	sci_release_snapshot(doc->editor->sci, snapshot);
 
 	sidebar_update_tag_list(doc, TRUE);
 	document_highlight_tags(doc);
+
+	profile_timer_stop(&timer);
 }
 
 
@@ -2356,7 +2798,8 @@ static gboolean on_document_update_tag_list_idle(gpointer data)
 
 void document_update_tag_list_in_idle(GeanyDocument *doc)
 {
-	if (editor_prefs.autocompletion_update_freq <= 0 || ! filetype_has_tags(doc->file_type))
+	if (editor_prefs.autocompletion_update_freq <= 0 || ! filetype_has_tags(doc->file_type) ||
+		doc->priv->large_file)
 		return;
 
 	/* prevent "stacking up" callback handlers, we only need one to run soon */
@@ -2390,6 +2833,11 @@ static void document_load_config(GeanyDocument *doc, GeanyFiletype *type,
 			symbols_global_tags_loaded(type->id);
 
 		highlighting_set_styles(doc->editor->sci, type);
+		if (doc->priv->large_file)
+		{	/* folding needs the whole document lexed */
+			sci_set_property(doc->editor->sci, "fold", "0");
+			sci_set_folding_margin_visible(doc->editor->sci, FALSE);
+		}
 		editor_set_indentation_guides(doc->editor);
 		build_menu_update(doc);
 		queue_colourise(doc);
@@ -2981,6 +3429,7 @@ static gboolean monitor_resave_missing_file(GeanyDocument *doc)
 		document_set_text_changed(doc, TRUE);
 		/* don't prompt more than once */
 		SETPTR(doc->real_path, NULL);
+		document_index_invalidate();
 	}
 
 	return want_reload;
@@ -3001,9 +3450,10 @@ gboolean document_check_disk_status(GeanyDocument *doc, gboolean force)
 
 	g_return_val_if_fail(doc != NULL, FALSE);
 
-	/* ignore remote files and documents that have never been saved to disk */
+	/* ignore remote files, documents that have never been saved to disk and documents
+	 * whose file will only be read later */
 	if (notebook_switch_in_progress() || file_prefs.disk_check_timeout == 0
-			|| doc->real_path == NULL || doc->priv->is_remote)
+			|| doc->real_path == NULL || doc->priv->is_remote || doc->priv->pending_load != NULL)
 		return FALSE;
 
 	use_gio_filemon = (doc->priv->monitor != NULL);
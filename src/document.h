@@ -214,6 +214,15 @@ gboolean document_close_all(void);
 GeanyDocument *document_open_file_full(GeanyDocument *doc, const gchar *filename, gint pos,
 		gboolean readonly, GeanyFiletype *ft, const gchar *forced_enc);
 
+GeanyDocument *document_open_file_deferred(const gchar *locale_filename, gint pos,
+		gboolean readonly, GeanyFiletype *ft, const gchar *forced_enc);
+
+gboolean document_load_pending(GeanyDocument *doc);
+
+gboolean document_is_pending(GeanyDocument *doc);
+
+gint document_get_pending_pos(GeanyDocument *doc);
+
 void document_open_file_list(const gchar *data, gsize length);
 
 void document_open_files(const GSList *filenames, gboolean readonly, GeanyFiletype *ft,
@@ -24,6 +24,17 @@
 #define GEANY_DOCUMENT_PRIVATE_H
 
 
+/* File settings which are not part of the plugin API. */
+typedef struct DocumentPrefsPrivate
+{
+	gint		large_file_size;	/* size in MiB from which files are opened in large file mode */
+	gboolean	large_file_mmap;	/* map large UTF-8 files read-only instead of reading them */
+}
+DocumentPrefsPrivate;
+
+extern DocumentPrefsPrivate document_prefs_priv;
+
+
 /* available UNDO actions, UNDO_SCINTILLA is a pseudo action to trigger Scintilla's
  * undo management */
 enum
@@ -43,6 +54,17 @@ typedef enum
 FileDiskStatus;
 
 
+/* Arguments for reading the file of a document opened with document_open_file_deferred() */
+typedef struct PendingLoad
+{
+	gint			 pos;
+	GeanyFiletype	*ft;			/* NULL to detect the filetype */
+	gchar			*forced_enc;	/* NULL to detect the encoding */
+	gboolean		 failed;		/* the file could not be read, the tab will be closed */
+}
+PendingLoad;
+
+
 typedef struct FileEncoding
 {
 	gchar 			*encoding;
@@ -83,6 +105,13 @@ typedef struct GeanyDocumentPrivate
 	time_t			 mtime;
 	/* ID of the idle callback updating the tag list */
 	guint			 tag_list_update_source;
+	/* Whether the file was big enough to disable tags, folding, indent detection,
+	 * brace matching and full colourising */
+	gboolean		 large_file;
+	/* Whether undo collection was left off after loading and is enabled on the first edit */
+	gboolean		 undo_deferred;
+	/* Set while the file of the document has not been read yet, see document_load_pending() */
+	PendingLoad		*pending_load;
 }
 GeanyDocumentPrivate;
 
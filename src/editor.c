@@ -60,6 +60,7 @@
 #include "projectprivate.h"
 #include "main.h"
 #include "highlighting.h"
+#include "profile.h"
 #include "gtkcompat.h"
 
 
@@ -80,6 +81,7 @@ static gchar current_word[GEANY_MAX_WORD_LENGTH];
 
 /* Initialised in keyfile.c. */
 GeanyEditorPrefs editor_prefs;
+EditorPrefsPrivate editor_prefs_priv;
 
 EditorInfo editor_info = {current_word, -1};
 
@@ -885,13 +887,18 @@ static void expand(ScintillaObject *sci, gint *line, gboolean doExpand,
 
 static void fold_changed(ScintillaObject *sci, gint line, gint levelNow, gint levelPrev)
 {
+	/* Nothing is folded, so there are no hidden lines to show again. This is checked first
+	 * as fold levels change for each line folded again after an edit. */
+	gboolean all_visible = SSM(sci, SCI_GETALLLINESVISIBLE, 0, 0);
+
 	if (levelNow & SC_FOLDLEVELHEADERFLAG)
 	{
 		if (! (levelPrev & SC_FOLDLEVELHEADERFLAG))
 		{
 			/* Adding a fold point */
 			SSM(sci, SCI_SETFOLDEXPANDED, line, 1);
-			expand(sci, &line, TRUE, FALSE, 0, levelPrev);
+			if (! all_visible)
+				expand(sci, &line, TRUE, FALSE, 0, levelPrev);
 		}
 	}
 	else if (levelPrev & SC_FOLDLEVELHEADERFLAG)
@@ -903,7 +910,7 @@ static void fold_changed(ScintillaObject *sci, gint line, gint levelNow, gint le
 			expand(sci, &line, TRUE, FALSE, 0, levelPrev);
 		}
 	}
-	if (! (levelNow & SC_FOLDLEVELWHITEFLAG) &&
+	if (! all_visible && ! (levelNow & SC_FOLDLEVELWHITEFLAG) &&
 			((levelPrev & SC_FOLDLEVELNUMBERMASK) > (levelNow & SC_FOLDLEVELNUMBERMASK)))
 	{
 		/* See if should still be hidden */
@@ -1007,10 +1014,13 @@ void editor_sci_notify_cb(G_GNUC_UNUSED GtkWidget *widget, G_GNUC_UNUSED gint sc
 {
 	GeanyEditor *editor = data;
 	gboolean retval;
+	ProfileTimer timer;
 
 	g_return_if_fail(editor != NULL);
 
+	profile_timer_start(&timer, PROFILE_EDITOR_NOTIFY);
 	g_signal_emit_by_name(geany_object, "editor-notify", editor, scnt, &retval);
+	profile_timer_stop(&timer);
 }
 
 
@@ -1060,6 +1070,14 @@ static gboolean on_editor_notify(G_GNUC_UNUSED GObject *object, GeanyEditor *edi
 			break;
 
  		case SCN_MODIFIED:
+			if (doc->priv->undo_deferred &&
+				(nt->modificationType & (SC_MOD_BEFOREINSERT | SC_MOD_BEFOREDELETE)))
+			{
+				/* start collecting undo actions left off when loading a large file, so
+				 * that this first edit can be undone */
+				doc->priv->undo_deferred = FALSE;
+				sci_set_undo_collection(sci, TRUE);
+			}
 			if (editor_prefs.show_linenumber_margin && (nt->modificationType & (SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT)) && nt->linesAdded)
 			{
 				/* automatically adjust Scintilla's line numbers margin width */
@@ -3389,6 +3407,10 @@ static void editor_highlight_braces(GeanyEditor *editor, gint cur_pos)
 	SSM(editor->sci, SCI_SETHIGHLIGHTGUIDE, 0, 0);
 	SSM(editor->sci, SCI_BRACEBADLIGHT, (uptr_t)-1, 0);
 
+	/* matching may have to search the whole document */
+	if (editor->document->priv->large_file)
+		return;
+
 	if (! utils_isbrace(sci_get_char_at(editor->sci, brace_pos), editor_prefs.brace_match_ltgt))
 	{
 		brace_pos++;
@@ -4277,24 +4299,16 @@ const gchar *editor_get_eol_char(GeanyEditor *editor)
 
 static void fold_all(GeanyEditor *editor, gboolean want_fold)
 {
-	gint lines, first, i;
+	gint first;
 
 	if (editor == NULL || ! editor_prefs.folding)
 		return;
 
-	lines = sci_get_line_count(editor->sci);
 	first = sci_get_first_visible_line(editor->sci);
 
-	for (i = 0; i < lines; i++)
-	{
-		gint level = sci_get_fold_level(editor->sci, i);
-
-		if (level & SC_FOLDLEVELHEADERFLAG)
-		{
-			if (sci_get_fold_expanded(editor->sci, i) == want_fold)
-					sci_toggle_fold(editor->sci, i);
-		}
-	}
+	/* Scintilla updates all the fold headers in one pass, toggling each one is slow
+	 * for large files */
+	SSM(editor->sci, SCI_FOLDALL, want_fold ? SC_FOLDACTION_CONTRACT : SC_FOLDACTION_EXPAND, 0);
 	editor_scroll_to_line(editor, first, 0.0F);
 }
 
@@ -4671,6 +4685,36 @@ static gboolean on_editor_draw(GtkWidget *widget, cairo_t *cr, gpointer user_dat
 #endif
 
 
+/* The "event" and "event-after" signals are emitted around the expose handler connected
+ * by Scintilla, so they can measure the painting of the text. */
+static ProfileTimer paint_timer;
+
+static gboolean on_editor_text_event(GtkWidget *widget, GdkEvent *event, gpointer user_data)
+{
+	if (event->type == GDK_EXPOSE)
+		profile_timer_start(&paint_timer, PROFILE_SCI_PAINT);
+	return FALSE;
+}
+
+
+static void on_editor_text_event_after(GtkWidget *widget, GdkEvent *event, gpointer user_data)
+{
+	if (event->type == GDK_EXPOSE)
+		profile_timer_stop(&paint_timer);
+}
+
+
+static void connect_paint_timer(GtkWidget *widget, gpointer data)
+{
+	/* the text is drawn in a GtkDrawingArea, the other children are scrollbars */
+	if (GTK_IS_DRAWING_AREA(widget))
+	{
+		g_signal_connect(widget, "event", G_CALLBACK(on_editor_text_event), NULL);
+		g_signal_connect(widget, "event-after", G_CALLBACK(on_editor_text_event_after), NULL);
+	}
+}
+
+
 static void setup_sci_keys(ScintillaObject *sci)
 {
 	/* disable some Scintilla keybindings to be able to redefine them cleanly */
@@ -4799,6 +4843,7 @@ static ScintillaObject *create_new_sci(GeanyEditor *editor)
 #else
 		g_signal_connect(sci, "expose-event", G_CALLBACK(on_editor_expose_event), editor);
 #endif
+		gtk_container_forall(GTK_CONTAINER(sci), connect_paint_timer, NULL);
 	}
 	return sci;
 }
@@ -5014,7 +5059,7 @@ void editor_apply_update_prefs(GeanyEditor *editor)
 	sci_set_symbol_margin(sci, editor_prefs.show_markers_margin);
 	sci_set_line_numbers(sci, editor_prefs.show_linenumber_margin, 0);
 
-	sci_set_folding_margin_visible(sci, editor_prefs.folding);
+	sci_set_folding_margin_visible(sci, editor_prefs.folding && ! editor->document->priv->large_file);
 
 	/* virtual space */
 	SSM(sci, SCI_SETVIRTUALSPACEOPTIONS, editor_prefs.show_virtual_space, 0);
@@ -5023,6 +5068,8 @@ void editor_apply_update_prefs(GeanyEditor *editor)
 	sci_set_scroll_stop_at_last_line(sci, editor_prefs.scroll_stop_at_last_line);
 
 	sci_set_scrollbar_mode(sci, editor_prefs.show_scrollbars);
+
+	SSM(sci, SCI_SETLAYOUTCACHE, editor_prefs_priv.layout_cache, 0);
 }
 
 
@@ -177,6 +177,15 @@ typedef struct
 
 extern EditorInfo editor_info;
 
+/* Editor settings which are not part of the plugin API. */
+typedef struct EditorPrefsPrivate
+{
+	gint	layout_cache;	/* Scintilla layout cache level, hidden pref */
+}
+EditorPrefsPrivate;
+
+extern EditorPrefsPrivate editor_prefs_priv;
+
 typedef struct SCNotification SCNotification;
 
 
@@ -28,6 +28,7 @@
  * only use GeanyFiletype for API functions. */
 
 #include <string.h>
+#include <time.h>
 #include <glib/gstdio.h>
 
 #include "geany.h"
@@ -1161,6 +1162,357 @@ void filetypes_free_types(void)
 	g_ptr_array_foreach(filetypes_array, filetype_free, NULL);
 	g_ptr_array_free(filetypes_array, TRUE);
 	g_hash_table_destroy(filetypes_hash);
+
+	config_cache_write();
+	if (config_cache.entries != NULL)
+		g_hash_table_destroy(config_cache.entries);
+	config_cache.entries = NULL;
+}
+
+
+/* The filetype configuration cache holds the keyfile data that was read and merged from
+ * the filetype configuration files and the colour scheme, so that a start only needs to
+ * read the cache file and check the modification times and sizes of the configuration
+ * files instead of reading and merging all of them. Each entry is used while none of its
+ * source files has changed. */
+#define CONFIG_CACHE_MAGIC 0x47544643	/* also detects a cache with another byte order */
+#define CONFIG_CACHE_VERSION 2
+/* stored instead of a modification time in the current second, because the file could
+ * still change in the same second without a new time */
+#define CONFIG_CACHE_RACY_MTIME -2
+
+typedef struct ConfigCacheSource
+{
+	gchar *path;
+	gint64 mtime;	/* -1 if the file doesn't exist, or CONFIG_CACHE_RACY_MTIME */
+	gint64 size;
+}
+ConfigCacheSource;
+
+typedef struct ConfigCacheEntry
+{
+	GArray *sources;	/* ConfigCacheSource */
+	gchar *data[2];
+}
+ConfigCacheEntry;
+
+typedef struct ConfigCacheReader
+{
+	const gchar *pos;
+	const gchar *end;
+	gboolean error;
+}
+ConfigCacheReader;
+
+static struct
+{
+	GHashTable *entries;	/* key -> ConfigCacheEntry, NULL until the cache is read */
+	gboolean dirty;
+}
+config_cache = {NULL, FALSE};
+
+
+static gchar *config_cache_get_filename(void)
+{
+	return g_build_filename(app->configdir, "filetypes.cache", NULL);
+}
+
+
+static void config_cache_entry_free(gpointer data)
+{
+	ConfigCacheEntry *entry = data;
+	guint i;
+
+	for (i = 0; i < entry->sources->len; i++)
+		g_free(g_array_index(entry->sources, ConfigCacheSource, i).path);
+	g_array_free(entry->sources, TRUE);
+	g_free(entry->data[0]);
+	g_free(entry->data[1]);
+	g_free(entry);
+}
+
+
+static void get_file_stamp(const gchar *path, gint64 *mtime, gint64 *size)
+{
+	struct stat st;
+
+	if (g_stat(path, &st) == 0)
+	{
+		*mtime = st.st_mtime;
+		*size = st.st_size;
+	}
+	else
+	{
+		*mtime = -1;
+		*size = -1;
+	}
+}
+
+
+static void cache_read(ConfigCacheReader *reader, gpointer value, gsize len)
+{
+	if (reader->error || (gsize) (reader->end - reader->pos) < len)
+	{
+		reader->error = TRUE;
+		memset(value, 0, len);
+		return;
+	}
+	memcpy(value, reader->pos, len);
+	reader->pos += len;
+}
+
+
+static guint32 cache_read_uint(ConfigCacheReader *reader)
+{
+	guint32 value;
+
+	cache_read(reader, &value, sizeof value);
+	return value;
+}
+
+
+static gint64 cache_read_int64(ConfigCacheReader *reader)
+{
+	gint64 value;
+
+	cache_read(reader, &value, sizeof value);
+	return value;
+}
+
+
+static gchar *cache_read_string(ConfigCacheReader *reader)
+{
+	guint32 len = cache_read_uint(reader);
+	gchar *str;
+
+	if (reader->error || (gsize) (reader->end - reader->pos) < len)
+	{
+		reader->error = TRUE;
+		return NULL;
+	}
+	str = g_strndup(reader->pos, len);
+	reader->pos += len;
+	return str;
+}
+
+
+static void config_cache_read(void)
+{
+	ConfigCacheReader reader;
+	gchar *filename, *contents;
+	gsize len;
+	guint32 count, i;
+
+	config_cache.entries = g_hash_table_new_full(g_str_hash, g_str_equal,
+		g_free, config_cache_entry_free);
+
+	filename = config_cache_get_filename();
+	if (! g_file_get_contents(filename, &contents, &len, NULL))
+	{
+		g_free(filename);
+		return;
+	}
+	g_free(filename);
+
+	reader.pos = contents;
+	reader.end = contents + len;
+	reader.error = FALSE;
+	if (cache_read_uint(&reader) != CONFIG_CACHE_MAGIC ||
+		cache_read_uint(&reader) != CONFIG_CACHE_VERSION)
+	{
+		g_free(contents);
+		return;
+	}
+
+	count = cache_read_uint(&reader);
+	for (i = 0; i < count && ! reader.error; i++)
+	{
+		ConfigCacheEntry *entry = g_new0(ConfigCacheEntry, 1);
+		gchar *key = cache_read_string(&reader);
+		guint32 n_sources = cache_read_uint(&reader);
+		guint32 j;
+
+		entry->sources = g_array_new(FALSE, FALSE, sizeof(ConfigCacheSource));
+		for (j = 0; j < n_sources && ! reader.error; j++)
+		{
+			ConfigCacheSource source;
+
+			source.path = cache_read_string(&reader);
+			source.mtime = cache_read_int64(&reader);
+			source.size = cache_read_int64(&reader);
+			g_array_append_val(entry->sources, source);
+		}
+		entry->data[0] = cache_read_string(&reader);
+		entry->data[1] = cache_read_string(&reader);
+
+		if (reader.error)
+		{
+			g_free(key);
+			config_cache_entry_free(entry);
+			break;
+		}
+		g_hash_table_insert(config_cache.entries, key, entry);
+	}
+	g_free(contents);
+}
+
+
+/* Loads config and config_home from the cache entry for key unless any of its source
+ * files has changed. flags are those the files are loaded with.
+ * Returns: TRUE if the keyfiles were loaded from the cache. */
+static gboolean config_cache_lookup(const gchar *key, GKeyFileFlags flags,
+		GKeyFile *config, GKeyFile *config_home)
+{
+	ConfigCacheEntry *entry;
+	guint i;
+
+	if (config_cache.entries == NULL)
+		config_cache_read();
+
+	entry = g_hash_table_lookup(config_cache.entries, key);
+	if (entry == NULL)
+		return FALSE;
+
+	for (i = 0; i < entry->sources->len; i++)
+	{
+		ConfigCacheSource *source = &g_array_index(entry->sources, ConfigCacheSource, i);
+		gint64 mtime, size;
+
+		get_file_stamp(source->path, &mtime, &size);
+		if (mtime != source->mtime || size != source->size)
+			goto invalid;
+	}
+	if (g_key_file_load_from_data(config, entry->data[0], -1, flags, NULL) &&
+		g_key_file_load_from_data(config_home, entry->data[1], -1, flags, NULL))
+	{
+		return TRUE;
+	}
+
+	invalid:
+	g_hash_table_remove(config_cache.entries, key);
+	config_cache.dirty = TRUE;
+	return FALSE;
+}
+
+
+/* Stores config and config_home for key, which were read from the files in sources. */
+static void config_cache_store(const gchar *key, GPtrArray *sources,
+		GKeyFile *config, GKeyFile *config_home)
+{
+	ConfigCacheEntry *entry = g_new0(ConfigCacheEntry, 1);
+	gint64 now = (gint64) time(NULL);
+	guint i;
+
+	entry->sources = g_array_sized_new(FALSE, FALSE, sizeof(ConfigCacheSource), sources->len);
+	for (i = 0; i < sources->len; i++)
+	{
+		ConfigCacheSource source;
+
+		source.path = g_strdup(g_ptr_array_index(sources, i));
+		get_file_stamp(source.path, &source.mtime, &source.size);
+		/* an edit later in this second would keep the time and maybe the size, so the
+		 * entry is only used once it is read again from files older than that */
+		if (source.mtime >= now)
+			source.mtime = CONFIG_CACHE_RACY_MTIME;
+		g_array_append_val(entry->sources, source);
+	}
+	entry->data[0] = g_key_file_to_data(config, NULL, NULL);
+	entry->data[1] = g_key_file_to_data(config_home, NULL, NULL);
+
+	if (config_cache.entries == NULL)
+		config_cache_read();
+	g_hash_table_insert(config_cache.entries, g_strdup(key), entry);
+	config_cache.dirty = TRUE;
+}
+
+
+/* Loads config from filename and config_home from filename_home with flags, or from
+ * the cache entry for key when neither file has changed since it was stored. */
+void filetypes_load_cached_keyfiles(const gchar *key, const gchar *filename,
+		const gchar *filename_home, GKeyFileFlags flags, GKeyFile *config, GKeyFile *config_home)
+{
+	GPtrArray *sources;
+
+	if (config_cache_lookup(key, flags, config, config_home))
+		return;
+
+	g_key_file_load_from_file(config, filename, flags, NULL);
+	g_key_file_load_from_file(config_home, filename_home, flags, NULL);
+
+	sources = g_ptr_array_new();
+	g_ptr_array_add(sources, (gpointer) filename);
+	g_ptr_array_add(sources, (gpointer) filename_home);
+	config_cache_store(key, sources, config, config_home);
+	g_ptr_array_free(sources, TRUE);
+}
+
+
+static void cache_write_uint(GString *buf, guint32 value)
+{
+	g_string_append_len(buf, (const gchar *) &value, sizeof value);
+}
+
+
+static void cache_write_int64(GString *buf, gint64 value)
+{
+	g_string_append_len(buf, (const gchar *) &value, sizeof value);
+}
+
+
+static void cache_write_string(GString *buf, const gchar *str)
+{
+	guint32 len = strlen(str);
+
+	cache_write_uint(buf, len);
+	g_string_append_len(buf, str, len);
+}
+
+
+static void cache_write_entry(gpointer key, gpointer value, gpointer user_data)
+{
+	ConfigCacheEntry *entry = value;
+	GString *buf = user_data;
+	guint i;
+
+	cache_write_string(buf, key);
+	cache_write_uint(buf, entry->sources->len);
+	for (i = 0; i < entry->sources->len; i++)
+	{
+		ConfigCacheSource *source = &g_array_index(entry->sources, ConfigCacheSource, i);
+
+		cache_write_string(buf, source->path);
+		cache_write_int64(buf, source->mtime);
+		cache_write_int64(buf, source->size);
+	}
+	cache_write_string(buf, entry->data[0]);
+	cache_write_string(buf, entry->data[1]);
+}
+
+
+static void config_cache_write(void)
+{
+	GString *buf;
+	GError *error = NULL;
+	gchar *filename;
+
+	if (config_cache.entries == NULL || ! config_cache.dirty)
+		return;
+
+	buf = g_string_new(NULL);
+	cache_write_uint(buf, CONFIG_CACHE_MAGIC);
+	cache_write_uint(buf, CONFIG_CACHE_VERSION);
+	cache_write_uint(buf, g_hash_table_size(config_cache.entries));
+	g_hash_table_foreach(config_cache.entries, cache_write_entry, buf);
+
+	filename = config_cache_get_filename();
+	if (! g_file_set_contents(filename, buf->str, buf->len, &error))
+	{
+		geany_debug("Could not write %s (%s)", filename, error->message);
+		g_error_free(error);
+	}
+	g_free(filename);
+	g_string_free(buf, TRUE);
+	config_cache.dirty = FALSE;
 }
 
 
@@ -1299,7 +1651,8 @@ static gchar *filetypes_get_filename(GeanyFiletype *ft, gboolean user)
 }
 
 
-static void add_group_keys(GKeyFile *kf, const gchar *group, GeanyFiletype *ft)
+/* sources collects the names of the files read. */
+static void add_group_keys(GKeyFile *kf, const gchar *group, GeanyFiletype *ft, GPtrArray *sources)
 {
 	gchar *files[2];
 	gboolean loaded = FALSE;
@@ -1318,17 +1671,15 @@ static void add_group_keys(GKeyFile *kf, const gchar *group, GeanyFiletype *ft)
 			loaded = TRUE;
 		}
 		g_key_file_free(src);
+		g_ptr_array_add(sources, files[i]);
 	}
 
 	if (!loaded)
 		geany_debug("Could not read config file %s for [%s=%s]!", files[0], group, ft->name);
-
-	g_free(files[0]);
-	g_free(files[1]);
 }
 
 
-static void copy_ft_groups(GKeyFile *kf)
+static void copy_ft_groups(GKeyFile *kf, GPtrArray *sources)
 {
 	gchar **groups = g_key_file_get_groups(kf, NULL);
 	gchar **ptr;
@@ -1350,7 +1701,7 @@ static void copy_ft_groups(GKeyFile *kf)
 
 		ft = filetypes_lookup_by_name(name);
 		if (ft)
-			add_group_keys(kf, group, ft);
+			add_group_keys(kf, group, ft, sources);
 	}
 	g_strfreev(groups);
 }
@@ -1382,6 +1733,7 @@ void filetypes_load_config(guint ft_id, gboolean reload)
 	GKeyFile *config, *config_home;
 	GeanyFiletypePrivate *pft;
 	GeanyFiletype *ft;
+	gchar *cache_key;
 
 	g_return_if_fail(ft_id < filetypes_array->len);
 
@@ -1399,20 +1751,30 @@ void filetypes_load_config(guint ft_id, gboolean reload)
 
 	config = g_key_file_new();
 	config_home = g_key_file_new();
+	cache_key = g_strconcat("filetypes.", ft->name, NULL);
+	if (! config_cache_lookup(cache_key, G_KEY_FILE_KEEP_COMMENTS, config, config_home))
 	{
 		/* highlighting uses GEANY_FILETYPES_NONE for common settings */
+		GPtrArray *sources = g_ptr_array_new();
 		gchar *f;
 
 		f = filetypes_get_filename(ft, FALSE);
 		load_system_keyfile(config, f, G_KEY_FILE_KEEP_COMMENTS, ft);
+		g_ptr_array_add(sources, f);
 
-		SETPTR(f, filetypes_get_filename(ft, TRUE));
+		f = filetypes_get_filename(ft, TRUE);
 		g_key_file_load_from_file(config_home, f, G_KEY_FILE_KEEP_COMMENTS, NULL);
-		g_free(f);
+		g_ptr_array_add(sources, f);
+
+		/* Copy keys for any groups with [group=C] from system keyfile */
+		copy_ft_groups(config, sources);
+		copy_ft_groups(config_home, sources);
+
+		config_cache_store(cache_key, sources, config, config_home);
+		g_ptr_array_foreach(sources, (GFunc) g_free, NULL);
+		g_ptr_array_free(sources, TRUE);
 	}
-	/* Copy keys for any groups with [group=C] from system keyfile */
-	copy_ft_groups(config);
-	copy_ft_groups(config_home);
+	g_free(cache_key);
 
 	load_settings(ft_id, config, config_home);
 	highlighting_init_styles(ft_id, config, config_home);
@@ -1555,13 +1917,13 @@ static void compile_regex(GeanyFiletype *ft, gchar *regstr)
 }
 
 
-gboolean filetypes_parse_error_message(GeanyFiletype *ft, const gchar *message,
-		gchar **filename, gint *line)
+/* Returns the error regex of ft for the current build group, compiling it if needed, or NULL.
+ * The regex is owned by ft and replaced when the build settings change. */
+GRegex *filetypes_get_error_regex(GeanyFiletype *ft)
 {
 	gchar *regstr;
 	gchar **tmp;
 	GeanyDocument *doc;
-	GMatchInfo *minfo;
 
 	if (ft == NULL)
 	{
@@ -1571,24 +1933,46 @@ gboolean filetypes_parse_error_message(GeanyFiletype *ft, const gchar *message,
 	}
 	tmp = build_get_regex(build_info.grp, ft, NULL);
 	if (tmp == NULL)
-		return FALSE;
+		return NULL;
 	regstr = *tmp;
 
-	*filename = NULL;
-	*line = -1;
-
 	if (G_UNLIKELY(! NZV(regstr)))
-		return FALSE;
+		return NULL;
 
 	if (!ft->priv->error_regex || regstr != ft->priv->last_error_pattern)
 	{
 		compile_regex(ft, regstr);
 		ft->priv->last_error_pattern = regstr;
 	}
-	if (!ft->priv->error_regex)
+	return ft->priv->error_regex;
+}
+
+
+gboolean filetypes_parse_error_message(GeanyFiletype *ft, const gchar *message,
+		gchar **filename, gint *line)
+{
+	GRegex *regex = filetypes_get_error_regex(ft);
+
+	*filename = NULL;
+	*line = -1;
+
+	if (regex == NULL)
 		return FALSE;
+	return filetypes_match_error_regex(regex, message, filename, line);
+}
+
+
+/* Matches message with a regex from filetypes_get_error_regex().
+ * This uses no global state, so it can be called from any thread. */
+gboolean filetypes_match_error_regex(GRegex *regex, const gchar *message,
+		gchar **filename, gint *line)
+{
+	GMatchInfo *minfo;
+
+	*filename = NULL;
+	*line = -1;
 
-	if (!g_regex_match(ft->priv->error_regex, message, 0, &minfo))
+	if (!g_regex_match(regex, message, 0, &minfo))
 	{
 		g_match_info_free(minfo);
 		return FALSE;
@@ -1709,8 +2093,8 @@ static void read_filetype_config(void)
 	GKeyFile *sysconfig = g_key_file_new();
 	GKeyFile *userconfig = g_key_file_new();
 
-	g_key_file_load_from_file(sysconfig, sysconfigfile, G_KEY_FILE_NONE, NULL);
-	g_key_file_load_from_file(userconfig, userconfigfile, G_KEY_FILE_NONE, NULL);
+	filetypes_load_cached_keyfiles("filetype_extensions", sysconfigfile, userconfigfile,
+		G_KEY_FILE_NONE, sysconfig, userconfig);
 
 	read_extensions(sysconfig, userconfig);
 	read_groups(sysconfig);
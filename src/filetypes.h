@@ -200,6 +200,9 @@ void filetypes_free_types(void);
 
 void filetypes_load_config(guint ft_id, gboolean reload);
 
+void filetypes_load_cached_keyfiles(const gchar *key, const gchar *filename,
+		const gchar *filename_home, GKeyFileFlags flags, GKeyFile *config, GKeyFile *config_home);
+
 void filetypes_save_commands(GeanyFiletype *ft);
 
 void filetypes_select_radio_item(const GeanyFiletype *ft);
@@ -213,6 +216,11 @@ gboolean filetype_has_tags(GeanyFiletype *ft);
 gboolean filetypes_parse_error_message(GeanyFiletype *ft, const gchar *message,
 		gchar **filename, gint *line);
 
+GRegex *filetypes_get_error_regex(GeanyFiletype *ft);
+
+gboolean filetypes_match_error_regex(GRegex *regex, const gchar *message,
+		gchar **filename, gint *line);
+
 gboolean filetype_get_comment_open_close(const GeanyFiletype *ft, gboolean single_first,
 		const gchar **co, const gchar **cc);
 
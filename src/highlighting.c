@@ -561,8 +561,13 @@ static void load_named_styles(GKeyFile *config, GKeyFile *config_home)
 
 		if (g_file_test(path, G_FILE_TEST_EXISTS) || g_file_test(path_home, G_FILE_TEST_EXISTS))
 		{
-			config = utils_key_file_new(path);
-			config_home = utils_key_file_new(path_home);
+			gchar *cache_key = g_strconcat(GEANY_COLORSCHEMES_SUBDIR "/", scheme, NULL);
+
+			config = g_key_file_new();
+			config_home = g_key_file_new();
+			filetypes_load_cached_keyfiles(cache_key, path, path_home, G_KEY_FILE_KEEP_COMMENTS,
+				config, config_home);
+			g_free(cache_key);
 			free_kf = TRUE;
 		}
 		/* if color scheme is missing, use default */
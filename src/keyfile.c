@@ -59,6 +59,7 @@
 #include "templates.h"
 #include "toolbar.h"
 #include "stash.h"
+#include "profile.h"
 
 
 /* some default settings which are used at the very first start of Geany to fill
@@ -84,6 +85,7 @@
 #define GEANY_MAX_AUTOCOMPLETE_WORDS	30
 #define GEANY_MAX_SYMBOLS_UPDATE_FREQ	250
 #define GEANY_DEFAULT_FILETYPE_REGEX    "-\\*-\\s*([^\\s]+)\\s*-\\*-"
+#define GEANY_DEFAULT_LARGE_FILE_SIZE	64
 
 
 static gchar *scribble_text = NULL;
@@ -103,6 +105,7 @@ static struct
 	gint number_ft_menu_items;
 	gint number_non_ft_menu_items;
 	gint number_exec_menu_items;
+	gint max_build_jobs;
 }
 build_menu_prefs;
 
@@ -214,12 +217,18 @@ static void init_pref_groups(void)
 		"use_gtk_word_boundaries", TRUE);
 	stash_group_add_boolean(group, &editor_prefs.complete_snippets_whilst_editing,
 		"complete_snippets_whilst_editing", FALSE);
+	stash_group_add_integer(group, &editor_prefs_priv.layout_cache,
+		"layout_cache", SC_CACHE_CARET);
 	stash_group_add_boolean(group, &file_prefs.use_safe_file_saving,
 		atomic_file_saving_key, FALSE);
 	stash_group_add_boolean(group, &file_prefs.gio_unsafe_save_backup,
 		"gio_unsafe_save_backup", FALSE);
 	stash_group_add_boolean(group, &file_prefs.use_gio_unsafe_file_saving,
 		"use_gio_unsafe_file_saving", TRUE);
+	stash_group_add_integer(group, &document_prefs_priv.large_file_size,
+		"large_file_size", GEANY_DEFAULT_LARGE_FILE_SIZE);
+	stash_group_add_boolean(group, &document_prefs_priv.large_file_mmap,
+		"large_file_mmap", FALSE);
 	/* for backwards-compatibility */
 	stash_group_add_integer(group, &editor_prefs.indentation->hard_tab_width,
 		"indent_hard_tab_width", 8);
@@ -240,6 +249,8 @@ static void init_pref_groups(void)
 		"number_non_ft_menu_items", 0);
 	stash_group_add_integer(group, &build_menu_prefs.number_exec_menu_items,
 		"number_exec_menu_items", 0);
+	stash_group_add_integer(group, &build_menu_prefs.max_build_jobs,
+		"max_build_jobs", 0);
 }
 
 
@@ -309,7 +320,7 @@ static gchar *get_session_file_string(GeanyDocument *doc)
 	escaped_filename = g_uri_escape_string(locale_filename, NULL, TRUE);
 
 	fname = g_strdup_printf("%d;%s;%d;E%s;%d;%d;%d;%s;%d;%d",
-		sci_get_current_position(doc->editor->sci),
+		document_get_pending_pos(doc),
 		ft->name,
 		doc->readonly,
 		doc->encoding,
@@ -913,6 +924,7 @@ static void load_dialog_prefs(GKeyFile *config)
 	build_set_group_count(GEANY_GBG_FT, build_menu_prefs.number_ft_menu_items);
 	build_set_group_count(GEANY_GBG_NON_FT, build_menu_prefs.number_non_ft_menu_items);
 	build_set_group_count(GEANY_GBG_EXEC, build_menu_prefs.number_exec_menu_items);
+	build_set_max_jobs(build_menu_prefs.max_build_jobs);
 	build_load_menu(config, GEANY_BCS_PREF, NULL);
 
 	/* printing */
@@ -1113,8 +1125,12 @@ static gboolean open_session_file(gchar **tmp, guint len)
 	if (g_file_test(locale_filename, G_FILE_TEST_IS_REGULAR))
 	{
 		GeanyFiletype *ft = filetypes_lookup_by_name(ft_name);
-		GeanyDocument *doc = document_open_file_full(
-			NULL, locale_filename, pos, ro, ft, encoding);
+		GeanyDocument *doc;
+
+		/* the file is read when its tab is first shown or in idle time */
+		profile_begin("document", unescaped_filename);
+		doc = document_open_file_deferred(locale_filename, pos, ro, ft, encoding);
+		profile_end();
 
 		if (doc)
 		{
@@ -1147,6 +1163,7 @@ void configuration_open_files(void)
 {
 	gint i;
 	gboolean failure = FALSE;
+	GeanyDocument *doc;
 
 	/* necessary to set it to TRUE for project session support */
 	main_status.opening_session_files = TRUE;
@@ -1193,6 +1210,11 @@ void configuration_open_files(void)
 		gtk_notebook_set_current_page(GTK_NOTEBOOK(main_widgets.notebook), session_notebook_page);
 	}
 	main_status.opening_session_files = FALSE;
+
+	/* the switch page callback isn't triggered if the current page didn't change */
+	doc = document_get_current();
+	if (doc != NULL)
+		document_load_pending(doc);
 }
 
 
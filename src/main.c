@@ -69,6 +69,7 @@
 #include "navqueue.h"
 #include "plugins.h"
 #include "printing.h"
+#include "profile.h"
 #include "toolbar.h"
 #include "geanyobject.h"
 
@@ -85,6 +86,10 @@
 #endif
 
 
+static gboolean on_profile_startup_option(const gchar *option_name, const gchar *value,
+		gpointer data, GError **error);
+
+
 GeanyApp	*app;
 gboolean	ignore_callback;	/* hack workaround for GTK+ toggle button callback problem */
 
@@ -135,6 +140,7 @@ static GOptionEntry entries[] =
 	{ "no-plugins", 'p', 0, G_OPTION_ARG_NONE, &no_plugins, N_("Don't load plugins"), NULL },
 #endif
 	{ "print-prefix", 0, 0, G_OPTION_ARG_NONE, &print_prefix, N_("Print Geany's installation prefix"), NULL },
+	{ "profile-startup", 0, G_OPTION_FLAG_OPTIONAL_ARG, G_OPTION_ARG_CALLBACK, on_profile_startup_option, N_("Print the time taken by each startup phase, or write it to FILE as a Chrome trace"), N_("FILE") },
 	{ "read-only", 'r', 0, G_OPTION_ARG_NONE, &cl_options.readonly, N_("Open all FILES in read-only mode (see documention)"), NULL },
 	{ "no-session", 's', G_OPTION_FLAG_REVERSE, G_OPTION_ARG_NONE, &cl_options.load_session, N_("Don't load the previous session's files"), NULL },
 #ifdef HAVE_VTE
@@ -521,6 +527,145 @@ static void wait_for_input_on_windows(void)
 }
 
 
+#ifdef HAVE_SOCKET
+/* Finds the entry for a "-x" or "--name[=value]" argument, setting value to the text
+ * after '=' if there is one. */
+static const GOptionEntry *lookup_option_entry(const gchar *arg, const gchar **value)
+{
+	const GOptionEntry *entry;
+
+	*value = NULL;
+	if (arg[1] == '-')
+	{
+		const gchar *name = arg + 2;
+		const gchar *equals = strchr(name, '=');
+		gsize len = equals ? (gsize) (equals - name) : strlen(name);
+
+		if (equals)
+			*value = equals + 1;
+		for (entry = entries; entry->long_name != NULL; entry++)
+		{
+			if (strlen(entry->long_name) == len && strncmp(entry->long_name, name, len) == 0)
+				return entry;
+		}
+	}
+	else if (arg[1] != '\0' && arg[2] == '\0')
+	{
+		for (entry = entries; entry->long_name != NULL; entry++)
+		{
+			if (entry->short_name == arg[1])
+				return entry;
+		}
+	}
+	return NULL;
+}
+
+
+/* Options which make no difference when the files are opened by a running instance */
+static gboolean option_is_unused_by_running_instance(gpointer arg_data)
+{
+	if (arg_data == &verbose_mode || arg_data == &no_msgwin || arg_data == &ignore_global_tags ||
+		arg_data == &cl_options.load_session || arg_data == &dummy)
+		return TRUE;
+#ifdef HAVE_PLUGINS
+	if (arg_data == &no_plugins)
+		return TRUE;
+#endif
+#ifdef HAVE_VTE
+	if (arg_data == &no_vte || arg_data == &lib_vte)
+		return TRUE;
+#endif
+	return FALSE;
+}
+
+
+static gboolean parse_int_option(const gchar *value, gint *result)
+{
+	gchar *end;
+
+	*result = (gint) strtol(value, &end, 10);
+	return *value != '\0' && *end == '\0';
+}
+
+
+/* Sends the files on the command line to a running instance before GTK, the locale and
+ * the configuration directory are set up, so opening files from other programs is fast.
+ * Only the options useful for this are understood here, for anything else (or if there is
+ * no running instance) FALSE is returned and the normal startup handles the command line,
+ * which also checks for a running instance. */
+static gboolean open_files_in_running_instance(gint argc, gchar **argv)
+{
+	GPtrArray *filenames = g_ptr_array_new();
+	const gchar *config_dir = NULL;
+	const gchar *socket_file_name = NULL;
+	gint line = -1, column = -1;
+	gboolean readonly = FALSE;
+	gboolean options_done = FALSE;
+	gboolean ok = TRUE;
+	gint i;
+
+	for (i = 1; i < argc && ok; i++)
+	{
+		const gchar *arg = argv[i];
+		const GOptionEntry *entry;
+		const gchar *value;
+
+		/* +NNN line numbers are handled before option parsing, see parse_command_line_options() */
+		if (arg[0] == '+')
+			ok = parse_int_option(arg + 1, &line);
+		else if (options_done || arg[0] != '-' || arg[1] == '\0')
+			g_ptr_array_add(filenames, main_get_argv_filename(arg));
+		else if (strcmp(arg, "--") == 0)
+			options_done = TRUE;
+		else
+		{
+			entry = lookup_option_entry(arg, &value);
+			if (entry != NULL && entry->arg != G_OPTION_ARG_NONE && value == NULL && i + 1 < argc)
+				value = argv[++i];
+
+			if (entry == NULL || (entry->arg == G_OPTION_ARG_NONE) != (value == NULL))
+				ok = FALSE;
+			else if (entry->arg_data == &cl_options.readonly)
+				readonly = TRUE;
+			else if (entry->arg_data == &cl_options.goto_line)
+				ok = parse_int_option(value, &line);
+			else if (entry->arg_data == &cl_options.goto_column)
+				ok = parse_int_option(value, &column);
+			else if (entry->arg_data == &alternate_config)
+				config_dir = value;
+			else if (entry->arg_data == &cl_options.socket_filename)
+				socket_file_name = value;
+			else
+				ok = option_is_unused_by_running_instance(entry->arg_data);
+		}
+	}
+
+	/* without files a new instance is started */
+	ok = ok && filenames->len > 0;
+	if (ok)
+	{
+		gchar *dir = config_dir ? g_strdup(config_dir) :
+			g_build_filename(g_get_user_config_dir(), "geany", NULL);
+
+		ok = socket_send_open_request(dir, socket_file_name, filenames, line, column, readonly);
+		g_free(dir);
+	}
+	g_ptr_array_foreach(filenames, (GFunc) g_free, NULL);
+	g_ptr_array_free(filenames, TRUE);
+	return ok;
+}
+#endif
+
+
+static gboolean on_profile_startup_option(const gchar *option_name, const gchar *value,
+		gpointer data, GError **error)
+{
+	/* start as early as possible, the options are parsed before most of the startup */
+	profile_start(value);
+	return TRUE;
+}
+
+
 static void parse_command_line_options(gint *argc, gchar ***argv)
 {
 	GError *error = NULL;
@@ -960,7 +1105,17 @@ static void load_startup_files(gint argc, gchar **argv)
 
 static gboolean send_startup_complete(gpointer data)
 {
+	profile_phase("startup-complete signal");
 	g_signal_emit_by_name(geany_object, "geany-startup-complete");
+	profile_finish();
+	return FALSE;
+}
+
+
+static gboolean on_first_paint(GtkWidget *widget, gpointer event, gpointer user_data)
+{
+	profile_mark("startup", "first paint");
+	g_signal_handlers_disconnect_by_func(widget, on_first_paint, user_data);
 	return FALSE;
 }
 
@@ -1027,6 +1182,13 @@ gint main(gint argc, gchar **argv)
 	gint config_dir_result;
 	const gchar *locale;
 
+#ifdef HAVE_SOCKET
+	/* hand the files over before doing anything else, this is the common case when Geany
+	 * is started from a file manager or with xargs */
+	if (open_files_in_running_instance(argc, argv))
+		return 0;
+#endif
+
 	log_handlers_init();
 
 	app = g_new0(GeanyApp, 1);
@@ -1061,6 +1223,7 @@ gint main(gint argc, gchar **argv)
 	signal(SIGPIPE, SIG_IGN);
 #endif
 
+	profile_phase("setup");
 	config_dir_result = setup_config_dir();
 #ifdef HAVE_SOCKET
 	/* check and create (unix domain) socket for remote operation */
@@ -1076,6 +1239,7 @@ gint main(gint argc, gchar **argv)
 			 * documents has been sent */
 			if (argc > 1 || cl_options.list_documents)
 			{
+				profile_finish();
 				gdk_notify_startup_complete();
 				g_free(app->configdir);
 				g_free(app->datadir);
@@ -1104,8 +1268,10 @@ gint main(gint argc, gchar **argv)
 	geany_object = geany_object_new();
 
 	/* inits */
+	profile_phase("main_init");
 	main_init();
 
+	profile_phase("module init");
 	encodings_init();
 	editor_init();
 
@@ -1118,15 +1284,19 @@ gint main(gint argc, gchar **argv)
 	plugins_init();
 #endif
 	sidebar_init();
+	profile_phase("configuration_load");
 	load_settings();	/* load keyfile */
 
+	profile_phase("UI init");
 	msgwin_init();
 	build_init();
 	ui_create_insert_menu_items();
 	ui_create_insert_date_menu_items();
 	keybindings_init();
 	notebook_init();
+	profile_phase("filetypes_init");
 	filetypes_init();
+	profile_phase("late init");
 	templates_init();
 	navqueue_init();
 	document_init_doclist();
@@ -1150,14 +1320,17 @@ gint main(gint argc, gchar **argv)
 			g_strerror(config_dir_result));
 
 	/* apply all configuration options */
+	profile_phase("apply_settings");
 	apply_settings();
 
 #ifdef HAVE_PLUGINS
 	/* load any enabled plugins before we open any documents */
+	profile_phase("plugins_load_active");
 	if (want_plugins)
 		plugins_load_active();
 #endif
 
+	profile_phase("keybindings and menus");
 	ui_sidebar_show_hide();
 
 	/* set the active sidebar page after plugins have been loaded */
@@ -1171,10 +1344,12 @@ gint main(gint argc, gchar **argv)
 	tools_create_insert_custom_command_menu_items();
 
 	/* load any command line files or session files */
+	profile_phase("load_startup_files");
 	main_status.opening_session_files = TRUE;
 	load_startup_files(argc, argv);
 	main_status.opening_session_files = FALSE;
 
+	profile_phase("show window");
 	/* open a new file if no other file was opened */
 	document_new_file_if_non_open();
 
@@ -1195,6 +1370,14 @@ gint main(gint argc, gchar **argv)
 
 	/* finally show the window */
 	document_grab_focus(doc);
+	if (profile_is_enabled())
+	{
+#if GTK_CHECK_VERSION(3, 0, 0)
+		g_signal_connect(main_widgets.window, "draw", G_CALLBACK(on_first_paint), NULL);
+#else
+		g_signal_connect(main_widgets.window, "expose-event", G_CALLBACK(on_first_paint), NULL);
+#endif
+	}
 	gtk_widget_show(main_widgets.window);
 	main_status.main_window_realized = TRUE;
 
@@ -1214,6 +1397,7 @@ gint main(gint argc, gchar **argv)
 	 * tell other components, mainly plugins, that startup is complete */
 	g_idle_add_full(G_PRIORITY_LOW, send_startup_complete, NULL, NULL);
 
+	profile_phase("main loop");
 	gtk_main();
 	return 0;
 }
@@ -59,9 +59,31 @@ typedef struct
 	guint min_fields;		/* used to detect errors after parsing */
 	guint line_idx;			/* idx of the field where the line is */
 	gint file_idx;			/* idx of the field where the filename is or -1 */
+	const gchar *current_file;	/* filename to use when file_idx is -1, or NULL */
 }
 ParseData;
 
+/* An error parsed from a row of the compiler tab */
+typedef struct CompilerError
+{
+	gchar *filename;	/* locale encoded */
+	gint line;			/* as reported, usually counting from 1 */
+	gint row;			/* index of the row in the compiler tab */
+}
+CompilerError;
+
+/* Index of the errors in the compiler tab, so that they don't have to be parsed again
+ * from the row text to navigate them or to find the errors in a file. */
+static struct
+{
+	GPtrArray *errors;		/* CompilerError, ordered by row */
+	GHashTable *real_paths;	/* reported file name -> real path, to avoid resolving it again */
+	GHashTable *files;		/* real path -> GArray of the lines with errors, sorted */
+	GArray *other_rows;		/* error coloured rows which were not parsed, e.g. added by plugins */
+	gint rows;				/* number of rows in the compiler tab */
+}
+compiler_errors;
+
 MessageWindow msgwindow;
 
 
@@ -93,6 +115,95 @@ void msgwin_set_messages_dir(const gchar *messages_dir)
 }
 
 
+static void free_lines(gpointer data)
+{
+	g_array_free(data, TRUE);
+}
+
+
+static void compiler_errors_clear(void)
+{
+	guint i;
+
+	for (i = 0; i < compiler_errors.errors->len; i++)
+	{
+		CompilerError *error = g_ptr_array_index(compiler_errors.errors, i);
+
+		g_free(error->filename);
+		g_free(error);
+	}
+	g_ptr_array_set_size(compiler_errors.errors, 0);
+	g_array_set_size(compiler_errors.other_rows, 0);
+	/* files is keyed by the strings in real_paths, so clear it first */
+	g_hash_table_remove_all(compiler_errors.files);
+	g_hash_table_remove_all(compiler_errors.real_paths);
+	compiler_errors.rows = 0;
+}
+
+
+/* Returns: the index of the new error. */
+static gint compiler_errors_add(const gchar *filename, gint line, gint row)
+{
+	CompilerError *error = g_new(CompilerError, 1);
+	const gchar *real_path;
+	GArray *lines;
+	guint lo, hi;
+
+	error->filename = g_strdup(filename);
+	error->line = line;
+	error->row = row;
+	g_ptr_array_add(compiler_errors.errors, error);
+
+	real_path = g_hash_table_lookup(compiler_errors.real_paths, filename);
+	if (real_path == NULL)
+	{
+		gchar *path = tm_get_real_path(filename);
+
+		if (path == NULL)	/* the file doesn't exist */
+			path = g_strdup(filename);
+		g_hash_table_insert(compiler_errors.real_paths, g_strdup(filename), path);
+		real_path = path;
+	}
+	lines = g_hash_table_lookup(compiler_errors.files, real_path);
+	if (lines == NULL)
+	{
+		lines = g_array_new(FALSE, FALSE, sizeof(gint));
+		g_hash_table_insert(compiler_errors.files, (gpointer) real_path, lines);
+	}
+	/* keep the lines sorted, they are mostly reported in order */
+	lo = 0;
+	hi = lines->len;
+	while (lo < hi)
+	{
+		guint mid = (lo + hi) / 2;
+
+		if (g_array_index(lines, gint, mid) <= line)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	g_array_insert_val(lines, lo, line);
+
+	return compiler_errors.errors->len - 1;
+}
+
+
+/* Gets the sorted lines of the errors in the compiler tab for a file, as reported
+ * (usually counting from 1). real_path is a locale encoded path from tm_get_real_path().
+ * Returns: the number of errors in the file. */
+guint msgwin_compiler_get_error_lines(const gchar *real_path, const gint **lines)
+{
+	GArray *array = g_hash_table_lookup(compiler_errors.files, real_path);
+
+	*lines = NULL;
+	if (array == NULL)
+		return 0;
+
+	*lines = (const gint *) array->data;
+	return array->len;
+}
+
+
 void msgwin_init(void)
 {
 	msgwindow.notebook = ui_lookup_widget(main_widgets.window, "notebook_info");
@@ -102,6 +213,12 @@ void msgwin_init(void)
 	msgwindow.scribble = ui_lookup_widget(main_widgets.window, "textview_scribble");
 	msgwindow.messages_dir = NULL;
 
+	compiler_errors.errors = g_ptr_array_new();
+	compiler_errors.real_paths = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+	compiler_errors.files = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, free_lines);
+	compiler_errors.other_rows = g_array_new(FALSE, FALSE, sizeof(gint));
+	compiler_errors.rows = 0;
+
 	prepare_status_tree_view();
 	prepare_msg_tree_view();
 	prepare_compiler_tree_view();
@@ -117,6 +234,12 @@ void msgwin_init(void)
 void msgwin_finalize(void)
 {
 	g_free(msgwindow.messages_dir);
+
+	compiler_errors_clear();
+	g_ptr_array_free(compiler_errors.errors, TRUE);
+	g_array_free(compiler_errors.other_rows, TRUE);
+	g_hash_table_destroy(compiler_errors.files);
+	g_hash_table_destroy(compiler_errors.real_paths);
 }
 
 
@@ -214,7 +337,8 @@ static void prepare_compiler_tree_view(void)
 	GtkTreeViewColumn *column;
 	GtkTreeSelection *selection;
 
-	msgwindow.store_compiler = gtk_list_store_new(2, GDK_TYPE_COLOR, G_TYPE_STRING);
+	/* color, text, index of the parsed error or -1 */
+	msgwindow.store_compiler = gtk_list_store_new(3, GDK_TYPE_COLOR, G_TYPE_STRING, G_TYPE_INT);
 	gtk_tree_view_set_model(GTK_TREE_VIEW(msgwindow.tree_compiler), GTK_TREE_MODEL(msgwindow.store_compiler));
 	g_object_unref(msgwindow.store_compiler);
 
@@ -280,35 +404,77 @@ void msgwin_compiler_add(gint msg_color, const gchar *format, ...)
 }
 
 
-void msgwin_compiler_add_string(gint msg_color, const gchar *msg)
+/* filename and line are the parsed error on the line or NULL and -1. */
+static void compiler_append(gint msg_color, const gchar *msg, const gchar *filename, gint line,
+		GtkTreeIter *iter)
 {
-	GtkTreeIter iter;
-	GtkTreePath *path;
 	const GdkColor *color = get_color(msg_color);
 	gchar *utf8_msg;
+	gint error_idx = -1;
 
 	if (! g_utf8_validate(msg, -1, NULL))
 		utf8_msg = utils_get_utf8_from_locale(msg);
 	else
 		utf8_msg = (gchar *) msg;
 
-	gtk_list_store_append(msgwindow.store_compiler, &iter);
-	gtk_list_store_set(msgwindow.store_compiler, &iter, 0, color, 1, utf8_msg, -1);
+	if (filename != NULL && line != -1)
+		error_idx = compiler_errors_add(filename, line, compiler_errors.rows);
+	else if (msg_color == COLOR_RED)
+		g_array_append_val(compiler_errors.other_rows, compiler_errors.rows);
+	compiler_errors.rows++;
+
+	gtk_list_store_append(msgwindow.store_compiler, iter);
+	gtk_list_store_set(msgwindow.store_compiler, iter, 0, color, 1, utf8_msg, 2, error_idx, -1);
+
+	if (utf8_msg != msg)
+		g_free(utf8_msg);
+}
+
+
+/* Scrolls to iter if wanted and enables the error navigation items after messages
+ * have been added. */
+static void compiler_added(GtkTreeIter *iter)
+{
+	GtkTreePath *path;
 
 	if (ui_prefs.msgwindow_visible && interface_prefs.compiler_tab_autoscroll)
 	{
 		path = gtk_tree_model_get_path(
-			gtk_tree_view_get_model(GTK_TREE_VIEW(msgwindow.tree_compiler)), &iter);
+			gtk_tree_view_get_model(GTK_TREE_VIEW(msgwindow.tree_compiler)), iter);
 		gtk_tree_view_scroll_to_cell(GTK_TREE_VIEW(msgwindow.tree_compiler), path, NULL, TRUE, 0.5, 0.5);
 		gtk_tree_path_free(path);
 	}
 
-	/* calling build_menu_update for every build message would be overkill, TODO really should call it once when all done */
 	gtk_widget_set_sensitive(build_get_menu_items(-1)->menu_item[GBG_FIXED][GBF_NEXT_ERROR], TRUE);
 	gtk_widget_set_sensitive(build_get_menu_items(-1)->menu_item[GBG_FIXED][GBF_PREV_ERROR], TRUE);
+}
 
-	if (utf8_msg != msg)
-		g_free(utf8_msg);
+
+void msgwin_compiler_add_string(gint msg_color, const gchar *msg)
+{
+	GtkTreeIter iter;
+
+	compiler_append(msg_color, msg, NULL, -1, &iter);
+	compiler_added(&iter);
+}
+
+
+/* Adds count messages at once, which is much faster than adding them one by one
+ * because the view is only scrolled once.
+ * filenames and lines are the errors parsed from the messages, which are looked up
+ * when navigating the errors. filenames[i] is NULL if there is no error in msgs[i]. */
+void msgwin_compiler_add_strings(guint count, const gint *msg_colors, const gchar **msgs,
+		const gchar **filenames, const gint *lines)
+{
+	GtkTreeIter iter;
+	guint i;
+
+	if (count == 0)
+		return;
+
+	for (i = 0; i < count; i++)
+		compiler_append(msg_colors[i], msgs[i], filenames[i], lines[i], &iter);
+	compiler_added(&iter);
 }
 
 
@@ -667,7 +833,8 @@ static gboolean goto_compiler_file_line(const gchar *filename, gint line, gboole
 		if (doc == NULL)	/* file not already open */
 			doc = document_open_file(filename, FALSE, NULL, NULL);
 
-		if (doc != NULL)
+		/* the file of a restored session document may not have been read yet */
+		if (doc != NULL && document_load_pending(doc))
 		{
 			gboolean ret;
 
@@ -696,6 +863,16 @@ gboolean msgwin_goto_compiler_file_line(gboolean focus_editor)
 	selection = gtk_tree_view_get_selection(GTK_TREE_VIEW(msgwindow.tree_compiler));
 	if (gtk_tree_selection_get_selected(selection, &model, &iter))
 	{
+		gint error_idx;
+
+		gtk_tree_model_get(model, &iter, 2, &error_idx, -1);
+		if (error_idx >= 0)
+		{
+			CompilerError *error = g_ptr_array_index(compiler_errors.errors, error_idx);
+
+			return goto_compiler_file_line(error->filename, error->line, focus_editor);
+		}
+
 		/* if the item is not coloured red, it's not an error line */
 		gtk_tree_model_get(model, &iter, 0, &color, -1);
 		if (color == NULL || ! gdk_color_equal(color, &color_error))
@@ -730,6 +907,127 @@ gboolean msgwin_goto_compiler_file_line(gboolean focus_editor)
 }
 
 
+/* Returns: the row of the first parsed error at or after target if down, otherwise of the
+ * last one before target, or -1 if there is none. */
+static gint compiler_errors_find_row(gint target, gboolean down, CompilerError **error)
+{
+	guint lo = 0;
+	guint hi = compiler_errors.errors->len;
+
+	*error = NULL;
+	while (lo < hi)
+	{
+		guint mid = (lo + hi) / 2;
+		CompilerError *mid_error = g_ptr_array_index(compiler_errors.errors, mid);
+
+		if (mid_error->row < target)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (down ? lo == compiler_errors.errors->len : lo == 0)
+		return -1;
+	*error = g_ptr_array_index(compiler_errors.errors, down ? lo : lo - 1);
+	return (*error)->row;
+}
+
+
+/* Like compiler_errors_find_row() for the error coloured rows which were not parsed. */
+static gint other_rows_find_row(gint target, gboolean down)
+{
+	GArray *rows = compiler_errors.other_rows;
+	guint lo = 0;
+	guint hi = rows->len;
+
+	while (lo < hi)
+	{
+		guint mid = (lo + hi) / 2;
+
+		if (g_array_index(rows, gint, mid) < target)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (down ? lo == rows->len : lo == 0)
+		return -1;
+	return g_array_index(rows, gint, down ? lo : lo - 1);
+}
+
+
+static void select_compiler_row(GtkTreeView *treeview, gint row)
+{
+	GtkTreePath *path = gtk_tree_path_new_from_indices(row, -1);
+
+	gtk_tree_selection_select_path(gtk_tree_view_get_selection(treeview), path);
+	/* scroll item in view */
+	if (ui_prefs.msgwindow_visible)
+		gtk_tree_view_scroll_to_cell(treeview, path, NULL, TRUE, 0.5, 0.5);
+	gtk_tree_path_free(path);
+}
+
+
+/* Selects the next or previous error after the selected row of the compiler tab and goes
+ * to it.
+ * Returns: FALSE if the compiler tab has rows but no error in that direction. */
+gboolean msgwin_compiler_goto_next_error(gboolean down)
+{
+	GtkTreeView *treeview = GTK_TREE_VIEW(msgwindow.tree_compiler);
+	GtkTreeSelection *selection = gtk_tree_view_get_selection(treeview);
+	GtkTreeModel *model;
+	GtkTreeIter iter;
+	GtkTreePath *path;
+	CompilerError *error;
+	gint row = down ? -1 : compiler_errors.rows;
+
+	if (compiler_errors.errors->len == 0)
+	{
+		/* messages added by plugins can only be recognised by their colour */
+		if (down)
+			return ui_tree_view_find_next(treeview, msgwin_goto_compiler_file_line);
+		else
+			return ui_tree_view_find_previous(treeview, msgwin_goto_compiler_file_line);
+	}
+
+	if (gtk_tree_selection_get_selected(selection, &model, &iter))
+	{
+		path = gtk_tree_model_get_path(model, &iter);
+		row = gtk_tree_path_get_indices(path)[0];
+		gtk_tree_path_free(path);
+	}
+
+	while (TRUE)
+	{
+		gint target = down ? row + 1 : row;
+		gint error_row = compiler_errors_find_row(target, down, &error);
+		/* rows added by plugins are not in the index but can be recognised by their colour */
+		gint other_row = other_rows_find_row(target, down);
+
+		if (error_row == -1 && other_row == -1)
+			return FALSE;	/* no more errors */
+
+		if (other_row == -1 ||
+			(error_row != -1 && (down ? error_row < other_row : error_row > other_row)))
+		{
+			select_compiler_row(treeview, error_row);
+			goto_compiler_file_line(error->filename, error->line, FALSE);
+			return TRUE;
+		}
+		select_compiler_row(treeview, other_row);
+		if (msgwin_goto_compiler_file_line(FALSE))
+			return TRUE;
+		row = other_row;	/* no file name and line could be parsed, try the next one */
+	}
+}
+
+
+/* Removes all rows from the compiler tab. */
+void msgwin_compiler_clear(void)
+{
+	gtk_list_store_clear(msgwindow.store_compiler);
+	compiler_errors_clear();
+}
+
+
 static void make_absolute(gchar **filename, const gchar *dir)
 {
 	guint skip_dot_slash = 0;	/* number of characters to skip at the beginning of the filename */
@@ -785,9 +1083,7 @@ static void parse_file_line(ParseData *data, gchar **filename, gint *line)
 	if (data->file_idx == -1)
 	{
 		/* we have no filename in the error message, so take the current one and hope it's correct */
-		GeanyDocument *doc = document_get_current();
-		if (doc != NULL)
-			*filename = g_strdup(doc->file_name);
+		*filename = g_strdup(data->current_file);
 		g_strfreev(fields);
 		return;
 	}
@@ -797,14 +1093,15 @@ static void parse_file_line(ParseData *data, gchar **filename, gint *line)
 }
 
 
-static void parse_compiler_error_line(const gchar *string,
-		gchar **filename, gint *line)
+static void parse_compiler_error_line(const gchar *string, gint file_type_id,
+		const gchar *current_file, gchar **filename, gint *line)
 {
-	ParseData data = {NULL, NULL, 0, 0, 0};
+	ParseData data = {NULL, NULL, 0, 0, 0, NULL};
 
 	data.string = string;
+	data.current_file = current_file;
 
-	switch (build_info.file_type_id)
+	switch (file_type_id)
 	{
 		case GEANY_FILETYPES_PHP:
 		{
@@ -946,7 +1243,7 @@ static void parse_compiler_error_line(const gchar *string,
 		case GEANY_FILETYPES_NONE:
 		default:	/* The default is a GNU gcc type error */
 		{
-			if (build_info.file_type_id == GEANY_FILETYPES_JAVA &&
+			if (file_type_id == GEANY_FILETYPES_JAVA &&
 				strncmp(string, "[javac]", 7) == 0)
 			{
 				/* Java Apache Ant.
@@ -982,8 +1279,7 @@ static void parse_compiler_error_line(const gchar *string,
 void msgwin_parse_compiler_error_line(const gchar *string, const gchar *dir,
 		gchar **filename, gint *line)
 {
-	GeanyFiletype *ft;
-	gchar *trimmed_string;
+	GeanyDocument *doc = document_get_current();
 
 	*filename = NULL;
 	*line = -1;
@@ -995,16 +1291,38 @@ void msgwin_parse_compiler_error_line(const gchar *string, const gchar *dir,
 		dir = build_info.dir;
 	g_return_if_fail(dir != NULL);
 
+	msgwin_parse_compiler_error_line_full(string, dir, build_info.file_type_id,
+		filetypes_get_error_regex(filetypes[build_info.file_type_id]),
+		doc != NULL ? doc->file_name : NULL, filename, line);
+}
+
+
+/* Same as msgwin_parse_compiler_error_line(), but with everything it would look up
+ * passed in, so that it can be used from another thread:
+ * error_regex is from filetypes_get_error_regex() or NULL and current_file is the file
+ * name to use for messages without one, or NULL. */
+void msgwin_parse_compiler_error_line_full(const gchar *string, const gchar *dir,
+		gint file_type_id, GRegex *error_regex, const gchar *current_file,
+		gchar **filename, gint *line)
+{
+	gchar *trimmed_string;
+
+	*filename = NULL;
+	*line = -1;
+
+	if (G_UNLIKELY(string == NULL))
+		return;
+	g_return_if_fail(dir != NULL);
+
 	trimmed_string = g_strdup(string);
 	g_strchug(trimmed_string); /* remove possible leading whitespace */
 
-	ft = filetypes[build_info.file_type_id];
-
 	/* try parsing with a custom regex */
-	if (!filetypes_parse_error_message(ft, trimmed_string, filename, line))
+	if (error_regex == NULL ||
+		!filetypes_match_error_regex(error_regex, trimmed_string, filename, line))
 	{
 		/* fallback to default old-style parsing */
-		parse_compiler_error_line(trimmed_string, filename, line);
+		parse_compiler_error_line(trimmed_string, file_type_id, current_file, filename, line);
 	}
 	make_absolute(filename, dir);
 	g_free(trimmed_string);
@@ -1211,7 +1529,7 @@ void msgwin_clear_tab(gint tabnum)
 			break;
 
 		case MSG_COMPILER:
-			gtk_list_store_clear(msgwindow.store_compiler);
+			msgwin_compiler_clear();
 			build_menu_update(NULL);	/* update next error items */
 			return;
 
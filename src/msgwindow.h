@@ -86,6 +86,15 @@ void msgwin_compiler_add(gint msg_color, const gchar *format, ...) G_GNUC_PRINTF
 
 void msgwin_compiler_add_string(gint msg_color, const gchar *msg);
 
+void msgwin_compiler_add_strings(guint count, const gint *msg_colors, const gchar **msgs,
+		const gchar **filenames, const gint *lines);
+
+void msgwin_compiler_clear(void);
+
+gboolean msgwin_compiler_goto_next_error(gboolean down);
+
+guint msgwin_compiler_get_error_lines(const gchar *real_path, const gint **lines);
+
 void msgwin_status_add(const gchar *format, ...) G_GNUC_PRINTF (1, 2);
 
 void msgwin_show_hide_tabs(void);
@@ -100,6 +109,10 @@ gboolean msgwin_goto_compiler_file_line(gboolean focus_editor);
 void msgwin_parse_compiler_error_line(const gchar *string, const gchar *dir,
 									  gchar **filename, gint *line);
 
+void msgwin_parse_compiler_error_line_full(const gchar *string, const gchar *dir,
+		gint file_type_id, GRegex *error_regex, const gchar *current_file,
+		gchar **filename, gint *line);
+
 gboolean msgwin_goto_messages_file_line(gboolean focus_editor);
 
 G_END_DECLS
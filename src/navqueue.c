@@ -153,6 +153,10 @@ gboolean navqueue_goto_line(GeanyDocument *old_doc, GeanyDocument *new_doc, gint
 	g_return_val_if_fail(new_doc != NULL, FALSE);
 	g_return_val_if_fail(line >= 1, FALSE);
 
+	/* read the file of a restored session document before looking up the line */
+	if (! document_load_pending(new_doc))
+		return FALSE;
+
 	pos = sci_get_position_from_line(new_doc->editor->sci, line - 1);
 
 	/* first add old file position */
@@ -177,7 +181,7 @@ static gboolean goto_file_pos(const gchar *file, gint pos)
 {
 	GeanyDocument *doc = document_find_by_filename(file);
 
-	if (doc == NULL)
+	if (doc == NULL || ! document_load_pending(doc))
 		return FALSE;
 
 	return editor_goto_pos(doc->editor, pos, TRUE);
@@ -59,6 +59,7 @@
 #include "win32.h"
 #include "pluginutils.h"
 #include "pluginprivate.h"
+#include "profile.h"
 
 
 GList *active_plugin_list = NULL; /* list of only actually loaded plugins, always valid */
@@ -919,8 +920,10 @@ load_active_plugins(void)
 
 		if (NZV(fname) && g_file_test(fname, G_FILE_TEST_EXISTS))
 		{
+			profile_begin("plugin", fname);
 			if (!check_plugin_path(fname) || plugin_new(fname, TRUE, FALSE) == NULL)
 				failed_plugins_list = g_list_prepend(failed_plugins_list, g_strdup(fname));
+			profile_end();
 		}
 	}
 }
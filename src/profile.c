@@ -0,0 +1,648 @@
+/*
+ *      profile.c - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2012 Enrico Tröger <enrico(dot)troeger(at)uvena(dot)de>
+ *      Copyright 2012 Nick Treleaven <nick(dot)treleaven(at)btinternet(dot)com>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Performance measurements.
+ *
+ * Startup profiling is enabled with the --profile-startup command line option.
+ * Startup is divided into phases, which can contain nested spans e.g. for loading a plugin
+ * or opening a document, and instant marks. When startup is complete, the times are printed
+ * as a report or written to a file in the Chrome trace event format, which can be viewed
+ * with chrome://tracing.
+ *
+ * Runtime counters sum up the calls and time of hot paths, measured with a ProfileTimer.
+ * They are only recorded while enabled in the Help->Performance dialog, which shows them
+ * and can save the most recent calls as a trace.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "geany.h"
+#include "profile.h"
+#include "support.h"
+#include "ui_utils.h"
+#include "utils.h"
+
+
+/* number of the most recent timed calls kept for saving a trace */
+#define TRACE_EVENTS_MAX 16384
+
+enum
+{
+	DIALOG_RESPONSE_RESET = 1,
+	DIALOG_RESPONSE_SAVE_TRACE
+};
+
+enum
+{
+	COUNTER_COLUMN_NAME,
+	COUNTER_COLUMN_CALLS,
+	COUNTER_COLUMN_TOTAL,
+	COUNTER_COLUMN_AVERAGE,
+	COUNTER_COLUMN_MAX,
+	COUNTER_N_COLUMNS
+};
+
+
+typedef struct ProfileSpan
+{
+	const gchar *category;	/* a static string */
+	gchar *name;
+	gdouble start;			/* seconds since profile_start() */
+	gdouble end;
+	gint depth;
+	gboolean mark;
+}
+ProfileSpan;
+
+typedef struct CounterStats
+{
+	guint calls;
+	gdouble total;
+	gdouble max;
+}
+CounterStats;
+
+typedef struct TraceEvent
+{
+	ProfileCounter counter;
+	gdouble start;
+	gdouble duration;
+}
+TraceEvent;
+
+static struct
+{
+	gboolean enabled;
+	gchar *trace_file;	/* NULL to print a report */
+	GTimer *timer;
+	GArray *spans;		/* ProfileSpan, in start order */
+	GArray *open;		/* indexes of the open spans, innermost last */
+}
+profile = {FALSE, NULL, NULL, NULL, NULL};
+
+static struct
+{
+	gboolean recording;
+	guint epoch;			/* incremented each time recording is turned on */
+	GTimer *timer;
+	CounterStats stats[PROFILE_COUNTER_COUNT];
+	TraceEvent *events;		/* ring buffer of TRACE_EVENTS_MAX events */
+	guint events_head;		/* index of the next event to write */
+	guint events_len;
+	GtkWidget *dialog;		/* the Performance dialog, if shown */
+	GtkListStore *store;
+	guint update_source;
+}
+counters;
+
+static const gchar *counter_names[PROFILE_COUNTER_COUNT] =
+{
+	"document_update_tags",
+	"tm_workspace_recreate_tags_array",
+	"symbols_recreate_tag_list",
+	"editor_sci_notify_cb",
+	"Scintilla paint",
+	"Scintilla colourise",
+	"search_find_text",
+	"build_iofunc",
+	"build output records"
+};
+
+
+/* Starts recording startup times. If trace_file is NULL, a report is printed by
+ * profile_finish(), otherwise a trace is written to trace_file. */
+void profile_start(const gchar *trace_file)
+{
+	if (profile.enabled)
+		return;
+
+	profile.enabled = TRUE;
+	profile.trace_file = g_strdup(trace_file);
+	profile.timer = g_timer_new();
+	profile.spans = g_array_new(FALSE, FALSE, sizeof(ProfileSpan));
+	profile.open = g_array_new(FALSE, FALSE, sizeof(guint));
+}
+
+
+gboolean profile_is_enabled(void)
+{
+	return profile.enabled;
+}
+
+
+static ProfileSpan *add_span(const gchar *category, const gchar *name)
+{
+	ProfileSpan span;
+
+	span.category = category;
+	span.name = g_strdup(name);
+	span.start = g_timer_elapsed(profile.timer, NULL);
+	span.end = span.start;
+	span.depth = profile.open->len;
+	span.mark = FALSE;
+	g_array_append_val(profile.spans, span);
+	return &g_array_index(profile.spans, ProfileSpan, profile.spans->len - 1);
+}
+
+
+/* Starts a span which ends with the matching profile_end() call. */
+void profile_begin(const gchar *category, const gchar *name)
+{
+	guint index;
+
+	if (! profile.enabled)
+		return;
+
+	add_span(category, name);
+	index = profile.spans->len - 1;
+	g_array_append_val(profile.open, index);
+}
+
+
+void profile_end(void)
+{
+	guint index;
+
+	if (! profile.enabled || profile.open->len == 0)
+		return;
+
+	index = g_array_index(profile.open, guint, profile.open->len - 1);
+	g_array_index(profile.spans, ProfileSpan, index).end = g_timer_elapsed(profile.timer, NULL);
+	g_array_set_size(profile.open, profile.open->len - 1);
+}
+
+
+/* Ends the current phase and any spans left open in it, and starts the next phase. */
+void profile_phase(const gchar *name)
+{
+	if (! profile.enabled)
+		return;
+
+	while (profile.open->len > 0)
+		profile_end();
+	profile_begin("phase", name);
+}
+
+
+/* Records an instant event, e.g. the first paint of the main window. */
+void profile_mark(const gchar *category, const gchar *name)
+{
+	if (! profile.enabled)
+		return;
+
+	add_span(category, name)->mark = TRUE;
+}
+
+
+static void print_report(gdouble total)
+{
+	GHashTable *totals = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+	GList *categories = NULL, *node;
+	guint i;
+
+	printf("Startup profile (times in milliseconds)\n");
+	printf("%10s %10s\n", "start", "duration");
+	for (i = 0; i < profile.spans->len; i++)
+	{
+		ProfileSpan *span = &g_array_index(profile.spans, ProfileSpan, i);
+		gdouble *sum;
+
+		if (span->mark)
+		{
+			printf("%10.3f %10s  %*s%s: %s\n", span->start * 1000, "",
+				span->depth * 2, "", span->category, span->name);
+			continue;
+		}
+		printf("%10.3f %10.3f  %*s%s: %s\n", span->start * 1000,
+			(span->end - span->start) * 1000, span->depth * 2, "", span->category, span->name);
+
+		sum = g_hash_table_lookup(totals, span->category);
+		if (sum == NULL)
+		{
+			sum = g_new0(gdouble, 2);
+			g_hash_table_insert(totals, (gpointer) span->category, sum);
+			categories = g_list_append(categories, (gpointer) span->category);
+		}
+		sum[0] += 1;
+		sum[1] += span->end - span->start;
+	}
+
+	printf("\n%-12s %6s %10s\n", "category", "count", "total");
+	for (node = categories; node != NULL; node = node->next)
+	{
+		gdouble *sum = g_hash_table_lookup(totals, node->data);
+
+		printf("%-12s %6d %10.3f\n", (const gchar *) node->data, (gint) sum[0], sum[1] * 1000);
+	}
+	printf("\nStartup took %.3f ms.\n", total * 1000);
+
+	g_list_free(categories);
+	g_hash_table_destroy(totals);
+}
+
+
+static void append_json_string(GString *str, const gchar *text)
+{
+	const gchar *c;
+
+	g_string_append_c(str, '"');
+	for (c = text; *c != 0; c++)
+	{
+		if (*c == '"' || *c == '\\')
+			g_string_append_printf(str, "\\%c", *c);
+		else if ((guchar) *c < 0x20)
+			g_string_append_printf(str, "\\u%04x", (guchar) *c);
+		else
+			g_string_append_c(str, *c);
+	}
+	g_string_append_c(str, '"');
+}
+
+
+/* Appends seconds in microseconds, always with a '.' decimal separator. */
+static void append_json_time(GString *str, const gchar *key, gdouble seconds)
+{
+	gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+	g_string_append_printf(str, ",\"%s\":%s", key,
+		g_ascii_formatd(buf, sizeof(buf), "%.3f", seconds * 1e6));
+}
+
+
+/* Appends a trace event; a mark if duration is negative. */
+static void append_trace_event(GString *str, const gchar *name, const gchar *category,
+		gdouble start, gdouble duration)
+{
+	if (str->str[str->len - 1] == '}')
+		g_string_append(str, ",\n");
+
+	g_string_append(str, "{\"name\":");
+	append_json_string(str, name);
+	g_string_append(str, ",\"cat\":");
+	append_json_string(str, category);
+	if (duration < 0)
+	{
+		g_string_append(str, ",\"ph\":\"i\",\"s\":\"g\"");
+		append_json_time(str, "ts", start);
+	}
+	else
+	{
+		g_string_append(str, ",\"ph\":\"X\"");
+		append_json_time(str, "ts", start);
+		append_json_time(str, "dur", duration);
+	}
+	g_string_append(str, ",\"pid\":1,\"tid\":1}");
+}
+
+
+static GString *trace_new(void)
+{
+	return g_string_new("{\"traceEvents\":[\n");
+}
+
+
+static gboolean trace_write(GString *str, const gchar *filename, GError **error)
+{
+	gboolean ret;
+
+	g_string_append(str, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	ret = g_file_set_contents(filename, str->str, str->len, error);
+	g_string_free(str, TRUE);
+	return ret;
+}
+
+
+static void write_startup_trace(void)
+{
+	GString *str = trace_new();
+	GError *error = NULL;
+	guint i;
+
+	for (i = 0; i < profile.spans->len; i++)
+	{
+		ProfileSpan *span = &g_array_index(profile.spans, ProfileSpan, i);
+
+		append_trace_event(str, span->name, span->category, span->start,
+			span->mark ? -1 : span->end - span->start);
+	}
+	if (! trace_write(str, profile.trace_file, &error))
+	{
+		g_printerr("Geany: could not write the startup trace to %s (%s)\n",
+			profile.trace_file, error->message);
+		g_error_free(error);
+	}
+}
+
+
+/* Ends recording, and prints the report or writes the trace file. */
+void profile_finish(void)
+{
+	gdouble total;
+	guint i;
+
+	if (! profile.enabled)
+		return;
+
+	while (profile.open->len > 0)
+		profile_end();
+	total = g_timer_elapsed(profile.timer, NULL);
+
+	if (profile.trace_file != NULL)
+		write_startup_trace();
+	else
+		print_report(total);
+
+	for (i = 0; i < profile.spans->len; i++)
+		g_free(g_array_index(profile.spans, ProfileSpan, i).name);
+	g_array_free(profile.spans, TRUE);
+	g_array_free(profile.open, TRUE);
+	g_timer_destroy(profile.timer);
+	g_free(profile.trace_file);
+	memset(&profile, 0, sizeof(profile));
+}
+
+
+gboolean profile_is_recording(void)
+{
+	return counters.recording;
+}
+
+
+void profile_set_recording(gboolean record)
+{
+	if (record && counters.timer == NULL)
+	{
+		counters.timer = g_timer_new();
+		counters.events = g_new(TraceEvent, TRACE_EVENTS_MAX);
+	}
+	if (record && ! counters.recording)
+		counters.epoch++;
+	counters.recording = record;
+}
+
+
+/* Starts timing a call to add to counter. Recording may be off, then the timer is ignored. */
+void profile_timer_start(ProfileTimer *timer, ProfileCounter counter)
+{
+	timer->counter = counter;
+	timer->epoch = counters.epoch;
+	timer->start = counters.recording ? g_timer_elapsed(counters.timer, NULL) : -1;
+}
+
+
+void profile_timer_stop(ProfileTimer *timer)
+{
+	CounterStats *stats;
+	TraceEvent *event;
+	gdouble duration;
+
+	/* also ignore timers started before recording was turned off and on */
+	if (timer->start < 0 || ! counters.recording || timer->epoch != counters.epoch)
+		return;
+
+	duration = g_timer_elapsed(counters.timer, NULL) - timer->start;
+	stats = &counters.stats[timer->counter];
+	stats->calls++;
+	stats->total += duration;
+	if (duration > stats->max)
+		stats->max = duration;
+
+	event = &counters.events[counters.events_head];
+	event->counter = timer->counter;
+	event->start = timer->start;
+	event->duration = duration;
+	counters.events_head = (counters.events_head + 1) % TRACE_EVENTS_MAX;
+	if (counters.events_len < TRACE_EVENTS_MAX)
+		counters.events_len++;
+}
+
+
+static void reset_counters(void)
+{
+	memset(counters.stats, 0, sizeof(counters.stats));
+	counters.events_head = 0;
+	counters.events_len = 0;
+}
+
+
+/* Writes the most recent timed calls to filename in the Chrome trace event format. */
+gboolean profile_write_trace(const gchar *filename, GError **error)
+{
+	GString *str = trace_new();
+	guint i, first;
+
+	first = (counters.events_head + TRACE_EVENTS_MAX - counters.events_len) % TRACE_EVENTS_MAX;
+	for (i = 0; i < counters.events_len; i++)
+	{
+		TraceEvent *event = &counters.events[(first + i) % TRACE_EVENTS_MAX];
+
+		append_trace_event(str, counter_names[event->counter], "runtime",
+			event->start, event->duration);
+	}
+	return trace_write(str, filename, error);
+}
+
+
+static void update_dialog(void)
+{
+	GtkTreeIter iter;
+	gint i;
+
+	if (counters.store == NULL)
+		return;
+
+	gtk_list_store_clear(counters.store);
+	for (i = 0; i < PROFILE_COUNTER_COUNT; i++)
+	{
+		CounterStats *stats = &counters.stats[i];
+
+		gtk_list_store_append(counters.store, &iter);
+		gtk_list_store_set(counters.store, &iter,
+			COUNTER_COLUMN_NAME, counter_names[i],
+			COUNTER_COLUMN_CALLS, stats->calls,
+			COUNTER_COLUMN_TOTAL, stats->total * 1000,
+			COUNTER_COLUMN_AVERAGE, stats->calls ? stats->total * 1000 / stats->calls : 0.0,
+			COUNTER_COLUMN_MAX, stats->max * 1000,
+			-1);
+	}
+}
+
+
+static gboolean on_update_timeout(gpointer data)
+{
+	update_dialog();
+	return TRUE;
+}
+
+
+static void save_trace(GtkWindow *parent)
+{
+	GtkWidget *dialog;
+
+	dialog = gtk_file_chooser_dialog_new(_("Save Trace"), parent,
+				GTK_FILE_CHOOSER_ACTION_SAVE,
+				GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
+				GTK_STOCK_SAVE, GTK_RESPONSE_ACCEPT, NULL);
+	gtk_file_chooser_set_do_overwrite_confirmation(GTK_FILE_CHOOSER(dialog), TRUE);
+	gtk_file_chooser_set_current_name(GTK_FILE_CHOOSER(dialog), "geany-trace.json");
+
+	if (gtk_dialog_run(GTK_DIALOG(dialog)) == GTK_RESPONSE_ACCEPT)
+	{
+		gchar *filename = gtk_file_chooser_get_filename(GTK_FILE_CHOOSER(dialog));
+		GError *error = NULL;
+
+		if (! profile_write_trace(filename, &error))
+		{
+			ui_set_statusbar(TRUE, _("Could not save the trace (%s)."), error->message);
+			g_error_free(error);
+		}
+		g_free(filename);
+	}
+	gtk_widget_destroy(dialog);
+}
+
+
+static void on_dialog_response(GtkDialog *dialog, gint response, gpointer user_data)
+{
+	switch (response)
+	{
+		case DIALOG_RESPONSE_RESET:
+			reset_counters();
+			update_dialog();
+			break;
+
+		case DIALOG_RESPONSE_SAVE_TRACE:
+			save_trace(GTK_WINDOW(dialog));
+			break;
+
+		default:
+			gtk_widget_destroy(GTK_WIDGET(dialog));
+	}
+}
+
+
+static void on_dialog_destroy(GtkWidget *widget, gpointer user_data)
+{
+	g_source_remove(counters.update_source);
+	counters.update_source = 0;
+	counters.dialog = NULL;
+	counters.store = NULL;
+}
+
+
+static void on_record_toggled(GtkToggleButton *button, gpointer user_data)
+{
+	profile_set_recording(gtk_toggle_button_get_active(button));
+}
+
+
+static void time_cell_data_func(GtkTreeViewColumn *col, GtkCellRenderer *renderer,
+		GtkTreeModel *model, GtkTreeIter *iter, gpointer data)
+{
+	gdouble value;
+	gchar *text;
+
+	gtk_tree_model_get(model, iter, GPOINTER_TO_INT(data), &value, -1);
+	text = g_strdup_printf("%.3f", value);
+	g_object_set(renderer, "text", text, NULL);
+	g_free(text);
+}
+
+
+static void add_column(GtkWidget *tree, const gchar *title, gint column)
+{
+	GtkCellRenderer *renderer = gtk_cell_renderer_text_new();
+	GtkTreeViewColumn *col = gtk_tree_view_column_new();
+
+	gtk_tree_view_column_set_title(col, title);
+	gtk_tree_view_column_pack_start(col, renderer, TRUE);
+	if (column == COUNTER_COLUMN_NAME)
+		gtk_tree_view_column_add_attribute(col, renderer, "text", column);
+	else
+	{
+		g_object_set(renderer, "xalign", 1.0, NULL);
+		if (column == COUNTER_COLUMN_CALLS)
+			gtk_tree_view_column_add_attribute(col, renderer, "text", column);
+		else
+			gtk_tree_view_column_set_cell_data_func(col, renderer, time_cell_data_func,
+				GINT_TO_POINTER(column), NULL);
+	}
+	gtk_tree_view_column_set_sort_column_id(col, column);
+	gtk_tree_view_append_column(GTK_TREE_VIEW(tree), col);
+}
+
+
+void profile_show_dialog(void)
+{
+	GtkWidget *dialog, *vbox, *swin, *tree, *check;
+
+	if (counters.dialog != NULL)
+	{
+		gtk_window_present(GTK_WINDOW(counters.dialog));
+		return;
+	}
+
+	dialog = gtk_dialog_new_with_buttons(_("Performance"), GTK_WINDOW(main_widgets.window),
+				GTK_DIALOG_DESTROY_WITH_PARENT,
+				_("_Reset"), DIALOG_RESPONSE_RESET,
+				_("_Save Trace"), DIALOG_RESPONSE_SAVE_TRACE,
+				GTK_STOCK_CLOSE, GTK_RESPONSE_CLOSE, NULL);
+	vbox = ui_dialog_vbox_new(GTK_DIALOG(dialog));
+	gtk_box_set_spacing(GTK_BOX(vbox), 6);
+	gtk_widget_set_name(dialog, "GeanyDialog");
+
+	gtk_window_set_default_size(GTK_WINDOW(dialog), 550, 300);
+	gtk_dialog_set_default_response(GTK_DIALOG(dialog), GTK_RESPONSE_CLOSE);
+
+	check = gtk_check_button_new_with_mnemonic(_("Record _timings"));
+	gtk_widget_set_tooltip_text(check,
+		_("Measure the number of calls and the time taken by frequently used functions"));
+	gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(check), counters.recording);
+	g_signal_connect(check, "toggled", G_CALLBACK(on_record_toggled), NULL);
+	gtk_box_pack_start(GTK_BOX(vbox), check, FALSE, FALSE, 0);
+
+	counters.store = gtk_list_store_new(COUNTER_N_COLUMNS, G_TYPE_STRING, G_TYPE_UINT,
+		G_TYPE_DOUBLE, G_TYPE_DOUBLE, G_TYPE_DOUBLE);
+	tree = gtk_tree_view_new_with_model(GTK_TREE_MODEL(counters.store));
+	g_object_unref(counters.store);
+	add_column(tree, _("Name"), COUNTER_COLUMN_NAME);
+	add_column(tree, _("Calls"), COUNTER_COLUMN_CALLS);
+	add_column(tree, _("Total (ms)"), COUNTER_COLUMN_TOTAL);
+	add_column(tree, _("Average (ms)"), COUNTER_COLUMN_AVERAGE);
+	add_column(tree, _("Maximum (ms)"), COUNTER_COLUMN_MAX);
+
+	swin = gtk_scrolled_window_new(NULL, NULL);
+	gtk_scrolled_window_set_policy(GTK_SCROLLED_WINDOW(swin),
+		GTK_POLICY_AUTOMATIC, GTK_POLICY_AUTOMATIC);
+	gtk_scrolled_window_set_shadow_type(GTK_SCROLLED_WINDOW(swin), GTK_SHADOW_IN);
+	gtk_container_add(GTK_CONTAINER(swin), tree);
+	gtk_box_pack_start(GTK_BOX(vbox), swin, TRUE, TRUE, 0);
+
+	update_dialog();
+	counters.update_source = g_timeout_add_seconds(1, on_update_timeout, NULL);
+
+	g_signal_connect(dialog, "response", G_CALLBACK(on_dialog_response), NULL);
+	g_signal_connect(dialog, "destroy", G_CALLBACK(on_dialog_destroy), NULL);
+	gtk_widget_show_all(dialog);
+	counters.dialog = dialog;
+}
@@ -0,0 +1,81 @@
+/*
+ *      profile.h - this file is part of Geany, a fast and lightweight IDE
+ *
+ *      Copyright 2012 Enrico Tröger <enrico(dot)troeger(at)uvena(dot)de>
+ *      Copyright 2012 Nick Treleaven <nick(dot)treleaven(at)btinternet(dot)com>
+ *
+ *      This program is free software; you can redistribute it and/or modify
+ *      it under the terms of the GNU General Public License as published by
+ *      the Free Software Foundation; either version 2 of the License, or
+ *      (at your option) any later version.
+ *
+ *      This program is distributed in the hope that it will be useful,
+ *      but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *      GNU General Public License for more details.
+ *
+ *      You should have received a copy of the GNU General Public License along
+ *      with this program; if not, write to the Free Software Foundation, Inc.,
+ *      51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef GEANY_PROFILE_H
+#define GEANY_PROFILE_H 1
+
+
+void profile_start(const gchar *trace_file);
+
+void profile_finish(void);
+
+gboolean profile_is_enabled(void);
+
+
+void profile_phase(const gchar *name);
+
+void profile_begin(const gchar *category, const gchar *name);
+
+void profile_end(void);
+
+void profile_mark(const gchar *category, const gchar *name);
+
+
+/* Counters for the time taken by hot paths */
+typedef enum
+{
+	PROFILE_DOCUMENT_UPDATE_TAGS,
+	PROFILE_WORKSPACE_RECREATE_TAGS,
+	PROFILE_SYMBOLS_TAG_LIST,
+	PROFILE_EDITOR_NOTIFY,
+	PROFILE_SCI_PAINT,
+	PROFILE_SCI_COLOURISE,
+	PROFILE_SEARCH_FIND_TEXT,
+	PROFILE_BUILD_READ,
+	PROFILE_BUILD_RECORDS,
+	PROFILE_COUNTER_COUNT
+}
+ProfileCounter;
+
+typedef struct ProfileTimer
+{
+	ProfileCounter counter;
+	gdouble start;	/* negative if recording was off when the timer was started */
+	guint epoch;	/* recording epoch when the timer was started */
+}
+ProfileTimer;
+
+
+gboolean profile_is_recording(void);
+
+void profile_set_recording(gboolean record);
+
+void profile_timer_start(ProfileTimer *timer, ProfileCounter counter);
+
+void profile_timer_stop(ProfileTimer *timer);
+
+gboolean profile_write_trace(const gchar *filename, GError **error);
+
+void profile_show_dialog(void);
+
+
+#endif
@@ -37,6 +37,7 @@
 
 #include "sciwrappers.h"
 #include "utils.h"
+#include "profile.h"
 
 #define SSM(s, m, w, l) scintilla_send_message(s, m, w, l)
 
@@ -700,7 +701,11 @@ gboolean sci_get_fold_expanded(ScintillaObject *sci, gint line)
 
 void sci_colourise(ScintillaObject *sci, gint start, gint end)
 {
+	ProfileTimer timer;
+
+	profile_timer_start(&timer, PROFILE_SCI_COLOURISE);
 	SSM(sci, SCI_COLOURISE, (uptr_t) start, end);
+	profile_timer_stop(&timer);
 }
 
 
@@ -1273,3 +1278,25 @@ void sci_move_selected_lines_up(ScintillaObject *sci)
 {
 	SSM(sci, SCI_MOVESELECTEDLINESUP, 0, 0);
 }
+
+
+/* Approximate number of bytes Scintilla uses to hold the styles of the document. */
+gint sci_get_style_memory(ScintillaObject *sci)
+{
+	return (gint) SSM(sci, SCI_GETSTYLEMEMORY, 0, 0);
+}
+
+
+/* Returns the text of the document as it is now. It does not change when the document
+ * is edited and can be read from other threads until released with sci_release_snapshot(),
+ * which must be called from the main thread. */
+struct Sci_TextSnapshot *sci_create_snapshot(ScintillaObject *sci)
+{
+	return (struct Sci_TextSnapshot *) SSM(sci, SCI_CREATESNAPSHOT, 0, 0);
+}
+
+
+void sci_release_snapshot(ScintillaObject *sci, struct Sci_TextSnapshot *snapshot)
+{
+	SSM(sci, SCI_RELEASESNAPSHOT, 0, (sptr_t) snapshot);
+}
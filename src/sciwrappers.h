@@ -187,4 +187,9 @@ gint				sci_text_width				(ScintillaObject *sci, gint styleNumber, const gchar *
 void				sci_move_selected_lines_down    (ScintillaObject *sci);
 void				sci_move_selected_lines_up      (ScintillaObject *sci);
 
+gint				sci_get_style_memory		(ScintillaObject *sci);
+
+struct Sci_TextSnapshot *sci_create_snapshot	(ScintillaObject *sci);
+void				sci_release_snapshot		(ScintillaObject *sci, struct Sci_TextSnapshot *snapshot);
+
 #endif
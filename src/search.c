@@ -41,6 +41,7 @@
 #include "keyfile.h"
 #include "stash.h"
 #include "toolbar.h"
+#include "profile.h"
 #include "gtkcompat.h"
 
 #include <unistd.h>
@@ -1384,6 +1385,8 @@ static void replace_in_session(GeanyDocument *doc,
 		GeanyDocument *tmp_doc = document_get_from_page(n);
 		gint reps = 0;
 
+		if (! document_load_pending(tmp_doc))
+			continue;
 		reps = document_replace_all(tmp_doc, find, replace, original_find, original_replace, search_flags_re);
 		rep_count += reps;
 		if (reps)
@@ -1940,14 +1943,16 @@ static gchar *get_regex_match_string(const gchar *text, const GeanyMatchInfo *ma
 
 static gint find_regex(ScintillaObject *sci, guint pos, GRegex *regex, GeanyMatchInfo *match)
 {
+	struct Sci_TextSnapshot *snapshot;
 	const gchar *text;
 	GMatchInfo *minfo;
 	gint ret = -1;
 
 	g_return_val_if_fail(pos <= (guint)sci_get_length(sci), -1);
 
-	/* Warning: any SCI calls will invalidate 'text' after calling SCI_GETCHARACTERPOINTER */
-	text = (void*)scintilla_send_message(sci, SCI_GETCHARACTERPOINTER, 0, 0);
+	/* the snapshot keeps 'text' unchanged until it is released */
+	snapshot = sci_create_snapshot(sci);
+	text = snapshot->text;
 
 	/* Warning: minfo will become invalid when 'text' does! */
 	if (g_regex_match_full(regex, text, -1, pos, 0, &minfo, NULL))
@@ -1970,6 +1975,7 @@ static gint find_regex(ScintillaObject *sci, guint pos, GRegex *regex, GeanyMatc
 		ret = match->start;
 	}
 	g_match_info_free(minfo);
+	sci_release_snapshot(sci, snapshot);
 	return ret;
 }
 
@@ -2077,10 +2083,13 @@ gint search_find_text(ScintillaObject *sci, gint flags, struct Sci_TextToFind *t
 	GeanyMatchInfo *match = NULL;
 	GRegex *regex;
 	gint ret;
+	ProfileTimer timer;
 
 	if (~flags & SCFIND_REGEXP)
 	{
+		profile_timer_start(&timer, PROFILE_SEARCH_FIND_TEXT);
 		ret = sci_find_text(sci, flags, ttf);
+		profile_timer_stop(&timer);
 		if (ret != -1 && match_)
 			*match_ = match_info_new(flags, ttf->chrgText.cpMin, ttf->chrgText.cpMax);
 		return ret;
@@ -2092,7 +2101,9 @@ gint search_find_text(ScintillaObject *sci, gint flags, struct Sci_TextToFind *t
 
 	match = match_info_new(flags, 0, 0);
 
+	profile_timer_start(&timer, PROFILE_SEARCH_FIND_TEXT);
 	ret = find_regex(sci, ttf->chrg.cpMin, regex, match);
+	profile_timer_stop(&timer);
 	if (ret >= ttf->chrg.cpMax)
 		ret = -1;
 	else if (ret >= 0)
@@ -2178,7 +2189,7 @@ void search_find_usage(const gchar *search_text, const gchar *original_search_te
 		guint i;
 		for (i = 0; i < documents_array->len; i++)
 		{
-			if (documents[i]->is_valid)
+			if (documents[i]->is_valid && document_load_pending(documents[i]))
 			{
 				count += find_document_usage(documents[i], search_text, flags);
 			}
@@ -40,7 +40,15 @@
  * The command window is only available on Windows and takes no additional data, instead it
  * writes back a Windows handle (HWND) for the main window to set it to the foreground (focus).
  *
- * At the moment the commands window, doclist, open, openro, line and column are available.
+ * At the moment the commands window, doclist, open, openro, line, column and batchopen
+ * are available.
+ *
+ * The batchopen command is not followed by lines but by a binary message with all the
+ * files to open, see send_open_request(). The receiver answers with a status as soon as
+ * it has read the message, so the sending instance can exit before the files are opened.
+ * Clients start with batchopen and fall back to open if there is no answer, which
+ * happens when the running instance is an older version (which ignores unknown commands,
+ * so the name must not start with the name of another command).
  *
  * About the socket files on Unix-like systems:
  * Geany creates a socket in /tmp (or any other directory returned by g_get_tmp_dir()) and
@@ -96,8 +104,18 @@
 #define SOCKET_IS_VALID(s)	((s) >= 0)
 #define INVALID_SOCKET		(-1)
 #endif
+#ifndef SHUT_WR
+#define SHUT_WR				SD_SEND
+#endif
 #define BUFFER_LENGTH 4096
 
+/* Version of the message sent after batchopen, a receiver doesn't answer other versions */
+#define OPEN_REQUEST_VERSION	1
+#define OPEN_REQUEST_READONLY	(1 << 0)
+/* Limits to reject corrupt messages */
+#define OPEN_REQUEST_MAX_FILES	65536
+#define OPEN_REQUEST_MAX_LENGTH	65536
+
 struct socket_info_struct socket_info;
 
 
@@ -115,6 +133,7 @@ static gint socket_fd_write_all		(gint sock, const gchar *buf, gint len);
 static gint socket_fd_gets			(gint sock, gchar *buf, gint len);
 static gint socket_fd_check_io		(gint fd, GIOCondition cond);
 static gint socket_fd_read			(gint sock, gchar *buf, gint len);
+static gint socket_fd_read_all		(gint sock, gchar *buf, gint len);
 static gint socket_fd_recv			(gint fd, gchar *buf, gint len, gint flags);
 static gint socket_fd_close			(gint sock);
 
@@ -126,7 +145,6 @@ static void send_open_command(gint sock, gint argc, gchar **argv)
 	gchar *filename;
 
 	g_return_if_fail(argc > 1);
-	geany_debug("using running instance of Geany");
 
 	if (cl_options.goto_line >= 0)
 	{
@@ -172,6 +190,103 @@ static void send_open_command(gint sock, gint argc, gchar **argv)
 }
 
 
+static void append_uint32(GString *buffer, guint32 value)
+{
+	value = g_htonl(value);
+	g_string_append_len(buffer, (const gchar *) &value, sizeof(value));
+}
+
+
+static void append_string(GString *buffer, const gchar *str)
+{
+	gsize len = strlen(str);
+
+	append_uint32(buffer, len);
+	g_string_append_len(buffer, str, len);
+}
+
+
+/* Prints the document list sent by the running instance after a doclist command. */
+static void print_document_list(gint sock)
+{
+	GString *doc_list = g_string_new(NULL);
+	gchar buf[BUFFER_LENGTH];
+	gint len;
+
+	while ((len = socket_fd_read(sock, buf, sizeof(buf))) > 0)
+		g_string_append_len(doc_list, buf, len);
+
+	/* if we received ETX (end-of-text), there were no open files, so print only otherwise */
+	if (! utils_str_equal(doc_list->str, "\3"))
+		printf("%s", doc_list->str);
+	g_string_free(doc_list, TRUE);
+}
+
+
+/* Sends the files to open in one message and waits until the running instance has read it.
+ * The message is a batchopen command followed by (all numbers are 32 bit unsigned
+ * integers in network byte order):
+ * version, flags, line, column, startup ID length, startup ID, number of files,
+ * and for each file its length and the file name.
+ * Returns FALSE if the running instance didn't understand the request, e.g. because it is
+ * an older version, in which case no file has been opened. */
+static gboolean send_open_request(gint sock, GPtrArray *filenames, gint line, gint column,
+		gboolean readonly, gboolean list_documents)
+{
+	GString *request = g_string_new("batchopen\n");
+	const gchar *startup_id = g_getenv("DESKTOP_STARTUP_ID");
+	guint32 status = 0;
+	gboolean ok;
+	guint i;
+
+	append_uint32(request, OPEN_REQUEST_VERSION);
+	append_uint32(request, readonly ? OPEN_REQUEST_READONLY : 0);
+	append_uint32(request, (guint32) line);
+	append_uint32(request, (guint32) column);
+	/* the running instance completes the startup notification when this process
+	 * didn't initialise GTK to do it itself */
+	append_string(request, startup_id != NULL ? startup_id : "");
+	append_uint32(request, filenames->len);
+	for (i = 0; i < filenames->len; i++)
+		append_string(request, g_ptr_array_index(filenames, i));
+	if (list_documents)
+		g_string_append(request, "doclist\n");
+
+	ok = socket_fd_write_all(sock, request->str, request->len) == (gint) request->len;
+	g_string_free(request, TRUE);
+
+	/* tell the running instance there are no more commands, older versions then close the
+	 * socket instead of waiting for more input */
+	shutdown(sock, SHUT_WR);
+
+	if (ok)
+		ok = socket_fd_read_all(sock, (gchar *) &status, sizeof(status)) == sizeof(status) &&
+			g_ntohl(status) == 0;
+
+	if (ok && list_documents)
+		print_document_list(sock);
+	return ok;
+}
+
+
+static GPtrArray *get_argv_filenames(gint argc, gchar **argv)
+{
+	GPtrArray *filenames = g_ptr_array_new();
+	gint i;
+
+	for (i = 1; i < argc && argv[i] != NULL; i++)
+		g_ptr_array_add(filenames, main_get_argv_filename(argv[i]));
+	return filenames;
+}
+
+
+static void free_filenames(GPtrArray *filenames)
+{
+	g_ptr_array_foreach(filenames, (GFunc) g_free, NULL);
+	g_ptr_array_free(filenames, TRUE);
+}
+
+
 #ifndef G_OS_WIN32
 static void remove_socket_link_full(void)
 {
@@ -195,21 +310,13 @@ static void remove_socket_link_full(void)
 
 static void socket_get_document_list(gint sock)
 {
-	gchar doc_list[BUFFER_LENGTH];
-	gint doc_list_len;
-
 	if (sock < 0)
 		return;
 
 	socket_fd_write_all(sock, "doclist\n", 8);
-
-	doc_list_len = socket_fd_read(sock, doc_list, sizeof(doc_list));
-	if (doc_list_len >= BUFFER_LENGTH)
-		doc_list_len = BUFFER_LENGTH -1;
-	doc_list[doc_list_len] = '\0';
-	/* if we received ETX (end-of-text), there were no open files, so print only otherwise */
-	if (! utils_str_equal(doc_list, "\3"))
-		printf("%s", doc_list);
+	/* the running instance closes the socket after sending the list */
+	shutdown(sock, SHUT_WR);
+	print_document_list(sock);
 }
 
 
@@ -236,6 +343,82 @@ static void check_socket_permissions(void)
 #endif
 
 
+#ifndef G_OS_WIN32
+/* Returns the name of the socket link in config_dir for the given display. */
+static gchar *get_socket_file_name(const gchar *config_dir, const gchar *display)
+{
+	gchar *display_name = g_strdup(display != NULL ? display : "NODISPLAY");
+	gchar *hostname = utils_get_hostname();
+	gchar *file_name;
+	gchar *p;
+
+	/* these lines are taken from dcopc.c in kdelibs */
+	if ((p = strrchr(display_name, '.')) > strrchr(display_name, ':') && p != NULL)
+		*p = '\0';
+	/* remove characters that may not be acceptable in a filename */
+	for (p = display_name; *p; p++)
+	{
+		if (*p == ':' || *p == '/')
+			*p = '_';
+	}
+
+	file_name = g_strdup_printf("%s%cgeany_socket_%s_%s",
+		config_dir, G_DIR_SEPARATOR, hostname, display_name);
+
+	g_free(display_name);
+	g_free(hostname);
+	return file_name;
+}
+#endif
+
+
+static gint socket_connect(void)
+{
+#ifdef G_OS_WIN32
+	return socket_fd_connect_inet(REMOTE_CMD_PORT);
+#else
+	return socket_fd_connect_unix(socket_info.file_name);
+#endif
+}
+
+
+/* Sends files to a running instance early at startup, before GTK and the configuration
+ * directory are set up. The socket name is found like socket_init() does but with the
+ * display name taken from the environment, for anything unusual FALSE is returned and
+ * socket_init() can be used after the normal startup.
+ * Returns TRUE if the running instance accepted the files. */
+gboolean socket_send_open_request(const gchar *config_dir, const gchar *socket_file_name,
+		GPtrArray *filenames, gint line, gint column, gboolean readonly)
+{
+#ifdef G_OS_WIN32
+	return FALSE;
+#else
+	struct stat socket_stat;
+	gchar *file_name;
+	gboolean ok = FALSE;
+	gint sock;
+
+	if (socket_file_name != NULL)
+		file_name = g_strdup(socket_file_name);
+	else
+		file_name = get_socket_file_name(config_dir, g_getenv("DISPLAY"));
+
+	/* leave sockets of other users to check_socket_permissions() */
+	if (g_lstat(file_name, &socket_stat) == 0 && socket_stat.st_uid == getuid())
+	{
+		sock = socket_fd_connect_unix(file_name);
+		if (sock >= 0)
+		{
+			ok = send_open_request(sock, filenames, line, column, readonly, FALSE);
+			socket_fd_close(sock);
+		}
+	}
+	g_free(file_name);
+	return ok;
+#endif
+}
+
+
 /* (Unix domain) socket support to replace the old FIFO code
  * (taken from Sylpheed, thanks)
  * Returns the created socket, -1 if an error occurred or -2 if another socket exists and files
@@ -271,29 +454,13 @@ gint socket_init(gint argc, gchar **argv)
 	if (sock < 0)
 		return -1;
 #else
-	gchar *display_name = gdk_get_display();
-	gchar *hostname = utils_get_hostname();
-	gchar *p;
-
-	if (display_name == NULL)
-		display_name = g_strdup("NODISPLAY");
-
-	/* these lines are taken from dcopc.c in kdelibs */
-	if ((p = strrchr(display_name, '.')) > strrchr(display_name, ':') && p != NULL)
-		*p = '\0';
-	/* remove characters that may not be acceptable in a filename */
-	for (p = display_name; *p; p++)
-	{
-		if (*p == ':' || *p == '/')
-			*p = '_';
-	}
-
 	if (socket_info.file_name == NULL)
-		socket_info.file_name = g_strdup_printf("%s%cgeany_socket_%s_%s",
-			app->configdir, G_DIR_SEPARATOR, hostname, display_name);
+	{
+		gchar *display_name = gdk_get_display();
 
-	g_free(display_name);
-	g_free(hostname);
+		socket_info.file_name = get_socket_file_name(app->configdir, display_name);
+		g_free(display_name);
+	}
 
 	/* check whether the real user id is the same as this of the socket file */
 	check_socket_permissions();
@@ -317,15 +484,31 @@ gint socket_init(gint argc, gchar **argv)
 	/* now we send the command line args */
 	if (argc > 1)
 	{
-		send_open_command(sock, argc, argv);
-	}
+		GPtrArray *filenames = get_argv_filenames(argc, argv);
 
-	if (cl_options.list_documents)
+		geany_debug("using running instance of Geany");
+		if (! send_open_request(sock, filenames, cl_options.goto_line, cl_options.goto_column,
+				cl_options.readonly, cl_options.list_documents))
+		{
+			/* the running instance is an older version, use the line based commands */
+			socket_fd_close(sock);
+			sock = socket_connect();
+			if (sock >= 0)
+			{
+				send_open_command(sock, argc, argv);
+				if (cl_options.list_documents)
+					socket_get_document_list(sock);
+			}
+		}
+		free_filenames(filenames);
+	}
+	else if (cl_options.list_documents)
 	{
 		socket_get_document_list(sock);
 	}
 
-	socket_fd_close(sock);
+	if (sock >= 0)
+		socket_fd_close(sock);
 	return -2;
 }
 
@@ -591,6 +774,85 @@ static gchar *build_document_list(void)
 }
 
 
+static gboolean socket_fd_read_uint32(gint sock, guint32 *value)
+{
+	if (socket_fd_read_all(sock, (gchar *) value, sizeof(*value)) != sizeof(*value))
+		return FALSE;
+
+	*value = g_ntohl(*value);
+	return TRUE;
+}
+
+
+/* Reads a string written by append_string(), returns NULL on errors. */
+static gchar *socket_fd_read_string(gint sock)
+{
+	guint32 len;
+	gchar *str;
+
+	if (! socket_fd_read_uint32(sock, &len) || len > OPEN_REQUEST_MAX_LENGTH)
+		return NULL;
+
+	str = g_malloc(len + 1);
+	if (socket_fd_read_all(sock, str, len) != (gint) len)
+	{
+		g_free(str);
+		return NULL;
+	}
+	str[len] = '\0';
+	return str;
+}
+
+
+/* Reads the message sent by send_open_request() and opens the files in it.
+ * Returns FALSE if the message was invalid, then nothing is opened and no answer is sent. */
+static gboolean handle_open_request(gint sock, gchar **startup_id)
+{
+	GPtrArray *filenames = g_ptr_array_new();
+	guint32 version, flags, line, column, count = 0, i;
+	guint32 status = g_htonl(0);
+	gboolean ok;
+
+	ok = socket_fd_read_uint32(sock, &version) && version == OPEN_REQUEST_VERSION &&
+		socket_fd_read_uint32(sock, &flags) &&
+		socket_fd_read_uint32(sock, &line) &&
+		socket_fd_read_uint32(sock, &column);
+	if (ok)
+	{
+		g_free(*startup_id);
+		*startup_id = socket_fd_read_string(sock);
+		ok = *startup_id != NULL && socket_fd_read_uint32(sock, &count) &&
+			count <= OPEN_REQUEST_MAX_FILES;
+	}
+	for (i = 0; ok && i < count; i++)
+	{
+		gchar *filename = socket_fd_read_string(sock);
+
+		if (filename != NULL)
+			g_ptr_array_add(filenames, filename);
+		else
+			ok = FALSE;
+	}
+
+	if (ok)
+	{
+		/* answer before opening the files so the sender can exit right away */
+		socket_fd_write_all(sock, (gchar *) &status, sizeof(status));
+
+		cl_options.readonly = (flags & OPEN_REQUEST_READONLY) != 0;
+		if ((gint32) line >= 0)
+			cl_options.goto_line = (gint32) line;
+		if ((gint32) column >= 0)
+			cl_options.goto_column = (gint32) column;
+
+		for (i = 0; i < filenames->len; i++)
+			handle_input_filename(g_ptr_array_index(filenames, i));
+	}
+	free_filenames(filenames);
+	return ok;
+}
+
+
 gboolean socket_lock_input_cb(GIOChannel *source, GIOCondition condition, gpointer data)
 {
 	gint fd, sock;
@@ -599,6 +861,7 @@ gboolean socket_lock_input_cb(GIOChannel *source, GIOCondition condition, gpoint
 	socklen_t caddr_len = sizeof(caddr);
 	GtkWidget *window = data;
 	gboolean popup = FALSE;
+	gchar *startup_id = NULL;
 
 	fd = g_io_channel_unix_get_fd(source);
 	sock = accept(fd, (struct sockaddr *)&caddr, &caddr_len);
@@ -606,7 +869,14 @@ gboolean socket_lock_input_cb(GIOChannel *source, GIOCondition condition, gpoint
 	/* first get the command */
 	while (socket_fd_gets(sock, buf, sizeof(buf)) != -1)
 	{
-		if (strncmp(buf, "open", 4) == 0)
+		if (strncmp(buf, "batchopen", 9) == 0)
+		{
+			/* the rest of the input can't be parsed after an invalid message */
+			if (! handle_open_request(sock, &startup_id))
+				break;
+			popup = TRUE;
+		}
+		else if (strncmp(buf, "open", 4) == 0)
 		{
 			cl_options.readonly = strncmp(buf+4, "ro", 2) == 0; /* open in readonly? */
 			while (socket_fd_gets(sock, buf, sizeof(buf)) != -1 && *buf != '.')
@@ -662,6 +932,10 @@ gboolean socket_lock_input_cb(GIOChannel *source, GIOCondition condition, gpoint
 
 	if (popup)
 	{
+		/* completes the startup notification of the sender if it didn't initialise GTK and
+		 * uses the time of the user action which started it to raise the window */
+		if (NZV(startup_id))
+			gtk_window_set_startup_id(GTK_WINDOW(window), startup_id);
 #ifdef GDK_WINDOWING_X11
 		GdkWindow *x11_window = gtk_widget_get_window(window);
 
@@ -683,6 +957,7 @@ gboolean socket_lock_input_cb(GIOChannel *source, GIOCondition condition, gpoint
 	}
 
 	socket_fd_close(sock);
+	g_free(startup_id);
 
 	return TRUE;
 }
@@ -734,6 +1009,24 @@ static gint socket_fd_read(gint fd, gchar *buf, gint len)
 }
 
 
+static gint socket_fd_read_all(gint fd, gchar *buf, gint len)
+{
+	gint n, rdlen = 0;
+
+	while (len)
+	{
+		n = socket_fd_read(fd, buf, len);
+		if (n <= 0)
+			return -1;
+		len -= n;
+		rdlen += n;
+		buf += n;
+	}
+
+	return rdlen;
+}
+
+
 static gint socket_fd_check_io(gint fd, GIOCondition cond)
 {
 	struct timeval timeout;
@@ -37,6 +37,9 @@ extern struct socket_info_struct socket_info;
 
 gint socket_init(gint argc, gchar **argv);
 
+gboolean socket_send_open_request(const gchar *config_dir, const gchar *socket_file_name,
+		GPtrArray *filenames, gint line, gint column, gboolean readonly);
+
 gboolean socket_lock_input_cb(GIOChannel *source, GIOCondition condition, gpointer data);
 
 gint socket_finalize(void);
@@ -56,6 +56,7 @@
 #include "sciwrappers.h"
 #include "filetypesprivate.h"
 #include "search.h"
+#include "profile.h"
 
 
 const guint TM_GLOBAL_TYPE_MASK =
@@ -157,7 +158,9 @@ static gboolean symbols_load_global_tags(const gchar *tags_file, GeanyFiletype *
 	gboolean result;
 	gsize old_tag_count = get_tag_count();
 
+	profile_begin("tags", tags_file);
 	result = tm_workspace_load_global_tags(tags_file, ft->lang);
+	profile_end();
 	if (result)
 	{
 		geany_debug("Loaded %s (%s), %u tag(s).", tags_file, ft->name,
@@ -1670,6 +1673,7 @@ static void sort_tree(GtkTreeStore *store, gboolean sort_by_name)
 gboolean symbols_recreate_tag_list(GeanyDocument *doc, gint sort_mode)
 {
 	GList *tags;
+	ProfileTimer timer;
 
 	g_return_val_if_fail(doc != NULL, FALSE);
 
@@ -1677,6 +1681,8 @@ gboolean symbols_recreate_tag_list(GeanyDocument *doc, gint sort_mode)
 	if (tags == NULL)
 		return FALSE;
 
+	profile_timer_start(&timer, PROFILE_SYMBOLS_TAG_LIST);
+
 	/* FIXME: Not sure why we detached the model here? */
 
 	/* disable sorting during update because the code doesn't support correctly
@@ -1697,6 +1703,7 @@ gboolean symbols_recreate_tag_list(GeanyDocument *doc, gint sort_mode)
 	sort_tree(doc->priv->tag_store, sort_mode == SYMBOLS_SORT_BY_NAME);
 	doc->priv->symbol_list_sort_mode = sort_mode;
 
+	profile_timer_stop(&timer);
 	return TRUE;
 }
 
@@ -2396,6 +2403,17 @@ static void on_document_save(G_GNUC_UNUSED GObject *object, GeanyDocument *doc)
 }
 
 
+static void on_workspace_recreate(gboolean done)
+{
+	static ProfileTimer timer;
+
+	if (! done)
+		profile_timer_start(&timer, PROFILE_WORKSPACE_RECREATE_TAGS);
+	else
+		profile_timer_stop(&timer);
+}
+
+
 void symbols_init(void)
 {
 	gchar *f;
@@ -2407,6 +2425,8 @@ void symbols_init(void)
 	g_free(f);
 
 	g_signal_connect(geany_object, "document-save", G_CALLBACK(on_document_save), NULL);
+
+	tm_workspace_set_recreate_hook(on_workspace_recreate);
 }
 
 
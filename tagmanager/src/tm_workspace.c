@@ -39,6 +39,7 @@
 
 
 static TMWorkspace *theWorkspace = NULL;
+static TMWorkspaceRecreateHook recreate_hook = NULL;
 guint workspace_class_id = 0;
 
 static gboolean tm_create_workspace(void)
@@ -496,6 +497,8 @@ void tm_workspace_recreate_tags_array(void)
 
 	if ((NULL == theWorkspace) || (NULL == theWorkspace->work_objects))
 		return;
+	if (recreate_hook)
+		recreate_hook(FALSE);
 	if (NULL != theWorkspace->work_object.tags_array)
 		g_ptr_array_set_size(theWorkspace->work_object.tags_array, 0);
 	else
@@ -523,6 +526,13 @@ void tm_workspace_recreate_tags_array(void)
 	g_message("Total: %d tags", theWorkspace->work_object.tags_array->len);
 #endif
 	tm_tags_sort(theWorkspace->work_object.tags_array, sort_attrs, TRUE);
+	if (recreate_hook)
+		recreate_hook(TRUE);
+}
+
+void tm_workspace_set_recreate_hook(TMWorkspaceRecreateHook hook)
+{
+	recreate_hook = hook;
 }
 
 gboolean tm_workspace_update(TMWorkObject *workspace, gboolean force
@@ -98,6 +98,14 @@ gboolean tm_workspace_create_global_tags(const char *pre_process, const char **i
 */
 void tm_workspace_recreate_tags_array(void);
 
+/* Called with FALSE before and TRUE after tm_workspace_recreate_tags_array()
+ recreates the tag array, e.g. to measure how long it takes.
+*/
+typedef void (*TMWorkspaceRecreateHook)(gboolean done);
+
+/* Sets the function called around recreating the tag array, or NULL for none. */
+void tm_workspace_set_recreate_hook(TMWorkspaceRecreateHook hook);
+
 /* Calls tm_work_object_update() for all workspace member work objects.
  Use if you want to globally refresh the workspace.
  \param workspace Pointer to the workspace.